@@ -0,0 +1,133 @@
+/*
+
+ */
+
+#include "budget.h"
+#include "token.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+/** ValueFlow steps between two checks of the time and the memory */
+static const std::size_t VALUEFLOW_POLL = 4096;
+
+/** @brief Resident memory of the process in bytes, 0 if it is unknown */
+static std::size_t residentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    std::size_t size = 0, resident = 0;
+    if (statm >> size >> resident)
+        return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+std::size_t Budget::Limits::limit(Resource r) const
+{
+    switch (r) {
+    case TOKENS:
+        return tokens;
+    case VALUEFLOW:
+        return valueFlowSteps;
+    case TEMPLATES:
+        return templateExpansions;
+    case MEMORY:
+        return memory;
+    case TIME:
+        return seconds;
+    default:
+        return 0;
+    }
+}
+
+Budget::Budget(const Limits &limits, const Clock::time_point &start)
+    : _limits(limits), _deadline(start + std::chrono::seconds(limits.seconds)), _valueFlowSteps(0), _templateExpansions(0), _anyExceeded(false)
+{
+    std::fill(_exceeded, _exceeded + RESOURCES, false);
+}
+
+bool Budget::check(const Token *tokens)
+{
+    if (_limits.tokens && !_exceeded[TOKENS]) {
+        std::size_t count = 0;
+        for (const Token *tok = tokens; tok && count <= _limits.tokens; tok = tok->next())
+            ++count;
+        if (count > _limits.tokens)
+            exceed(TOKENS);
+    }
+    memoryExceeded();
+    timeExceeded();
+    return _anyExceeded;
+}
+
+bool Budget::valueFlowStep()
+{
+    ++_valueFlowSteps;
+    if (_limits.valueFlowSteps && _valueFlowSteps > _limits.valueFlowSteps)
+        exceed(VALUEFLOW);
+    if (_valueFlowSteps % VALUEFLOW_POLL == 0) {
+        memoryExceeded();
+        timeExceeded();
+    }
+    return !_anyExceeded;
+}
+
+bool Budget::templateExpansion()
+{
+    ++_templateExpansions;
+    if (_limits.templateExpansions && _templateExpansions > _limits.templateExpansions)
+        exceed(TEMPLATES);
+    timeExceeded();
+    return !_anyExceeded;
+}
+
+bool Budget::timeExceeded()
+{
+    if (_limits.seconds && !_exceeded[TIME] && Clock::now() > _deadline)
+        exceed(TIME);
+    return _exceeded[TIME];
+}
+
+bool Budget::memoryExceeded()
+{
+    if (_limits.memory && !_exceeded[MEMORY] && residentMemory() / (1024 * 1024) > _limits.memory)
+        exceed(MEMORY);
+    return _exceeded[MEMORY];
+}
+
+void Budget::degrade(const std::string &stage)
+{
+    if (std::find(_degraded.begin(), _degraded.end(), stage) == _degraded.end())
+        _degraded.push_back(stage);
+}
+
+const char *Budget::name(Resource r)
+{
+    switch (r) {
+    case TOKENS:
+        return "tokens";
+    case VALUEFLOW:
+        return "valueflow";
+    case TEMPLATES:
+        return "templates";
+    case MEMORY:
+        return "memory";
+    case TIME:
+        return "time";
+    default:
+        return "";
+    }
+}
@@ -0,0 +1,127 @@
+/*
+
+ */
+
+#include "config.h"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef budgetH
+#define budgetH
+
+class Token;
+
+/**
+ * @brief Resources that checking one configuration of a file may use
+ * (--budget-...).
+ *
+ * Once a resource is exceeded the expensive stages that follow are
+ * simplified or skipped, so that one pathological file can't hold up the
+ * whole run: templates are no longer instantiated, ValueFlow stays within
+ * single blocks and simplifyTokenList2() is skipped. The stages that were
+ * degraded are collected so they can be reported.
+ */
+class ZKCHECKLIB Budget {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum Resource { TOKENS, VALUEFLOW, TEMPLATES, MEMORY, TIME, RESOURCES };
+
+    /** @brief The limits, 0 means unlimited */
+    struct Limits {
+        Limits() : tokens(0), valueFlowSteps(0), templateExpansions(0), memory(0), seconds(0) {
+        }
+
+        /** tokens of the token list between the stages */
+        std::size_t tokens;
+
+        /** tokens walked by the ValueFlow forward and reverse analysis */
+        std::size_t valueFlowSteps;
+
+        /** instantiated templates */
+        std::size_t templateExpansions;
+
+        /** resident memory of the process in MiB */
+        std::size_t memory;
+
+        /** wall time since the checking of the file started */
+        std::size_t seconds;
+
+        bool any() const {
+            return tokens || valueFlowSteps || templateExpansions || memory || seconds;
+        }
+
+        std::size_t limit(Resource r) const;
+    };
+
+    /**
+     * @param limits the limits, they must outlive the budget
+     * @param start when the checking of the file started
+     */
+    Budget(const Limits &limits, const Clock::time_point &start);
+
+    /**
+     * @brief Check the tokens, the memory and the time between two stages
+     * @return true if the budget is exceeded
+     */
+    bool check(const Token *tokens);
+
+    /**
+     * @brief Count one token walked by ValueFlow
+     * @return false if the budget is exceeded, ValueFlow must not leave the
+     * current block then
+     */
+    bool valueFlowStep();
+
+    /**
+     * @brief Count one template instantiation
+     * @return false if the budget is exceeded, the template must not be
+     * instantiated then
+     */
+    bool templateExpansion();
+
+    /** @brief Check the time, true if it is exceeded */
+    bool timeExceeded();
+
+    bool exceeded(Resource r) const {
+        return _exceeded[r];
+    }
+
+    /** @brief Is any resource exceeded? */
+    bool exceeded() const {
+        return _anyExceeded;
+    }
+
+    /** @brief Remember that a stage was degraded, each stage is remembered once */
+    void degrade(const std::string &stage);
+
+    const std::vector<std::string> &degradedStages() const {
+        return _degraded;
+    }
+
+    /** @brief Name of the resource in the --budget- option */
+    static const char *name(Resource r);
+
+private:
+    void exceed(Resource r) {
+        _exceeded[r] = _anyExceeded = true;
+    }
+
+    bool memoryExceeded();
+
+    const Limits &_limits;
+    const Clock::time_point _deadline;
+
+    std::size_t _valueFlowSteps;
+    std::size_t _templateExpansions;
+
+    bool _exceeded[RESOURCES];
+    bool _anyExceeded;
+
+    std::vector<std::string> _degraded;
+};
+
+#endif // budgetH
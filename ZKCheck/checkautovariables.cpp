@@ -98,7 +98,7 @@ bool CheckAutoVariables::isAutoVarArray(const Token *tok)
 
     // ValueFlow
     if (var->isPointer() && !var->isArgument()) {
-        for (std::list<ValueFlow::Value>::const_iterator it = tok->values.begin(); it != tok->values.end(); ++it) {
+        for (ValueFlow::ValueList::const_iterator it = tok->values().begin(); it != tok->values().end(); ++it) {
             const ValueFlow::Value &val = *it;
             if (val.tokvalue && isAutoVarArray(val.tokvalue))
                 return true;
@@ -1894,11 +1894,11 @@ void CheckOther::checkDuplicateExpression()
                         }
                     }
                 } else if (!Token::Match(tok, "[-/%]")) { // These operators are not associative
-                    if (styleEnabled && tok->astOperand2() && tok->str() == tok->astOperand1()->str() && isSameExpression(_tokenizer->isCPP(), true, tok->astOperand2(), tok->astOperand1()->astOperand2(), _settings->library.functionpure) && isWithoutSideEffects(_tokenizer->isCPP(), tok->astOperand2()))
+                    if (styleEnabled && tok->astOperand2() && tok->strEquals(tok->astOperand1()) && isSameExpression(_tokenizer->isCPP(), true, tok->astOperand2(), tok->astOperand1()->astOperand2(), _settings->library.functionpure) && isWithoutSideEffects(_tokenizer->isCPP(), tok->astOperand2()))
                         duplicateExpressionError(tok->astOperand2(), tok->astOperand2(), tok->str());
                     else if (tok->astOperand2()) {
                         const Token *ast1 = tok->astOperand1();
-                        while (ast1 && tok->str() == ast1->str()) {
+                        while (ast1 && tok->strEquals(ast1)) {
                             if (isSameExpression(_tokenizer->isCPP(), true, ast1->astOperand1(), tok->astOperand2(), _settings->library.functionpure) && isWithoutSideEffects(_tokenizer->isCPP(), ast1->astOperand1()))
                                 // TODO: warn if variables are unchanged. See #5683
                                 // Probably the message should be changed to 'duplicate expressions X in condition or something like that'.
@@ -2400,8 +2400,8 @@ void CheckOther::checkInterlockedDecrement()
             const Token* checkStartTok =  interlockedVarTok->tokAt(5);
             if ((Token::Match(checkStartTok, "0 %comp% %name% )") && checkStartTok->strAt(2) == interlockedVarTok->str()) ||
                 (Token::Match(checkStartTok, "! %name% )") && checkStartTok->strAt(1) == interlockedVarTok->str()) ||
-                (Token::Match(checkStartTok, "%name% )") && checkStartTok->str() == interlockedVarTok->str()) ||
-                (Token::Match(checkStartTok, "%name% %comp% 0 )") && checkStartTok->str() == interlockedVarTok->str())) {
+                (Token::Match(checkStartTok, "%name% )") && checkStartTok->strEquals(interlockedVarTok)) ||
+                (Token::Match(checkStartTok, "%name% %comp% 0 )") && checkStartTok->strEquals(interlockedVarTok))) {
                 raceAfterInterlockedDecrementError(checkStartTok);
             }
         } else if (Token::Match(tok, "if ( ::| InterlockedDecrement ( & %name%")) {
@@ -2412,12 +2412,12 @@ void CheckOther::checkInterlockedDecrement()
                 const Token* ifEndTok = condEnd->next()->link();
                 if (Token::Match(ifEndTok, "} return %name%")) {
                     const Token* secondAccessTok = ifEndTok->tokAt(2);
-                    if (secondAccessTok->str() == firstAccessTok->str()) {
+                    if (secondAccessTok->strEquals(firstAccessTok)) {
                         raceAfterInterlockedDecrementError(secondAccessTok);
                     }
                 } else if (Token::Match(ifEndTok, "} else { return %name%")) {
                     const Token* secondAccessTok = ifEndTok->tokAt(4);
-                    if (secondAccessTok->str() == firstAccessTok->str()) {
+                    if (secondAccessTok->strEquals(firstAccessTok)) {
                         raceAfterInterlockedDecrementError(secondAccessTok);
                     }
                 }
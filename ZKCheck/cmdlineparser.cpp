@@ -8,7 +8,7 @@
 #include "filelister.h"
 #include "path.h"
 #include "settings.h"
-//#include "timer.h"
+#include "timer.h"
 #include "check.h"
 #include "threadexecutor.h" // Threading model
 
@@ -122,6 +122,56 @@ bool CmdLineParser::ParseFromArgs(int argc, const char* const argv[])
             else if (std::strcmp(argv[i], "--dump") == 0)
                 _settings->dump = true;
 
+            // Limit the resources checking a configuration may use
+            else if (std::strncmp(argv[i], "--budget-", 9) == 0) {
+                const char * const value = std::strchr(argv[i], '=');
+                const std::string resource(argv[i] + 9, value ? value : argv[i] + std::strlen(argv[i]));
+                std::size_t *limit = nullptr;
+                if (resource == "tokens")
+                    limit = &_settings->budget.tokens;
+                else if (resource == "valueflow")
+                    limit = &_settings->budget.valueFlowSteps;
+                else if (resource == "templates")
+                    limit = &_settings->budget.templateExpansions;
+                else if (resource == "memory")
+                    limit = &_settings->budget.memory;
+                else if (resource == "time")
+                    limit = &_settings->budget.seconds;
+                if (!limit) {
+                    PrintMessage("cppcheck: error: unknown budget '" + resource + "'.");
+                    return false;
+                }
+
+                std::istringstream iss(value ? value + 1 : "");
+                if (!(iss >> *limit)) {
+                    PrintMessage("cppcheck: argument to '--budget-" + resource + "=' is not a number.");
+                    return false;
+                }
+            }
+
+            // Cache the results of each configuration
+            else if (std::strncmp(argv[i], "--cache-dir=", 12) == 0) {
+                _settings->cacheDir = Path::fromNativeSeparators(argv[i] + 12);
+                if (_settings->cacheDir.empty()) {
+                    PrintMessage("cppcheck: error: argument to '--cache-dir' is missing.");
+                    return false;
+                }
+            }
+
+            // Check the configurations of a file with several threads
+            else if (std::strncmp(argv[i], "--config-jobs=", 14) == 0) {
+                std::istringstream iss(14+argv[i]);
+                if (!(iss >> _settings->configJobs)) {
+                    PrintMessage("cppcheck: argument to '--config-jobs=' is not a number.");
+                    return false;
+                }
+
+                if (_settings->configJobs < 1 || _settings->configJobs > 10000) {
+                    PrintMessage("cppcheck: argument to '--config-jobs=' must be between 1 and 10000.");
+                    return false;
+                }
+            }
+
             // (Experimental) exception handling inside cppcheck client
             else if (std::strcmp(argv[i], "--exception-handling") == 0)
                 _settings->exceptionHandling = true;
@@ -469,6 +519,10 @@ bool CmdLineParser::ParseFromArgs(int argc, const char* const argv[])
                 _settings->reportProgress = true;
             }
 
+            // Print statistics
+            else if (std::strcmp(argv[i], "--stats") == 0)
+                _settings->stats = true;
+
             // --std
             else if (std::strcmp(argv[i], "--std=posix") == 0) {
                 _settings->standards.posix = true;
@@ -562,6 +616,23 @@ bool CmdLineParser::ParseFromArgs(int argc, const char* const argv[])
                 }
             }
 
+            // Reuse worker processes for many files
+            else if (std::strcmp(argv[i], "--worker-pool") == 0)
+                _settings->workerPool = true;
+
+            // Check with child processes or with threads in this process
+            else if (std::strncmp(argv[i], "--executor=", 11) == 0) {
+                const std::string executor = argv[i] + 11;
+                if (executor == "process")
+                    _settings->inProcessThreads = false;
+                else if (executor == "thread")
+                    _settings->inProcessThreads = true;
+                else {
+                    PrintMessage("cppcheck: error: unrecognized executor: \"" + executor + "\". Supported executors: process, thread.");
+                    return false;
+                }
+            }
+
             // print all possible error messages..
             else if (std::strcmp(argv[i], "--errorlist") == 0) {
                 _showErrorMessages = true;
@@ -586,25 +657,25 @@ bool CmdLineParser::ParseFromArgs(int argc, const char* const argv[])
                 return true;
             }
 
-            //// show timing information..
-            //else if (std::strncmp(argv[i], "--showtime=", 11) == 0) {
-            //    const std::string showtimeMode = argv[i] + 11;
-            //    if (showtimeMode == "file")
-            //        _settings->showtime = SHOWTIME_FILE;
-            //    else if (showtimeMode == "summary")
-            //        _settings->showtime = SHOWTIME_SUMMARY;
-            //    else if (showtimeMode == "top5")
-            //        _settings->showtime = SHOWTIME_TOP5;
-            //    else if (showtimeMode.empty())
-            //        _settings->showtime = SHOWTIME_NONE;
-            //    else {
-            //        std::string message("cppcheck: error: unrecognized showtime mode: \"");
-            //        message += showtimeMode;
-            //        message += "\". Supported modes: file, summary, top5.";
-            //        PrintMessage(message);
-            //        return false;
-            //    }
-            //}
+            // show timing information..
+            else if (std::strncmp(argv[i], "--showtime=", 11) == 0) {
+                const std::string showtimeMode = argv[i] + 11;
+                if (showtimeMode == "file")
+                    _settings->showtime = SHOWTIME_FILE;
+                else if (showtimeMode == "summary")
+                    _settings->showtime = SHOWTIME_SUMMARY;
+                else if (showtimeMode == "top5")
+                    _settings->showtime = SHOWTIME_TOP5;
+                else if (showtimeMode.empty())
+                    _settings->showtime = SHOWTIME_NONE;
+                else {
+                    std::string message("cppcheck: error: unrecognized showtime mode: \"");
+                    message += showtimeMode;
+                    message += "\". Supported modes: file, summary, top5.";
+                    PrintMessage(message);
+                    return false;
+                }
+            }
 
 #ifdef HAVE_RULES
             // Rule given at command line
@@ -754,6 +825,9 @@ bool CmdLineParser::ParseFromArgs(int argc, const char* const argv[])
     if (_settings->basePaths.empty() && _settings->relativePaths)
         _settings->basePaths = _pathnames;
 
+    // Compile the rules once, the settings copied for each file share them
+    _settings->compileRules();
+
     return true;
 }
 
@@ -769,6 +843,22 @@ void CmdLineParser::PrintHelp()
               "Options:\n"
               "    --append=<file>      This allows you to provide information about functions\n"
               "                         by providing an implementation for them.\n"
+              "    --budget-<resource>=<limit>\n"
+              "                         Limit a resource that checking a configuration may\n"
+              "                         use. When a limit is exceeded, the stages that follow\n"
+              "                         are simplified or skipped and an information message\n"
+              "                         names them. The resources are:\n"
+              "                          * tokens     tokens after preprocessing and after\n"
+              "                                       the first simplification\n"
+              "                          * valueflow  tokens walked by the ValueFlow analysis\n"
+              "                          * templates  instantiated templates\n"
+              "                          * memory     resident memory of the process in MiB\n"
+              "                          * time       seconds since the checking of the\n"
+              "                                       file started\n"
+              "    --cache-dir=<dir>    Cache the results of each checked configuration in\n"
+              "                         <dir>. A configuration whose preprocessed code and\n"
+              "                         settings did not change is not checked again.\n"
+              "                         Not used together with --dump or --debug.\n"
               "    --check-config       Check cppcheck configuration. The normal code\n"
               "                         analysis is disabled by this flag.\n"
               "    --check-library      Show information messages when library files have\n"
@@ -780,6 +870,10 @@ void CmdLineParser::PrintHelp()
               "                         be considered for evaluation.\n"
               "    --config-excludes-file=<file>\n"
               "                         A file that contains a list of config-excludes\n"
+              "    --config-jobs=<jobs> Check the preprocessor configurations of each file\n"
+              "                         with <jobs> threads. The output is the same as when\n"
+              "                         they are checked one after another. Not used\n"
+              "                         together with --dump or --cache-dir.\n"
               "    --dump               Dump xml data for each translation unit. The dump\n"
               "                         files have the extension .dump and contain ast,\n"
               "                         tokenlist, symboldatabase, valueflow.\n"
@@ -824,6 +918,15 @@ void CmdLineParser::PrintHelp()
               "                         provided. Note that your operating system can modify\n"
               "                         this value, e.g. '256' can become '0'.\n"
               "    --errorlist          Print a list of all the error messages in XML format.\n"
+              "    --executor=<type>    Used together with -j. How the files are checked in\n"
+              "                         parallel:\n"
+              "                          * process\n"
+              "                                 Child processes, or threads on Windows\n"
+              "                                 (default)\n"
+              "                          * thread\n"
+              "                                 Threads in the cppcheck process. The biggest\n"
+              "                                 files are checked first and idle threads take\n"
+              "                                 over files that other threads have queued.\n"
               "    --exitcode-suppressions=<file>\n"
               "                         Used when certain messages should be displayed but\n"
               "                         should not cause a non-zero exitcode.\n"
@@ -916,6 +1019,19 @@ void CmdLineParser::PrintHelp()
               "    --rule-file=<file>   Use given rule file. For more information, see: \n"
               "                         http://sourceforge.net/projects/cppcheck/files/Articles/\n"
 #endif
+              "    --showtime=<mode>    Print timing information to stdout. The timers are\n"
+              "                         nested: preprocessing, tokenizing, every simplify\n"
+              "                         pass, symbol database, ValueFlow passes and each\n"
+              "                         check. The available modes are:\n"
+              "                          * summary\n"
+              "                                 Tree of all timers, printed when the checking\n"
+              "                                 is finished. Times of all workers are added.\n"
+              "                          * top5\n"
+              "                                 The five timers with the largest self time.\n"
+              "                          * file\n"
+              "                                 Print each timer when it stops.\n"
+              "    --stats              Print statistics to stdout when the checking is\n"
+              "                         finished.\n"
               "    --std=<id>           Set standard.\n"
               "                         The available options are:\n"
               "                          * posix\n"
@@ -947,6 +1063,11 @@ void CmdLineParser::PrintHelp()
               "                         Pre-defined templates: gcc, vs, edit.\n"
               "    -v, --verbose        Output more detailed error information.\n"
               "    --version            Print out version number.\n"
+#ifdef THREADING_MODEL_FORK
+              "    --worker-pool        Used together with -j. Start <jobs> worker processes\n"
+              "                         once and let each of them check many files, instead\n"
+              "                         of starting a new process for every file.\n"
+#endif
               "    --xml                Write results in xml format to error stream (stderr).\n"
               "    --xml-version=<version>\n"
               "                         Select the XML file version. Currently versions 1 and\n"
@@ -0,0 +1,83 @@
+/*
+
+ */
+
+#include "directiveindex.h"
+
+#include <cstring>
+
+/** Does the line start with the string? */
+static bool startsWith(const char *line, const char *end, const char *s)
+{
+    const std::size_t length = std::strlen(s);
+    return (std::size_t)(end - line) >= length && std::memcmp(line, s, length) == 0;
+}
+
+static void classify(const char *line, const char *end, DirectiveIndex::Entry &entry)
+{
+    struct Prefix {
+        const char *str;
+        DirectiveIndex::Kind kind;
+    };
+    // longer prefixes first, "#if " must not take "#ifdef "
+    static const Prefix prefixes[] = {
+        { "#ifdef ", DirectiveIndex::IFDEF },
+        { "#ifndef ", DirectiveIndex::IFNDEF },
+        { "#if ", DirectiveIndex::IF },
+        { "#elif ", DirectiveIndex::ELIF },
+        { "#else", DirectiveIndex::ELSE },
+        { "#endif", DirectiveIndex::ENDIF },
+        { "#endfile", DirectiveIndex::ENDFILE },
+        { "#define ", DirectiveIndex::DEFINE },
+        { "#undef", DirectiveIndex::UNDEF },
+        { "#include", DirectiveIndex::INCLUDE },
+        { "#file \"", DirectiveIndex::FILE },
+        { "#line", DirectiveIndex::LINE },
+        { "#pragma", DirectiveIndex::PRAGMA },
+        { "#error", DirectiveIndex::ERROR }
+    };
+
+    entry.kind = DirectiveIndex::OTHER;
+    for (std::size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+        if (startsWith(line, end, prefixes[i].str)) {
+            entry.kind = prefixes[i].kind;
+            if (entry.kind == DirectiveIndex::IF || entry.kind == DirectiveIndex::IFDEF ||
+                entry.kind == DirectiveIndex::IFNDEF || entry.kind == DirectiveIndex::ELIF)
+                entry.condition.assign(line + std::strlen(prefixes[i].str), end);
+            break;
+        }
+    }
+}
+
+DirectiveIndex::DirectiveIndex(const std::string &code) : _lines(0), _size(code.size()), _digest(digest(code))
+{
+    const char * const begin = code.data();
+    const char * const end = begin + code.size();
+    bool codeBefore = false;
+    for (const char *p = begin; p != end;) {
+        ++_lines;
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', (std::size_t)(end - p)));
+        if (!eol)
+            eol = end;
+        if (*p == '#') {
+            _entries.push_back(Entry());
+            Entry &entry = _entries.back();
+            entry.offset = (std::size_t)(p - begin);
+            entry.end = (std::size_t)(eol - begin);
+            entry.line = _lines;
+            entry.codeBefore = codeBefore;
+            classify(p, eol, entry);
+            codeBefore = false;
+        } else if (p != eol) {
+            codeBefore = true;
+        }
+        p = (eol == end) ? end : eol + 1;
+    }
+}
+
+Hash128::Digest DirectiveIndex::digest(const std::string &code)
+{
+    Hash128 hash;
+    hash.update(code);
+    return hash.digest();
+}
@@ -0,0 +1,90 @@
+/*
+
+ */
+
+#include "config.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef directiveindexH
+#define directiveindexH
+
+/**
+ * @brief The preprocessor directives of some code: the lines that start
+ * with '#'.
+ *
+ * The index is built in one pass over the code. The code between two
+ * directives can then be copied or skipped as a whole instead of line by
+ * line. Lines are counted like std::getline() reads them.
+ */
+class ZKCHECKLIB DirectiveIndex {
+public:
+    /** @brief Kind of a directive, by the start of its line */
+    enum Kind {
+        IF,         ///< "#if "
+        IFDEF,      ///< "#ifdef "
+        IFNDEF,     ///< "#ifndef "
+        ELIF,       ///< "#elif "
+        ELSE,       ///< "#else"
+        ENDIF,      ///< "#endif"
+        DEFINE,     ///< "#define "
+        UNDEF,      ///< "#undef"
+        INCLUDE,    ///< "#include"
+        FILE,       ///< "#file \"", added by the preprocessor at the start of an included file
+        ENDFILE,    ///< "#endfile", added at the end of an included file
+        LINE,       ///< "#line"
+        PRAGMA,     ///< "#pragma"
+        ERROR,      ///< "#error"
+        OTHER
+    };
+
+    /** @brief One directive line */
+    struct Entry {
+        /** offset of the '#' in the code */
+        std::size_t offset;
+
+        /** offset of the '\n' that ends the line, or the size of the code */
+        std::size_t end;
+
+        /** line number, 1 for the first line */
+        unsigned int line;
+
+        Kind kind;
+
+        /** is there a line between the previous directive and this one that is not empty? */
+        bool codeBefore;
+
+        /** condition of #if and #elif, name of #ifdef and #ifndef */
+        std::string condition;
+    };
+
+    explicit DirectiveIndex(const std::string &code);
+
+    const std::vector<Entry> &entries() const {
+        return _entries;
+    }
+
+    /** @brief Number of lines of the code */
+    unsigned int lines() const {
+        return _lines;
+    }
+
+    /** @brief Was the index built for this code? */
+    bool indexes(const std::string &code) const {
+        return code.size() == _size && digest(code) == _digest;
+    }
+
+private:
+    std::vector<Entry> _entries;
+    unsigned int _lines;
+
+    static Hash128::Digest digest(const std::string &code);
+
+    std::size_t _size;
+    Hash128::Digest _digest;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+
+ */
+
+#include "headercache.h"
+#include "path.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+HeaderCache &HeaderCache::instance()
+{
+    static HeaderCache cache;
+    return cache;
+}
+
+bool HeaderCache::stamp(const std::string &filename, Stamp &stamp)
+{
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0)
+        return false;
+    stamp.mtime = st.st_mtime;
+    stamp.size = (long long)st.st_size;
+    return true;
+}
+
+bool HeaderCache::resolve(std::string &filename, const std::list<std::string> &includePaths, const std::string &filePath)
+{
+    std::string key = filePath + '\n' + filename;
+    for (std::list<std::string>::const_iterator iter = includePaths.begin(); iter != includePaths.end(); ++iter)
+        key += '\n' + *iter;
+
+    {
+        std::lock_guard<std::mutex> lock(_sync);
+        const std::unordered_map<std::string, std::string>::const_iterator it = _resolved.find(key);
+        if (it != _resolved.end()) {
+            if (it->second.empty())
+                return false;
+            filename = it->second;
+            return true;
+        }
+    }
+
+    Stamp st;
+    std::string resolved;
+    if (stamp(filePath + filename, st))
+        resolved = filePath + filename;
+    else if (stamp(filename, st))
+        resolved = filename;
+    else {
+        for (std::list<std::string>::const_iterator iter = includePaths.begin(); iter != includePaths.end(); ++iter) {
+            const std::string nativePath(Path::toNativeSeparators(*iter));
+            if (stamp(nativePath + filename, st)) {
+                resolved = nativePath + filename;
+                break;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_sync);
+    _resolved[key] = resolved;
+    if (resolved.empty())
+        return false;
+    filename = resolved;
+    return true;
+}
+
+std::shared_ptr<const HeaderCache::Header> HeaderCache::find(const std::string &filename, Stamp &st)
+{
+    if (!stamp(filename, st))
+        return std::shared_ptr<const Header>();
+
+    std::lock_guard<std::mutex> lock(_sync);
+    const std::unordered_map<std::string, std::pair<Stamp, std::shared_ptr<const Header> > >::const_iterator it = _headers.find(filename);
+    if (it == _headers.end() || !(it->second.first == st))
+        return std::shared_ptr<const Header>();
+    return it->second.second;
+}
+
+void HeaderCache::store(const std::string &filename, const Stamp &st, const std::shared_ptr<const Header> &header)
+{
+    std::lock_guard<std::mutex> lock(_sync);
+    _headers[filename] = std::make_pair(st, header);
+}
+
+void HeaderCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_sync);
+    _resolved.clear();
+    _headers.clear();
+}
@@ -0,0 +1,106 @@
+/*
+
+ */
+
+#include "config.h"
+#include "directiveindex.h"
+#include "errorlogger.h"
+
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef headercacheH
+#define headercacheH
+
+/**
+ * @brief Process wide cache of the included headers, shared by all
+ * preprocessors and threads.
+ *
+ * Most translation units include the same headers. They are read and
+ * cleaned by Preprocessor::read() once, later includes use the cached
+ * code. An entry is keyed by the name the header was opened with and is
+ * read again when the modification time or the size of the file changed.
+ * The resolution of include names to file names is cached as well, files
+ * are not expected to appear or disappear while checking.
+ */
+class ZKCHECKLIB HeaderCache {
+public:
+    /** @brief A header as Preprocessor::read() returned it */
+    class ZKCHECKLIB Header {
+    public:
+        explicit Header(const std::string &c) : code(c), directives(code) {
+        }
+
+        const std::string code;
+
+        /** directives of code */
+        const DirectiveIndex directives;
+
+        /** errors reported while the header was read, they are reported again for each include */
+        std::list<ErrorLogger::ErrorMessage> errors;
+    };
+
+    /** @brief Modification time and size of a file */
+    struct Stamp {
+        Stamp() : mtime(0), size(0) {
+        }
+
+        bool operator==(const Stamp &other) const {
+            return mtime == other.mtime && size == other.size;
+        }
+
+        std::time_t mtime;
+        long long size;
+    };
+
+    static HeaderCache &instance();
+
+    /**
+     * @brief Find the file of an include, like the compiler does: next to
+     * the including file, as given and then in the include paths.
+     * @param filename include name (in), file name (out)
+     * @param includePaths paths where to look for the file
+     * @param filePath path of the including file, empty for system headers
+     * @return false if the header was not found
+     */
+    bool resolve(std::string &filename, const std::list<std::string> &includePaths, const std::string &filePath);
+
+    /**
+     * @brief Cached header, if the file did not change since it was stored
+     * @param filename name of the header file
+     * @param stamp the current stamp of the file, for store()
+     * @return null if the header must be read
+     */
+    std::shared_ptr<const Header> find(const std::string &filename, Stamp &stamp);
+
+    void store(const std::string &filename, const Stamp &stamp, const std::shared_ptr<const Header> &header);
+
+    /** @brief Forget everything, e.g. when the include paths changed on disk */
+    void clear();
+
+private:
+    HeaderCache() {
+    }
+
+    static bool stamp(const std::string &filename, Stamp &stamp);
+
+    /** include name, including path and include paths => file name, empty if not found */
+    std::unordered_map<std::string, std::string> _resolved;
+
+    std::unordered_map<std::string, std::pair<Stamp, std::shared_ptr<const Header> > > _headers;
+
+    /** guards the maps */
+    std::mutex _sync;
+
+    /** disabled copy constructor */
+    HeaderCache(const HeaderCache &);
+
+    /** disabled assignment operator */
+    void operator=(const HeaderCache &);
+};
+
+#endif
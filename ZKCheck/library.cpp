@@ -116,6 +116,10 @@ Library::Error Library::load(const tinyxml2::XMLDocument &doc)
     if (format > 2 || format <= 0)
         return Error(UNSUPPORTED_FORMAT);
 
+    tinyxml2::XMLPrinter printer;
+    doc.Print(&printer);
+    _checksum.update(printer.CStr(), static_cast<std::size_t>(printer.CStrSize()));
+
     std::set<std::string> unknown_elements;
 
     for (const tinyxml2::XMLElement *node = rootnode->FirstChildElement(); node; node = node->NextSiblingElement()) {
@@ -6,6 +6,7 @@
 #include "mathlib.h"
 #include "standards.h"
 #include "errorlogger.h"
+#include "utils.h"
 
 #include <map>
 #include <set>
@@ -45,6 +46,11 @@ public:
     /** this is primarily meant for unit tests. it only returns true/false */
     bool loadxmldata(const char xmldata[], std::size_t len);
 
+    /** hash of all library documents loaded so far, in load order */
+    std::string checksum() const {
+        return _checksum.str();
+    }
+
     /** get allocation id for function by name (deprecated, use other alloc) */
     int alloc(const char name[]) const {
         return getid(_alloc, name);
@@ -422,6 +428,7 @@ private:
         std::set<std::string> _blocks;
     };
     int allocid;
+    Hash128 _checksum;
     std::set<std::string> _files;
     std::set<std::string> _useretval;
     std::map<std::string, int> _alloc; // allocation functions
@@ -0,0 +1,89 @@
+/*
+
+ */
+
+#include "mappedfile.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Smaller files are read, mapping them costs more than it saves
+static const std::size_t MinMappedSize = 64U * 1024U;
+
+MappedFile::MappedFile(const std::string &filename)
+    : _data(""), _size(0), _mapping(nullptr)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)MinMappedSize && (unsigned long long)fileSize.QuadPart <= (std::size_t)-1) {
+        const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            _mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            // The view keeps the mapping alive
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    if (_mapping) {
+        _data = static_cast<const char *>(_mapping);
+        _size = (std::size_t)fileSize.QuadPart;
+        return;
+    }
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= (off_t)MinMappedSize) {
+        void *mapping = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            _mapping = mapping;
+            _data = static_cast<const char *>(mapping);
+            _size = (std::size_t)st.st_size;
+        }
+    }
+    close(fd);
+
+    if (_mapping)
+        return;
+#endif
+
+    readFile(filename);
+}
+
+MappedFile::~MappedFile()
+{
+    if (!_mapping)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(_mapping);
+#else
+    munmap(_mapping, _size);
+#endif
+}
+
+void MappedFile::readFile(const std::string &filename)
+{
+    std::ifstream fin(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!fin.is_open())
+        return;
+
+    _buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    _data = _buffer.data();
+    _size = _buffer.size();
+}
@@ -0,0 +1,57 @@
+/*
+
+ */
+
+#include "config.h"
+
+#include <cstddef>
+#include <string>
+
+#ifndef mappedfileH
+#define mappedfileH
+
+/**
+ * @brief Read only view of the contents of a file. The file is memory
+ * mapped if possible, otherwise it is read into a buffer.
+ */
+class ZKCHECKLIB MappedFile {
+public:
+    /**
+     * @brief Map or read the file. If it can't be opened the view is empty.
+     * @param filename name of the file
+     */
+    explicit MappedFile(const std::string &filename);
+
+    ~MappedFile();
+
+    /** @brief The file contents, not null terminated */
+    const char *data() const {
+        return _data;
+    }
+
+    /** @brief Size of the file contents in bytes */
+    std::size_t size() const {
+        return _size;
+    }
+
+private:
+    /** Read the file with read()/ReadFile() when it can't be mapped */
+    void readFile(const std::string &filename);
+
+    const char *_data;
+    std::size_t _size;
+
+    /** The mapped view, null if the file was not mapped */
+    void *_mapping;
+
+    /** Used if the file is read instead of mapped */
+    std::string _buffer;
+
+    /** disabled copy constructor */
+    MappedFile(const MappedFile &);
+
+    /** disabled assignment operator */
+    void operator=(const MappedFile &);
+};
+
+#endif
@@ -4,6 +4,7 @@
 
 
 #include "preprocessor.h"
+#include "mappedfile.h"
 #include "tokenize.h"
 #include "token.h"
 #include "path.h"
@@ -15,9 +16,12 @@
 #include <fstream>
 #include <cstdlib>
 #include <cctype>
+#include <cstring>
+#include <iterator>
 #include <vector>
 #include <set>
 #include <stack>
+#include <unordered_map>
 
 /**
  * Remove heading and trailing whitespaces from the input parameter.
@@ -54,14 +58,20 @@ Directive::Directive(const std::string &_file, const int _linenr, const std::str
     str = trim(str);
 }
 
-bool Preprocessor::missingIncludeFlag;
-bool Preprocessor::missingSystemIncludeFlag;
+Preprocessor::Preprocessor(Settings& settings, ErrorLogger *errorLogger) : _settings(settings), _errorLogger(errorLogger)
+{
 
-char Preprocessor::macroChar = char(1);
+}
 
-Preprocessor::Preprocessor(Settings& settings, ErrorLogger *errorLogger) : _settings(settings), _errorLogger(errorLogger)
+Preprocessor::Preprocessor(const Preprocessor &other, ErrorLogger *errorLogger) : _settings(other._settings), _errorLogger(errorLogger), file0(other.file0), _directiveIndex(other._directiveIndex)
 {
+}
 
+const DirectiveIndex &Preprocessor::directiveIndex(const std::string &filedata)
+{
+    if (!_directiveIndex || !_directiveIndex->indexes(filedata))
+        _directiveIndex = std::make_shared<const DirectiveIndex>(filedata);
+    return *_directiveIndex;
 }
 
 void Preprocessor::writeError(const std::string &fileName, const unsigned int linenr, ErrorLogger *errorLogger, const std::string &errorType, const std::string &errorText)
@@ -79,35 +89,55 @@ void Preprocessor::writeError(const std::string &fileName, const unsigned int li
                            false));
 }
 
-static unsigned char readChar(std::istream &istr, unsigned int bom)
+/**
+ * Decode file data in one pass: skip the BOM, convert UTF-16 to 8-bit
+ * characters (non-ASCII characters become 0xff) and convert "\r\n" and
+ * "\r" newlines to "\n".
+ */
+static void decode(const char *data, std::size_t size, std::string &text)
 {
-    unsigned char ch = (unsigned char)istr.get();
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char * const end = p + size;
 
-    // For UTF-16 encoded files the BOM is 0xfeff/0xfffe. If the
-    // character is non-ASCII character then replace it with 0xff
-    if (bom == 0xfeff || bom == 0xfffe) {
-        const unsigned char ch2 = (unsigned char)istr.get();
-        const int ch16 = (bom == 0xfeff) ? (ch<<8 | ch2) : (ch2<<8 | ch);
-        ch = (unsigned char)((ch16 >= 0x80) ? 0xff : ch16);
+    // The UTF-16 BOM is 0xfffe or 0xfeff.
+    unsigned int bom = 0;
+    if (p != end && *p >= 0xfe) {
+        bom = ((unsigned int)*p++ << 8);
+        if (p != end && *p >= 0xfe)
+            bom |= *p++;
+        else
+            bom = 0; // allowed boms are 0/0xfffe/0xfeff
     }
 
-    // Handling of newlines..
-    if (ch == '\r') {
-        ch = '\n';
-        if (bom == 0 && (char)istr.peek() == '\n')
-            (void)istr.get();
-        else if (bom == 0xfeff || bom == 0xfffe) {
-            int c1 = istr.get();
-            int c2 = istr.get();
-            int ch16 = (bom == 0xfeff) ? (c1<<8 | c2) : (c2<<8 | c1);
-            if (ch16 != '\n') {
-                istr.unget();
-                istr.unget();
+    text.clear();
+    if (bom == 0xfeff || bom == 0xfffe) {
+        text.reserve((std::size_t)(end - p) / 2U);
+        for (; end - p >= 2; p += 2) {
+            const int ch16 = (bom == 0xfeff) ? (p[0]<<8 | p[1]) : (p[1]<<8 | p[0]);
+            if (ch16 == '\r') {
+                text += '\n';
+                if (end - p >= 4 && ((bom == 0xfeff) ? (p[2]<<8 | p[3]) : (p[3]<<8 | p[2])) == '\n')
+                    p += 2;
+            } else {
+                text += (char)((ch16 >= 0x80) ? 0xff : ch16);
             }
         }
+        return;
     }
 
-    return ch;
+    text.reserve((std::size_t)(end - p));
+    while (p != end) {
+        const unsigned char *cr = static_cast<const unsigned char *>(std::memchr(p, '\r', (std::size_t)(end - p)));
+        if (!cr) {
+            text.append(reinterpret_cast<const char *>(p), (std::size_t)(end - p));
+            break;
+        }
+        text.append(reinterpret_cast<const char *>(p), (std::size_t)(cr - p));
+        text += '\n';
+        p = cr + 1;
+        if (p != end && *p == '\n')
+            ++p;
+    }
 }
 
 // Concatenates a list of strings, inserting a separator between parts
@@ -192,30 +222,32 @@ static std::map<std::string,std::string> getcfgmap(const std::string &cfg, const
 /** Just read the code into a string. Perform simple cleanup of the code */
 std::string Preprocessor::read(std::istream &istr, const std::string &filename)
 {
-    // The UTF-16 BOM is 0xfffe or 0xfeff.
-    unsigned int bom = 0;
-    if (istr.peek() >= 0xfe) {
-        bom = ((unsigned char)istr.get() << 8);
-        if (istr.peek() >= 0xfe)
-            bom |= (unsigned char)istr.get();
-        else
-            bom = 0; // allowed boms are 0/0xfffe/0xfeff
-    }
+    const std::string data((std::istreambuf_iterator<char>(istr)), std::istreambuf_iterator<char>());
+    return read(data.data(), data.size(), filename);
+}
+
+std::string Preprocessor::read(const char *data, std::size_t size, const std::string &filename)
+{
+    std::string text;
+    decode(data, size, text);
 
     if (_settings.terminated())
         return "";
 
     if (_settings.checkConfiguration)
-        return readpreprocessor(istr,bom);
+        return readpreprocessor(text);
 
     // ------------------------------------------------------------------------------------------
     //
     // handling <backslash><newline>
     // when this is encountered the <backslash><newline> will be "skipped".
     // on the next <newline>, extra newlines will be added
-    std::ostringstream code;
+    std::string code;
+    code.reserve(text.size());
     unsigned int newlines = 0;
-    for (unsigned char ch = readChar(istr,bom); istr.good(); ch = readChar(istr,bom)) {
+    for (std::string::size_type i = 0; i < text.size(); ++i) {
+        unsigned char ch = (unsigned char)text[i];
+
         // Replace assorted special chars with spaces..
         if (((ch & 0x80) == 0) && (ch != '\n') && (std::isspace(ch) || std::iscntrl(ch)))
             ch = ' ';
@@ -233,11 +265,10 @@ std::string Preprocessor::read(std::istream &istr, const std::string &filename)
 #ifdef __GNUC__
             // gcc-compatibility: ignore spaces
             for (;; spaces += ' ') {
-                chNext = (unsigned char)istr.peek();
-                if (chNext != '\n' && chNext != '\r' &&
-                    (std::isspace(chNext) || std::iscntrl(chNext))) {
+                chNext = (i + 1 < text.size()) ? (unsigned char)text[i + 1] : 0xff;
+                if (chNext != '\n' && (std::isspace(chNext) || std::iscntrl(chNext))) {
                     // Skip whitespace between <backslash> and <newline>
-                    (void)readChar(istr,bom);
+                    ++i;
                     continue;
                 }
 
@@ -245,32 +276,34 @@ std::string Preprocessor::read(std::istream &istr, const std::string &filename)
             }
 #else
             // keep spaces
-            chNext = (unsigned char)istr.peek();
+            chNext = (i + 1 < text.size()) ? (unsigned char)text[i + 1] : 0xff;
 #endif
-            if (chNext == '\n' || chNext == '\r') {
+            if (chNext == '\n') {
                 ++newlines;
-                (void)readChar(istr,bom);   // Skip the "<backslash><newline>"
+                ++i;   // Skip the "<backslash><newline>"
             } else {
-                code << "\\" << spaces;
+                code += '\\';
+                code += spaces;
             }
         } else {
-            code << char(ch);
+            code += char(ch);
 
             // if there has been <backslash><newline> sequences, add extra newlines..
             if (ch == '\n' && newlines > 0) {
-                code << std::string(newlines, '\n');
+                code.append(newlines, '\n');
                 newlines = 0;
             }
         }
     }
+    text.clear();
 
     // ------------------------------------------------------------------------------------------
     //
     // Remove all comments..
-    std::string result = removeComments(code.str(), filename);
+    std::string result = removeComments(code, filename);
     if (_settings.terminated())
         return "";
-    code.str("");
+    code.clear();
 
     // ------------------------------------------------------------------------------------------
     //
@@ -297,13 +330,15 @@ std::string Preprocessor::read(std::istream &istr, const std::string &filename)
 
 
 /** read preprocessor statements */
-std::string Preprocessor::readpreprocessor(std::istream &istr, const unsigned int bom)
+std::string Preprocessor::readpreprocessor(const std::string &text)
 {
     enum { NEWLINE, SPACE, PREPROCESSOR, BACKSLASH, OTHER } state = NEWLINE;
     std::ostringstream code;
     unsigned int newlines = 1;
     unsigned char chPrev = ' ';
-    for (unsigned char ch = readChar(istr,bom); istr.good(); ch = readChar(istr,bom)) {
+    for (std::string::const_iterator it = text.begin(); it != text.end(); ++it) {
+        unsigned char ch = (unsigned char)*it;
+
         // Replace assorted special chars with spaces..
         if (((ch & 0x80) == 0) && (ch != '\n') && (std::isspace(ch) || std::iscntrl(ch)))
             ch = ' ';
@@ -974,13 +1009,19 @@ void Preprocessor::preprocessWhitespaces(std::string &processedFile)
 }
 
 void Preprocessor::preprocess(std::istream &srcCodeStream, std::string &processedFile, std::list<std::string> &resultConfigurations, const std::string &filename, const std::list<std::string> &includePaths)
+{
+    const std::string data((std::istreambuf_iterator<char>(srcCodeStream)), std::istreambuf_iterator<char>());
+    preprocess(data.data(), data.size(), processedFile, resultConfigurations, filename, includePaths);
+}
+
+void Preprocessor::preprocess(const char *data, std::size_t size, std::string &processedFile, std::list<std::string> &resultConfigurations, const std::string &filename, const std::list<std::string> &includePaths)
 {
     std::string forcedIncludes;
 
     if (file0.empty())
         file0 = filename;
 
-    processedFile = read(srcCodeStream, filename);
+    processedFile = read(data, size, filename);
 
     for (std::list<std::string>::iterator it = _settings.userIncludes.begin();
          it != _settings.userIncludes.end();
@@ -1230,12 +1271,10 @@ std::list<std::string> Preprocessor::getcfgs(const std::string &filedata, const
     int filelevel = 0;
 
     bool includeguard = false;
-    unsigned int linenr = 0;
-    std::istringstream istr(filedata);
-    std::string line;
+    const DirectiveIndex &index = directiveIndex(filedata);
     const bool printDebug = _settings.debugwarnings;
-    while (std::getline(istr, line)) {
-        ++linenr;
+    for (std::vector<DirectiveIndex::Entry>::const_iterator directive = index.entries().begin(); directive != index.entries().end(); ++directive) {
+        const unsigned int linenr = directive->line;
 
         if (_settings.terminated())
             return ret;
@@ -1243,8 +1282,11 @@ std::list<std::string> Preprocessor::getcfgs(const std::string &filedata, const
         if (_errorLogger)
             _errorLogger->reportProgress(filename, "Preprocessing (get configurations 1)", 0);
 
-        if (line.empty())
-            continue;
+        // code between the directives ends an include guard
+        if (directive->codeBefore)
+            includeguard = false;
+
+        std::string line(filedata, directive->offset, directive->end - directive->offset);
 
         if (line.compare(0, 6, "#file ") == 0) {
             includeguard = true;
@@ -1749,25 +1791,18 @@ void Preprocessor::simplifyCondition(const std::map<std::string, std::string> &c
         condition = "0";
 }
 
-bool Preprocessor::match_cfg_def(std::map<std::string, std::string> cfg, std::string def)
+bool Preprocessor::match_cfg_def(const std::map<std::string, std::string> &cfg, std::string def)
 {
-    /*
-        std::cout << "cfg: \"";
-        for (std::map<std::string, std::string>::const_iterator it = cfg.begin(); it != cfg.end(); ++it)
-        {
-            std::cout << it->first;
-            if (!it->second.empty())
-                std::cout << "=" << it->second;
-            std::cout << ";";
-        }
-        std::cout << "\"  ";
-        std::cout << "def: \"" << def << "\"\n";
-    */
+    std::map<std::string, std::string> variables(cfg);
+    simplifyVarMap(variables, _settings);
+    return matchSimplifiedCfg(variables, def);
+}
 
-    simplifyVarMap(cfg, _settings);
-    simplifyCondition(cfg, def, true);
+bool Preprocessor::matchSimplifiedCfg(const std::map<std::string, std::string> &variables, std::string def)
+{
+    simplifyCondition(variables, def, true);
 
-    if (cfg.find(def) != cfg.end())
+    if (variables.find(def) != variables.end())
         return true;
 
     if (def == "0")
@@ -1781,33 +1816,145 @@ bool Preprocessor::match_cfg_def(std::map<std::string, std::string> cfg, std::st
 
 std::string Preprocessor::getcode(const std::string &filedata, const std::string &cfg, const std::string &filename)
 {
+    const std::vector<ConfigurationCode> code(getcodes(filedata, std::vector<std::string>(1U, cfg), filename));
+    return getcode(code[0], cfg, filename);
+}
+
+std::string Preprocessor::getcode(const ConfigurationCode &code, const std::string &cfg, const std::string &filename)
+{
+    if (!code.error.empty())
+        error(code.errorFile, code.errorLine, code.error);
+
+    if (!code.complete)
+        return "";
+
+    if (!validateCfg(code.code, cfg)) {
+        return "";
+    }
+
+    return expandMacros(code.code, filename, cfg, _errorLogger);
+}
+
+std::vector<Preprocessor::ConfigurationCode> Preprocessor::getcodes(const std::string &filedata, const std::vector<std::string> &cfgs, const std::string &filename)
+{
+    std::vector<ConfigurationCode> result(cfgs.size());
+    for (std::size_t first = 0; first < cfgs.size(); first += 64U)
+        getcodes(filedata, cfgs, first, filename, result);
+    return result;
+}
+
+namespace {
+    /** @brief Macros of a configuration in Preprocessor::getcodes() */
+    class ConfigurationMacros {
+    public:
+        ConfigurationMacros() : simplified(false) {
+        }
+
+        std::map<std::string, std::string> cfgmap;
+
+        /** cfgmap with simplified values, for match_cfg_def() */
+        std::map<std::string, std::string> variables;
+
+        /** are the variables up to date? */
+        bool simplified;
+    };
+}
+
+void Preprocessor::getcodes(const std::string &filedata, const std::vector<std::string> &cfgs, std::size_t first, const std::string &filename, std::vector<ConfigurationCode> &result)
+{
+    // A set of configurations is a bit mask, bit i is configuration first+i
+    typedef unsigned long long Mask;
+    const std::size_t count = std::min<std::size_t>(cfgs.size() - first, 64U);
+    const Mask all = (count == 64U) ? ~Mask(0) : ((Mask(1) << count) - 1U);
+
     // For the error report and preprocessor dump:
     // line number relative to current (included) file
     // (may decrease when popping back from an included file)
     unsigned int lineno = 0;
 
-    std::ostringstream ret;
+    // The configurations that did not stop at an #error
+    Mask alive = all;
 
-    bool match = true;
-    std::list<bool> matching_ifdef;
-    std::list<bool> matched_ifdef;
+    // The configurations that the current code belongs to
+    Mask match = all;
+
+    // #if levels: the configurations where the current branch is taken,
+    // where a branch was taken, and where all outer levels match
+    struct Level {
+        Mask matching;
+        Mask matched;
+        Mask outer;
+    };
+    std::vector<Level> levels;
 
     // Create a map for the cfg for faster access to defines
-    std::map<std::string, std::string> cfgmap(getcfgmap(cfg, &_settings, filename));
+    std::vector<ConfigurationMacros> macros(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        macros[i].cfgmap = getcfgmap(cfgs[first + i], &_settings, filename);
+        result[first + i].code.reserve(filedata.size());
+    }
+
+    // Evaluate the condition for the configurations in mask
+    const auto evaluate = [&](Mask mask, const std::string &condition) {
+        Mask ret = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!(mask & (Mask(1) << i)))
+                continue;
+            ConfigurationMacros &m = macros[i];
+            if (!m.simplified) {
+                m.variables = m.cfgmap;
+                simplifyVarMap(m.variables, _settings);
+                m.simplified = true;
+            }
+            if (matchSimplifiedCfg(m.variables, condition))
+                ret |= Mask(1) << i;
+        }
+        return ret;
+    };
+
+    // Append to the code of the configurations in mask
+    const auto append = [&](Mask mask, const char *data, std::size_t size) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (mask & (Mask(1) << i))
+                result[first + i].code.append(data, size);
+        }
+    };
+    const auto appendNewlines = [&](Mask mask, std::size_t n) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (mask & (Mask(1) << i))
+                result[first + i].code.append(n, '\n');
+        }
+    };
 
     std::stack<std::string> filenames;
     filenames.push(filename);
     std::stack<unsigned int> lineNumbers;
-    std::istringstream istr(filedata);
-    std::string line;
     directives.clear();
-    while (std::getline(istr, line)) {
-        ++lineno;
 
-        if (line.empty()) {
-            ret << '\n';
-            continue;
-        }
+    // The code between the directives is copied or replaced by empty
+    // lines as a whole, match only changes at directives
+    const DirectiveIndex &index = directiveIndex(filedata);
+    const std::vector<DirectiveIndex::Entry> &entries = index.entries();
+    std::size_t pos = 0;
+    unsigned int linenr = 0;
+    for (std::vector<DirectiveIndex::Entry>::const_iterator directive = entries.begin(); alive; ++directive) {
+        const bool last = (directive == entries.end());
+        const std::size_t spanEnd = last ? filedata.size() : directive->offset;
+        const unsigned int spanLines = (last ? index.lines() + 1U : directive->line) - linenr - 1U;
+        if (spanLines > 0) {
+            lineno += spanLines;
+            append(alive & match, filedata.data() + pos, spanEnd - pos);
+            if (filedata[spanEnd - 1] != '\n')
+                append(alive & match, "\n", 1U);
+            appendNewlines(alive & ~match, spanLines);
+        }
+        if (last)
+            break;
+
+        ++lineno;
+        linenr = directive->line;
+        pos = (directive->end < filedata.size()) ? directive->end + 1 : filedata.size();
+        const std::string line(filedata, directive->offset, directive->end - directive->offset);
 
         // record directive for addons / checkers
         if ((line[0] == '#')
@@ -1822,34 +1969,40 @@ std::string Preprocessor::getcode(const std::string &filedata, const std::string
                                            orig_line));
         }
 
-        if (_settings.terminated())
-            return "";
+        if (_settings.terminated()) {
+            for (std::size_t i = 0; i < count; ++i)
+                result[first + i].complete = false;
+            return;
+        }
 
         if (line.compare(0, 11, "#pragma asm") == 0) {
-            ret << "\n";
-            bool found_end = false;
-            while (getline(istr, line)) {
-                if (line.compare(0, 14, "#pragma endasm") == 0) {
-                    found_end = true;
-                    break;
-                }
-
-                ret << "\n";
-            }
-            if (!found_end)
+            // the lines up to "#pragma endasm" are not counted in lineno
+            appendNewlines(alive, 1U);
+            std::vector<DirectiveIndex::Entry>::const_iterator endasm = directive + 1;
+            while (endasm != entries.end() && filedata.compare(endasm->offset, 14, "#pragma endasm") != 0)
+                ++endasm;
+            if (endasm == entries.end()) {
+                appendNewlines(alive, index.lines() - directive->line);
                 break;
+            }
+            appendNewlines(alive, endasm->line - directive->line - 1U);
+            directive = endasm;
+            linenr = directive->line;
+            pos = (directive->end < filedata.size()) ? directive->end + 1 : filedata.size();
+            std::string endline(filedata, directive->offset, directive->end - directive->offset);
 
-            if (line.find('=') != std::string::npos) {
+            if (endline.find('=') != std::string::npos) {
                 Tokenizer tokenizer(&_settings, _errorLogger);
-                line.erase(0, sizeof("#pragma endasm"));
-                std::istringstream tempIstr(line);
+                endline.erase(0, sizeof("#pragma endasm"));
+                std::istringstream tempIstr(endline);
                 tokenizer.tokenize(tempIstr, "", "", true);
                 if (Token::Match(tokenizer.tokens(), "( %name% = %any% )")) {
-                    ret << "asm(" << tokenizer.tokens()->strAt(1) << ");";
+                    const std::string code("asm(" + tokenizer.tokens()->strAt(1) + ");");
+                    append(alive, code.data(), code.size());
                 }
             }
 
-            ret << "\n";
+            appendNewlines(alive, 1U);
 
             continue;
         }
@@ -1857,11 +2010,10 @@ std::string Preprocessor::getcode(const std::string &filedata, const std::string
         const std::string def = getdef(line, true);
         const std::string ndef = getdef(line, false);
 
-        const bool emptymatch = matching_ifdef.empty() || matched_ifdef.empty();
+        const bool emptymatch = levels.empty();
 
         if (line.compare(0, 8, "#define ") == 0) {
-            match = true;
-
+            bool undefined = false;
 
             typedef std::set<std::string>::const_iterator It;
             for (It it = _settings.userUndefs.begin(); it != _settings.userUndefs.end(); ++it) {
@@ -1875,118 +2027,112 @@ std::string Preprocessor::getcode(const std::string &filedata, const std::string
                 if ((line.size() == behindUndefPos) ||
                     (line[behindUndefPos] == ' ') ||
                     (line[behindUndefPos] == '(')) {
-                    match = false;
+                    undefined = true;
                     break;
                 }
             }
 
-            if (match) {
-                for (std::list<bool>::const_iterator it = matching_ifdef.begin(); it != matching_ifdef.end(); ++it) {
-                    if (!bool(*it)) {
-                        match = false;
-                        break;
-                    }
-                }
-            }
-
-            if (match) {
+            const Mask defined = undefined ? 0 : (alive & (levels.empty() ? all : (levels.back().outer & levels.back().matching)));
+            if (defined) {
                 const std::string::size_type pos = line.find_first_of(" (", 8);
-                if (pos == std::string::npos)
-                    cfgmap[line.substr(8)] = "";
-                else if (line[pos] == ' ') {
-                    std::string value(line.substr(pos + 1));
-                    std::map<std::string, std::string>::const_iterator cfgpos = cfgmap.find(value);
-                    if (cfgpos != cfgmap.end())
-                        value = cfgpos->second;
-                    cfgmap[line.substr(8, pos - 8)] = value;
-                } else
-                    cfgmap[line.substr(8, pos - 8)] = "";
+                const std::string name(pos == std::string::npos ? line.substr(8) : line.substr(8, pos - 8));
+                const bool hasValue = (pos != std::string::npos && line[pos] == ' ');
+                const std::string value(hasValue ? line.substr(pos + 1) : std::string());
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (!(defined & (Mask(1) << i)))
+                        continue;
+                    std::map<std::string, std::string> &cfgmap = macros[i].cfgmap;
+                    const std::map<std::string, std::string>::const_iterator cfgpos = hasValue ? cfgmap.find(value) : cfgmap.end();
+                    cfgmap[name] = (cfgpos != cfgmap.end()) ? cfgpos->second : value;
+                    macros[i].simplified = false;
+                }
             }
         }
 
         else if (line.compare(0, 7, "#undef ") == 0) {
             const std::string name(line.substr(7));
-            cfgmap.erase(name);
+            for (std::size_t i = 0; i < count; ++i) {
+                if (macros[i].cfgmap.erase(name))
+                    macros[i].simplified = false;
+            }
         }
 
         else if (!emptymatch && line.compare(0, 7, "#elif !") == 0) {
-            if (matched_ifdef.back()) {
-                matching_ifdef.back() = false;
-            } else {
-                if (!match_cfg_def(cfgmap, ndef)) {
-                    matching_ifdef.back() = true;
-                    matched_ifdef.back() = true;
-                }
-            }
+            Level &level = levels.back();
+            const Mask candidates = alive & level.outer & ~level.matched;
+            const Mask evaluated = candidates & ~evaluate(candidates, ndef);
+            level.matching = ~level.matched & (level.matching | evaluated);
+            level.matched |= evaluated;
         }
 
         else if (!emptymatch && line.compare(0, 6, "#elif ") == 0) {
-            if (matched_ifdef.back()) {
-                matching_ifdef.back() = false;
-            } else {
-                if (match_cfg_def(cfgmap, def)) {
-                    matching_ifdef.back() = true;
-                    matched_ifdef.back() = true;
-                }
-            }
+            Level &level = levels.back();
+            const Mask evaluated = evaluate(alive & level.outer & ~level.matched, def);
+            level.matching = ~level.matched & (level.matching | evaluated);
+            level.matched |= evaluated;
         }
 
         else if (line.compare(0,4,"#if ") == 0) {
-            matching_ifdef.push_back(match_cfg_def(cfgmap, line.substr(4)));
-            matched_ifdef.push_back(matching_ifdef.back());
-        }
-
-        else if (! def.empty()) {
-            matching_ifdef.push_back(cfgmap.find(def) != cfgmap.end());
-            matched_ifdef.push_back(matching_ifdef.back());
+            Level level;
+            level.outer = levels.empty() ? all : (levels.back().outer & levels.back().matching);
+            level.matching = evaluate(alive & level.outer, line.substr(4));
+            level.matched = level.matching;
+            levels.push_back(level);
         }
 
-        else if (! ndef.empty()) {
-            matching_ifdef.push_back(cfgmap.find(ndef) == cfgmap.end());
-            matched_ifdef.push_back(matching_ifdef.back());
+        else if (! def.empty() || ! ndef.empty()) {
+            Level level;
+            level.outer = levels.empty() ? all : (levels.back().outer & levels.back().matching);
+            level.matching = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                const std::map<std::string, std::string> &cfgmap = macros[i].cfgmap;
+                if (! def.empty() ? (cfgmap.find(def) != cfgmap.end()) : (cfgmap.find(ndef) == cfgmap.end()))
+                    level.matching |= Mask(1) << i;
+            }
+            level.matched = level.matching;
+            levels.push_back(level);
         }
 
         else if (!emptymatch && line == "#else") {
-            if (! matched_ifdef.empty())
-                matching_ifdef.back() = ! matched_ifdef.back();
+            levels.back().matching = ~levels.back().matched;
         }
 
         else if (line.compare(0, 6, "#endif") == 0) {
-            if (! matched_ifdef.empty())
-                matched_ifdef.pop_back();
-            if (! matching_ifdef.empty())
-                matching_ifdef.pop_back();
+            if (!levels.empty())
+                levels.pop_back();
         }
 
-        if (!line.empty() && line[0] == '#') {
-            match = true;
-            for (std::list<bool>::const_iterator it = matching_ifdef.begin(); it != matching_ifdef.end(); ++it) {
-                if (!bool(*it)) {
-                    match = false;
-                    break;
-                }
-            }
-        }
+        match = levels.empty() ? all : (levels.back().outer & levels.back().matching);
 
-        // #error => return ""
-        if (match && line.compare(0, 6, "#error") == 0) {
-            if (!_settings.userDefines.empty() && !_settings.force) {
-                error(Path::simplifyPath(filenames.top()), lineno, line);
+        // #error => the configuration is not checked
+        if ((alive & match) && line.compare(0, 6, "#error") == 0) {
+            const bool report = !_settings.userDefines.empty() && !_settings.force;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!(alive & match & (Mask(1) << i)))
+                    continue;
+                ConfigurationCode &code = result[first + i];
+                code.complete = false;
+                code.code.clear();
+                if (report) {
+                    code.error = line;
+                    code.errorFile = Path::simplifyPath(filenames.top());
+                    code.errorLine = lineno;
+                }
             }
-            return "";
+            alive &= ~match;
         }
 
-        if (!match && (line.compare(0, 8, "#define ") == 0 ||
-                       line.compare(0, 6, "#undef") == 0)) {
+        if (line.compare(0, 8, "#define ") == 0 ||
+            line.compare(0, 6, "#undef") == 0) {
             // Remove define that is not part of this configuration
-            line = "";
+            append(alive & match, line.data(), line.size());
         } else if (line.compare(0, 7, "#file \"") == 0 ||
                    line.compare(0, 8, "#endfile") == 0 ||
-                   line.compare(0, 8, "#define ") == 0 ||
-                   line.compare(0, 6, "#line ") == 0 ||
-                   line.compare(0, 6, "#undef") == 0) {
+                   line.compare(0, 6, "#line ") == 0) {
             // We must not remove #file tags or line numbers
             // are corrupted. File tags are removed by the tokenizer.
+            append(alive, line.data(), line.size());
 
             // Keep location info updated
             if (line.compare(0, 7, "#file \"") == 0) {
@@ -2002,21 +2148,12 @@ std::string Preprocessor::getcode(const std::string &filedata, const std::string
                     lineNumbers.pop();
                 }
             }
-        } else if (!match || line.compare(0, 1, "#") == 0) {
-            // Remove #if, #else, #pragma etc, leaving only
-            // #define, #undef, #file and #endfile. and also lines
-            // which are not part of this configuration.
-            line = "";
         }
+        // Remove #if, #else, #pragma etc, leaving only
+        // #define, #undef, #file and #endfile.
 
-        ret << line << "\n";
+        appendNewlines(alive, 1U);
     }
-
-    if (!validateCfg(ret.str(), cfg)) {
-        return "";
-    }
-
-    return expandMacros(ret.str(), filename, cfg, _errorLogger);
 }
 
 void Preprocessor::error(const std::string &filename, unsigned int linenr, const std::string &msg)
@@ -2061,41 +2198,87 @@ Preprocessor::HeaderTypes Preprocessor::getHeaderFileName(std::string &str)
     return (c == '\"') ? UserHeader : SystemHeader;
 }
 
-/**
- * Try to open header
- * @param filename header name (in/out)
- * @param includePaths paths where to look for the file
- * @param filePath path to the header file
- * @param fin file input stream (in/out)
- * @return if file is opened then true is returned
- */
-static bool openHeader(std::string &filename, const std::list<std::string> &includePaths, const std::string &filePath, std::ifstream &fin)
-{
-    fin.open((filePath + filename).c_str());
-    if (fin.is_open()) {
-        filename = filePath + filename;
-        return true;
-    }
+namespace {
+    /** @brief Passes the messages on and records the errors, see Preprocessor::readHeader() */
+    class HeaderErrorRecorder : public ErrorLogger {
+    public:
+        HeaderErrorRecorder(ErrorLogger *errorLogger, std::list<ErrorLogger::ErrorMessage> &errors) : _errorLogger(errorLogger), _errors(errors) {
+        }
 
-    fin.open(filename.c_str());
-    if (fin.is_open())
-        return true;
+        virtual void reportOut(const std::string &outmsg) {
+            if (_errorLogger)
+                _errorLogger->reportOut(outmsg);
+        }
 
-    for (std::list<std::string>::const_iterator iter = includePaths.begin(); iter != includePaths.end(); ++iter) {
-        const std::string nativePath(Path::toNativeSeparators(*iter));
-        fin.open((nativePath + filename).c_str());
-        if (fin.is_open()) {
-            filename = nativePath + filename;
-            return true;
+        virtual void reportErr(const ErrorLogger::ErrorMessage &msg) {
+            _errors.push_back(msg);
+            if (_errorLogger)
+                _errorLogger->reportErr(msg);
         }
-        fin.clear();
-    }
 
-    return false;
+        virtual void reportInfo(const ErrorLogger::ErrorMessage &msg) {
+            _errors.push_back(msg);
+            if (_errorLogger)
+                _errorLogger->reportInfo(msg);
+        }
+
+        virtual void reportProgress(const std::string &filename, const char stage[], const std::size_t value) {
+            if (_errorLogger)
+                _errorLogger->reportProgress(filename, stage, value);
+        }
+
+    private:
+        ErrorLogger * const _errorLogger;
+        std::list<ErrorLogger::ErrorMessage> &_errors;
+    };
+}
+
+std::shared_ptr<const HeaderCache::Header> Preprocessor::readHeader(const std::string &filename)
+{
+    // Inline suppressions and fall through comments are added to the
+    // settings while reading, and --check-config reads differently
+    const bool cacheable = !_settings.checkConfiguration &&
+                           !_settings.inlineSuppressions &&
+                           !(_settings.experimental && _settings.isEnabled("style"));
+
+    HeaderCache &cache = HeaderCache::instance();
+    HeaderCache::Stamp stamp;
+    if (cacheable) {
+        const std::shared_ptr<const HeaderCache::Header> cached = cache.find(filename, stamp);
+        if (cached) {
+            for (std::list<ErrorLogger::ErrorMessage>::const_iterator it = cached->errors.begin(); it != cached->errors.end(); ++it) {
+                if (_errorLogger)
+                    _errorLogger->reportErr(*it);
+            }
+            return cached;
+        }
+    }
+
+    std::list<ErrorLogger::ErrorMessage> errors;
+    HeaderErrorRecorder recorder(_errorLogger, errors);
+    ErrorLogger * const errorLogger = _errorLogger;
+    _errorLogger = &recorder;
+    const MappedFile file(filename);
+    const std::shared_ptr<HeaderCache::Header> header = std::make_shared<HeaderCache::Header>(read(file.data(), file.size(), filename));
+    _errorLogger = errorLogger;
+    header->errors.swap(errors);
+
+    if (cacheable && !_settings.terminated())
+        cache.store(filename, stamp, header);
+    return header;
 }
 
+std::string Preprocessor::handleIncludes(const std::string &code, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, const std::list<std::string> &includes)
+{
+    std::vector<std::string> includeStack(includes.begin(), includes.end());
+    std::string ret;
+    ret.reserve(code.size());
+    if (!includeHeaders(code, DirectiveIndex(code), filePath, includePaths, defs, pragmaOnce, includeStack, ret) || _settings.terminated())
+        return "";
+    return ret;
+}
 
-std::string Preprocessor::handleIncludes(const std::string &code, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, std::list<std::string> includes)
+bool Preprocessor::includeHeaders(const std::string &code, const DirectiveIndex &index, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, std::vector<std::string> &includes, std::string &out)
 {
     std::string path;
     std::string::size_type sep_pos = filePath.find_last_of("\\/");
@@ -2112,22 +2295,39 @@ std::string Preprocessor::handleIncludes(const std::string &code, const std::str
     // then no more #elif or #else can be true before the #endif is seen.
     std::stack<bool> elseIsTrueStack;
 
-    unsigned int linenr = 0;
-
     const std::set<std::string> &undefs = _settings.userUndefs;
 
     if (_errorLogger)
         _errorLogger->reportProgress(filePath, "Preprocessor (handleIncludes)", 0);
 
-    std::ostringstream ostr;
-    std::istringstream istr(code);
-    std::string line;
     bool suppressCurrentCodePath = false;
-    while (std::getline(istr,line)) {
-        ++linenr;
+
+    // The code between the directives is copied or skipped as a whole
+    std::size_t pos = 0;
+    unsigned int linenr = 0;
+    const std::vector<DirectiveIndex::Entry> &directives = index.entries();
+    for (std::vector<DirectiveIndex::Entry>::const_iterator directive = directives.begin(); ; ++directive) {
+        const bool last = (directive == directives.end());
+        const std::size_t spanEnd = last ? code.size() : directive->offset;
+        const unsigned int spanLines = (last ? index.lines() + 1U : directive->line) - linenr - 1U;
+        if (spanLines > 0) {
+            if (indentmatch == indent && !suppressCurrentCodePath) {
+                out.append(code, pos, spanEnd - pos);
+                if (code[spanEnd - 1] != '\n')
+                    out += '\n';
+            } else {
+                out.append(spanLines, '\n');
+            }
+        }
+        if (last)
+            break;
+
+        linenr = directive->line;
+        pos = (directive->end < code.size()) ? directive->end + 1 : code.size();
+        const std::string line(code, directive->offset, directive->end - directive->offset);
 
         if (_settings.terminated())
-            return "";
+            return false;
 
         // has there been a true #if condition at the current indentmatch level?
         // then no more #elif or #else can be true before the #endif is seen.
@@ -2141,7 +2341,7 @@ std::string Preprocessor::handleIncludes(const std::string &code, const std::str
 
         if (elseIsTrueStack.empty()) {
             writeError(filePath, linenr, _errorLogger, "syntaxError", "Syntax error in preprocessor code");
-            return "";
+            return false;
         }
 
         std::stack<bool>::reference elseIsTrue = elseIsTrueStack.top();
@@ -2257,28 +2457,27 @@ std::string Preprocessor::handleIncludes(const std::string &code, const std::str
 
                 const HeaderTypes headerType = getHeaderFileName(filename);
                 if (headerType == NoHeader) {
-                    ostr << std::endl;
+                    out += '\n';
                     continue;
                 }
 
-                // try to open file
+                // find the file
                 std::string filepath;
                 if (headerType == UserHeader)
                     filepath = path;
-                std::ifstream fin;
-                if (!openHeader(filename, includePaths, filepath, fin)) {
+                if (!HeaderCache::instance().resolve(filename, includePaths, filepath)) {
                     missingInclude(Path::toNativeSeparators(filePath),
                                    linenr,
                                    filename,
                                    headerType
                                   );
-                    ostr << std::endl;
+                    out += '\n';
                     continue;
                 }
 
                 // Prevent that files are recursively included
                 if (std::find(includes.begin(), includes.end(), filename) != includes.end()) {
-                    ostr << std::endl;
+                    out += '\n';
                     continue;
                 }
 
@@ -2287,25 +2486,31 @@ std::string Preprocessor::handleIncludes(const std::string &code, const std::str
 
                 // Don't include header if it's already included and contains #pragma once
                 if (pragmaOnce.find(filename) != pragmaOnce.end()) {
-                    ostr << std::endl;
+                    out += '\n';
                     continue;
                 }
 
-                ostr << "#file \"" << filename << "\"\n"
-                     << handleIncludes(read(fin, filename), filename, includePaths, defs, pragmaOnce, includes) << std::endl
-                     << "#endfile\n";
+                const std::shared_ptr<const HeaderCache::Header> header = readHeader(filename);
+                out += "#file \"" + filename + "\"\n";
+                const std::size_t headerStart = out.size();
+                const std::size_t includesSize = includes.size();
+                if (!includeHeaders(header->code, header->directives, filename, includePaths, defs, pragmaOnce, includes, out))
+                    out.erase(headerStart);
+                // the includes of the header are forgotten when it is left
+                includes.resize(includesSize);
+                out += "\n#endfile\n";
                 continue;
             }
 
             if (!suppressCurrentCodePath)
-                ostr << line;
+                out += line;
         }
 
         // A line has been read..
-        ostr << "\n";
+        out += '\n';
     }
 
-    return ostr.str();
+    return true;
 }
 
 
@@ -2358,8 +2563,7 @@ void Preprocessor::handleIncludes(std::string &code, const std::string &filePath
         std::string filepath;
         if (headerType == UserHeader && !paths.empty())
             filepath = paths.back();
-        std::ifstream fin;
-        const bool fileOpened(openHeader(filename, includePaths, filepath, fin));
+        const bool fileOpened(HeaderCache::instance().resolve(filename, includePaths, filepath));
 
         if (fileOpened) {
             filename = Path::simplifyPath(filename);
@@ -2368,13 +2572,11 @@ void Preprocessor::handleIncludes(std::string &code, const std::string &filePath
             if (handledFiles.find(tempFile) != handledFiles.end()) {
                 // We have processed this file already once, skip
                 // it this time to avoid eternal loop.
-                fin.close();
                 continue;
             }
 
             handledFiles.insert(tempFile);
-            processedFile = Preprocessor::read(fin, filename);
-            fin.close();
+            processedFile = readHeader(filename)->code;
         }
 
         if (!processedFile.empty()) {
@@ -2426,9 +2628,9 @@ void Preprocessor::missingInclude(const std::string &filename, unsigned int line
         return;
 
     if (headerType == SystemHeader)
-        missingSystemIncludeFlag = true;
+        _missingIncludes.system = true;
     else
-        missingIncludeFlag = true;
+        _missingIncludes.user = true;
     if (_errorLogger && _settings.checkConfiguration) {
 
         std::list<ErrorLogger::ErrorMessage::FileLocation> locationList;
@@ -2521,7 +2723,7 @@ static void getparams(const std::string &line,
             skipstring(line, pos);
             if (pos == line.length())
                 break;
-            par += line.substr(p, pos + 1 - p);
+            par.append(line, p, pos + 1 - p);
             continue;
         }
 
@@ -2552,11 +2754,50 @@ static void getparams(const std::string &line,
     }
 }
 
+class PreprocessorMacro;
+
+/** @brief The defined macros, by name */
+typedef std::unordered_map<std::string, PreprocessorMacro *> MacroTable;
+
 /** @brief Class that the preprocessor uses when it expands macros. This class represents a preprocessor macro */
 class PreprocessorMacro {
 private:
-    /** tokens of this macro */
-    TokenList tokenlist;
+    /**
+     * @brief One token of the replacement list, after the ')' of the
+     * parameter list. The macro is parsed once when it is defined, the
+     * expansion only fills in the parameters.
+     */
+    struct Part {
+        Part() : param(-1), nameOrHash(false), stringify(false), concat(false), concatBefore(false), optcomma(false), spaceAfter(false) {
+        }
+
+        /** token, without the '#' of a stringified name */
+        std::string str;
+
+        /** index of the parameter that replaces str, -1 if none */
+        int param;
+
+        /** "#..." or a name */
+        bool nameOrHash;
+
+        /** "#name" */
+        bool stringify;
+
+        /** "##" */
+        bool concat;
+
+        /** previous token is "##" */
+        bool concatBefore;
+
+        /** "," before "##" in a variadic macro */
+        bool optcomma;
+
+        /** a space must follow, so that names and numbers are not glued */
+        bool spaceAfter;
+    };
+
+    /** name of macro */
+    std::string _name;
 
     /** macro parameters */
     std::vector<std::string> _params;
@@ -2564,41 +2805,52 @@ private:
     /** macro definition in plain text */
     const std::string _macro;
 
+    /** replacement list of a macro with parameters */
+    std::vector<Part> _parts;
+
+    /** replacement text of a macro without parameters */
+    std::string _body;
+
+    /** the definition after the name, from the first space */
+    std::string _textAfterName;
+
+    /** the definition contains a '(' */
+    bool _hasParentheses;
+
     /** does this macro take a variable number of parameters? */
     bool _variadic;
 
     /** The macro has parentheses but no parameters.. "AAA()" */
     bool _nopar;
 
+    /** "A(x,y) B(x,y)": name of the macro B that is expanded in the parameters, and its number of parameters */
+    std::string _innerMacroName;
+    std::size_t _innerMacroParams;
+
     /** disabled assignment operator */
     void operator=(const PreprocessorMacro &);
 
+    /** @brief Lookup a macro that is not in the hide set */
+    static const PreprocessorMacro *find(const MacroTable &macros, const std::vector<const PreprocessorMacro *> &hidden, const std::string &name) {
+        const MacroTable::const_iterator it = macros.find(name);
+        if (it == macros.end() || std::find(hidden.begin(), hidden.end(), it->second) != hidden.end())
+            return nullptr;
+        return it->second;
+    }
+
     /** @brief expand inner macro */
     std::vector<std::string> expandInnerMacros(const std::vector<std::string> &params1,
-            const std::map<std::string, PreprocessorMacro *> &macros) const {
-        std::string innerMacroName;
-
+            const MacroTable &macros,
+            std::vector<const PreprocessorMacro *> &hidden) const {
         // Is there an inner macro..
-        {
-            const Token *tok = Token::findsimplematch(tokens(), ")");
-            if (!Token::Match(tok, ") %name% ("))
-                return params1;
-            innerMacroName = tok->strAt(1);
-            tok = tok->tokAt(3);
-            unsigned int par = 0;
-            while (Token::Match(tok, "%name% ,|)")) {
-                tok = tok->tokAt(2);
-                par++;
-            }
-            if (tok || par != params1.size())
-                return params1;
-        }
+        if (_innerMacroName.empty() || _innerMacroParams != params1.size())
+            return params1;
 
         std::vector<std::string> params2(params1);
 
+        const std::string s(_innerMacroName + "(");
         for (std::size_t ipar = 0; ipar < params1.size(); ++ipar) {
-            const std::string s(innerMacroName + "(");
-            const std::string param(params1[ipar]);
+            const std::string &param(params1[ipar]);
             if (param.compare(0,s.length(),s)==0 && param.back() == ')') {
                 std::vector<std::string> innerparams;
                 std::string::size_type pos = s.length() - 1;
@@ -2607,15 +2859,13 @@ private:
                 getparams(param, pos, innerparams, num, endFound);
                 if (pos == param.length()-1 && num==0 && endFound && innerparams.size() == params1.size()) {
                     // Is inner macro defined?
-                    std::map<std::string, PreprocessorMacro *>::const_iterator it = macros.find(innerMacroName);
-                    if (it != macros.end()) {
-                        // expand the inner macro
-                        const PreprocessorMacro *innerMacro = it->second;
-
+                    const PreprocessorMacro *innerMacro = find(macros, hidden, _innerMacroName);
+                    if (innerMacro) {
+                        // expand the inner macro, it is hidden from its own expansion
                         std::string innercode;
-                        std::map<std::string,PreprocessorMacro *> innermacros = macros;
-                        innermacros.erase(innerMacroName);
-                        innerMacro->code(innerparams, innermacros, innercode);
+                        hidden.push_back(innerMacro);
+                        innerMacro->code(innerparams, macros, hidden, innercode);
+                        hidden.pop_back();
                         params2[ipar] = innercode;
                     }
                 }
@@ -2634,20 +2884,29 @@ public:
      * @param [in] settings Current settings being used
      */
     PreprocessorMacro(const std::string &macro, const Settings* settings)
-        : tokenlist(settings), _macro(macro) {
+        : _macro(macro), _innerMacroParams(0) {
 
         // Tokenize the macro to make it easier to handle
+        TokenList tokenlist(settings);
         std::istringstream istr(macro);
         tokenlist.createTokens(istr);
+        const Token * const tokens = tokenlist.front();
+        if (tokens)
+            _name = tokens->str();
 
         // initialize parameters to default values
         _variadic = _nopar = false;
+        _hasParentheses = (macro.find('(') != std::string::npos);
+
+        const std::string::size_type whitespacePos = macro.find(' ');
+        if (whitespacePos != std::string::npos)
+            _textAfterName = macro.substr(whitespacePos);
 
         const std::string::size_type pos = macro.find_first_of(" (");
         if (pos != std::string::npos && macro[pos] == '(') {
             // Extract macro parameters
-            if (Token::Match(tokens(), "%name% ( %name%")) {
-                for (const Token *tok = tokens()->tokAt(2); tok; tok = tok->next()) {
+            if (Token::Match(tokens, "%name% ( %name%")) {
+                for (const Token *tok = tokens->tokAt(2); tok; tok = tok->next()) {
                     if (tok->str() == ")")
                         break;
                     if (Token::simpleMatch(tok, ". . . )")) {
@@ -2661,17 +2920,81 @@ public:
                 }
             }
 
-            else if (Token::Match(tokens(), "%name% ( . . . )"))
+            else if (Token::Match(tokens, "%name% ( . . . )"))
                 _variadic = true;
 
-            else if (Token::Match(tokens(), "%name% ( )"))
+            else if (Token::Match(tokens, "%name% ( )"))
                 _nopar = true;
         }
-    }
 
-    /** return tokens of this macro */
-    const Token *tokens() const {
-        return tokenlist.front();
+        if (_nopar || (_params.empty() && _variadic)) {
+            _body = _macro.substr(1 + _macro.find(')'));
+            if (!_body.empty()) {
+                std::string::size_type pos2 = 0;
+                // Remove leading spaces
+                if ((pos2 = _body.find_first_not_of(" ")) > 0)
+                    _body.erase(0, pos2);
+                // Remove ending newline
+                if ((pos2 = _body.find_first_of("\r\n")) != std::string::npos)
+                    _body.erase(pos2);
+            }
+        }
+
+        else if (_params.empty()) {
+            std::string::size_type pos2 = _macro.find_first_of(" \"");
+            if (pos2 != std::string::npos) {
+                if (_macro[pos2] == ' ')
+                    pos2++;
+                _body = _macro.substr(pos2);
+                if ((pos2 = _body.find_first_of("\r\n")) != std::string::npos)
+                    _body.erase(pos2);
+            }
+        }
+
+        else {
+            const Token *tok = Token::findsimplematch(tokens, ")");
+
+            // Is there an inner macro..
+            if (Token::Match(tok, ") %name% (")) {
+                const Token *inner = tok->tokAt(3);
+                std::size_t par = 0;
+                while (Token::Match(inner, "%name% ,|)")) {
+                    inner = inner->tokAt(2);
+                    par++;
+                }
+                if (!inner) {
+                    _innerMacroName = tok->strAt(1);
+                    _innerMacroParams = par;
+                }
+            }
+
+            // compile the replacement list
+            if (tok) {
+                while (nullptr != (tok = tok->next())) {
+                    Part part;
+                    part.str = tok->str();
+                    part.concatBefore = (tok->strAt(-1) == "##");
+                    part.spaceAfter = Token::Match(tok, "%name% %name%|%num%") ||
+                                      Token::Match(tok, "%num% %name%") ||
+                                      Token::simpleMatch(tok, "> >");
+                    if (part.str[0] == '#' || tok->isName()) {
+                        part.nameOrHash = true;
+                        part.concat = (part.str == "##");
+                        part.stringify = (part.str[0] == '#' && !part.concat);
+                        if (part.stringify)
+                            part.str.erase(0, 1);
+                        for (std::size_t i = 0; i < _params.size(); ++i) {
+                            if (part.str == _params[i]) {
+                                part.param = (int)i;
+                                break;
+                            }
+                        }
+                    }
+                    part.optcomma = _variadic && tok->str() == "," && tok->next() && tok->next()->str() == "##";
+                    _parts.push_back(part);
+                }
+            }
+        }
     }
 
     /** read parameters of this macro */
@@ -2691,30 +3014,23 @@ public:
 
     /** name of macro */
     const std::string &name() const {
-        return tokens() ? tokens()->str() : emptyString;
+        return _name;
     }
 
     /**
      * get expanded code for this macro
      * @param params2 macro parameters
      * @param macros macro definitions (recursion)
+     * @param hidden macros that must not be expanded (recursion)
      * @param macrocode output string
      * @return true if the expanding was successful
      */
-    bool code(const std::vector<std::string> &params2, const std::map<std::string, PreprocessorMacro *> &macros, std::string &macrocode) const {
+    bool code(const std::vector<std::string> &params2, const MacroTable &macros, std::vector<const PreprocessorMacro *> &hidden, std::string &macrocode) const {
         if (_nopar || (_params.empty() && _variadic)) {
-            macrocode = _macro.substr(1 + _macro.find(')'));
+            macrocode = _body;
             if (macrocode.empty())
                 return true;
 
-            std::string::size_type pos = 0;
-            // Remove leading spaces
-            if ((pos = macrocode.find_first_not_of(" ")) > 0)
-                macrocode.erase(0, pos);
-            // Remove ending newline
-            if ((pos = macrocode.find_first_of("\r\n")) != std::string::npos)
-                macrocode.erase(pos);
-
             // Replace "__VA_ARGS__" with parameters
             if (!_nopar) {
                 std::string s;
@@ -2724,106 +3040,76 @@ public:
                     s += params2[i];
                 }
 
-                pos = 0;
+                std::string::size_type pos = 0;
                 while ((pos = macrocode.find("__VA_ARGS__", pos)) != std::string::npos) {
-                    macrocode.erase(pos, 11);
-                    macrocode.insert(pos, s);
+                    macrocode.replace(pos, 11, s);
                     pos += s.length();
                 }
             }
         }
 
         else if (_params.empty()) {
-            std::string::size_type pos = _macro.find_first_of(" \"");
-            if (pos == std::string::npos)
-                macrocode = "";
-            else {
-                if (_macro[pos] == ' ')
-                    pos++;
-                macrocode = _macro.substr(pos);
-                if ((pos = macrocode.find_first_of("\r\n")) != std::string::npos)
-                    macrocode.erase(pos);
-            }
+            macrocode = _body;
         }
 
         else {
-            const std::vector<std::string> givenparams = expandInnerMacros(params2, macros);
+            const std::vector<std::string> givenparams = expandInnerMacros(params2, macros, hidden);
 
-            const Token *tok = tokens();
-            while (tok && tok->str() != ")")
-                tok = tok->next();
-            if (tok) {
-                bool optcomma = false;
-                while (nullptr != (tok = tok->next())) {
-                    std::string str = tok->str();
-                    if (str[0] == '#' || tok->isName()) {
-                        if (str == "##")
-                            continue;
-
-                        const bool stringify(str[0] == '#');
-                        if (stringify) {
-                            str = str.erase(0, 1);
-                        }
-                        for (std::size_t i = 0; i < _params.size(); ++i) {
-                            if (str == _params[i]) {
-                                if (_variadic &&
-                                    (i == _params.size() - 1 ||
-                                     (givenparams.size() + 2 == _params.size() && i + 1 == _params.size() - 1))) {
-                                    str = "";
-                                    for (std::size_t j = _params.size() - 1; j < givenparams.size(); ++j) {
-                                        if (optcomma || j > _params.size() - 1)
-                                            str += ",";
-                                        optcomma = false;
-                                        str += givenparams[j];
-                                    }
-                                } else if (i >= givenparams.size()) {
-                                    // Macro had more parameters than caller used.
-                                    macrocode = "";
-                                    return false;
-                                } else if (stringify) {
-                                    const std::string &s(givenparams[i]);
-                                    std::ostringstream ostr;
-                                    ostr << "\"";
-                                    for (std::string::size_type j = 0; j < s.size(); ++j) {
-                                        if (s[j] == '\\' || s[j] == '\"')
-                                            ostr << '\\';
-                                        ostr << s[j];
-                                    }
-                                    str = ostr.str() + "\"";
-                                } else
-                                    str = givenparams[i];
+            bool optcomma = false;
+            std::string str;
+            for (std::vector<Part>::const_iterator part = _parts.begin(); part != _parts.end(); ++part) {
+                str = part->str;
+                if (part->nameOrHash) {
+                    if (part->concat)
+                        continue;
 
-                                break;
+                    if (part->param >= 0) {
+                        const std::size_t i = (std::size_t)part->param;
+                        if (_variadic &&
+                            (i == _params.size() - 1 ||
+                             (givenparams.size() + 2 == _params.size() && i + 1 == _params.size() - 1))) {
+                            str = "";
+                            for (std::size_t j = _params.size() - 1; j < givenparams.size(); ++j) {
+                                if (optcomma || j > _params.size() - 1)
+                                    str += ",";
+                                optcomma = false;
+                                str += givenparams[j];
                             }
-                        }
-
-                        // expand nopar macro
-                        if (tok->strAt(-1) != "##") {
-                            const std::map<std::string, PreprocessorMacro *>::const_iterator it = macros.find(str);
-                            if (it != macros.end() && it->second->_macro.find('(') == std::string::npos) {
-                                const std::string& macro = it->second->_macro;
-                                const std::string::size_type whitespacePos = macro.find(' ');
-                                if (whitespacePos != std::string::npos)
-                                    str = macro.substr(whitespacePos);
-                                else
-                                    str = "";
+                        } else if (i >= givenparams.size()) {
+                            // Macro had more parameters than caller used.
+                            macrocode = "";
+                            return false;
+                        } else if (part->stringify) {
+                            const std::string &s(givenparams[i]);
+                            str = "\"";
+                            for (std::string::size_type j = 0; j < s.size(); ++j) {
+                                if (s[j] == '\\' || s[j] == '\"')
+                                    str += '\\';
+                                str += s[j];
                             }
-                        }
+                            str += '\"';
+                        } else
+                            str = givenparams[i];
                     }
-                    if (_variadic && tok->str() == "," && tok->next() && tok->next()->str() == "##") {
-                        optcomma = true;
-                        continue;
+
+                    // expand nopar macro
+                    if (!part->concatBefore) {
+                        const PreprocessorMacro *macro = find(macros, hidden, str);
+                        if (macro && !macro->_hasParentheses)
+                            str = macro->_textAfterName;
                     }
-                    optcomma = false;
-                    // separate ++ and -- with space
-                    if (!str.empty() && !macrocode.empty() && (str[0] == '+' || str[0] == '-') && str[0] == macrocode[macrocode.size()-1U])
-                        macrocode += ' ';
-                    macrocode += str;
-                    if (Token::Match(tok, "%name% %name%|%num%") ||
-                        Token::Match(tok, "%num% %name%") ||
-                        Token::simpleMatch(tok, "> >"))
-                        macrocode += ' ';
                 }
+                if (part->optcomma) {
+                    optcomma = true;
+                    continue;
+                }
+                optcomma = false;
+                // separate ++ and -- with space
+                if (!str.empty() && !macrocode.empty() && (str[0] == '+' || str[0] == '-') && str[0] == macrocode[macrocode.size()-1U])
+                    macrocode += ' ';
+                macrocode += str;
+                if (part->spaceAfter)
+                    macrocode += ' ';
             }
         }
 
@@ -2832,37 +3118,39 @@ public:
 };
 
 /**
- * Get data from a input string. This is an extended version of std::getline.
+ * Get data from the code. This is an extended version of std::getline.
  * The std::getline only get a single line at a time. It can therefore happen that it
  * contains a partial statement. This function ensures that the returned data
  * doesn't end in the middle of a statement. The "getlines" name indicate that
  * this function will return multiple lines if needed.
- * @param istr input stream
+ * @param code the code
+ * @param pos in: position where to start reading, out: position after the data
  * @param line output data
  * @return success
  */
-static bool getlines(std::istream &istr, std::string &line)
+static bool getlines(const std::string &code, std::string::size_type &pos, std::string &line)
 {
-    if (!istr.good())
+    if (pos >= code.size())
         return false;
     line = "";
     int parlevel = 0;
     bool directive = false;
-    for (char ch = (char)istr.get(); istr.good(); ch = (char)istr.get()) {
+    while (pos < code.size()) {
+        const char ch = code[pos++];
         if (ch == '\'' || ch == '\"') {
             line += ch;
             char c = 0;
-            while (istr.good() && c != ch) {
+            while (c != ch) {
                 if (c == '\\') {
-                    c = (char)istr.get();
-                    if (!istr.good())
+                    if (pos >= code.size())
                         return true;
+                    c = code[pos++];
                     line += c;
                 }
 
-                c = (char)istr.get();
-                if (!istr.good())
+                if (pos >= code.size())
                     return true;
+                c = code[pos++];
                 if (c == '\n' && directive)
                     return true;
                 line += c;
@@ -2877,7 +3165,7 @@ static bool getlines(std::istream &istr, std::string &line)
             if (directive)
                 return true;
 
-            if (istr.peek() == '#') {
+            if (pos < code.size() && code[pos] == '#') {
                 line += ch;
                 return true;
             }
@@ -2912,43 +3200,49 @@ bool Preprocessor::validateCfg(const std::string &code, const std::string &cfg)
             ++pos;
     }
 
-    // check if any empty macros are used in code
-    for (std::set<std::string>::const_iterator it = macros.begin(); it != macros.end(); ++it) {
-        const std::string &macro = *it;
-        std::string::size_type pos = 0;
-        while ((pos = code.find_first_of(std::string("#\"'")+macro[0], pos)) != std::string::npos) {
-            const std::string::size_type pos1 = pos;
-            const std::string::size_type pos2 = pos + macro.size();
-            pos++;
-
-            // skip string..
-            if (code[pos1] == '\"' || code[pos1] == '\'') {
-                while (pos < code.size() && code[pos] != code[pos1]) {
-                    if (code[pos] == '\\')
-                        ++pos;
+    if (macros.empty())
+        return true;
+
+    // check if any empty macros are used in code, look at each name once
+    std::set<std::string> used;
+    for (std::string::size_type pos = 0; pos < code.size();) {
+        const char ch = code[pos];
+
+        // skip string..
+        if (ch == '\"' || ch == '\'') {
+            ++pos;
+            while (pos < code.size() && code[pos] != ch) {
+                if (code[pos] == '\\')
                     ++pos;
-                }
                 ++pos;
             }
+            ++pos;
+        }
 
-            // skip preprocessor statement..
-            else if (code[pos1] == '#') {
-                if (pos1 == 0 || code[pos1-1] == '\n')
-                    pos = code.find('\n', pos);
-            }
+        // skip preprocessor statement..
+        else if (ch == '#' && (pos == 0 || code[pos-1] == '\n')) {
+            pos = code.find('\n', pos);
+        }
 
-            // is macro used in code?
-            else if (code.compare(pos1,macro.size(),macro) == 0) {
-                if (pos1 > 0 && (std::isalnum((unsigned char)code[pos1-1U]) || code[pos1-1U] == '_'))
-                    continue;
-                if (pos2 < code.size() && (std::isalnum((unsigned char)code[pos2]) || code[pos2] == '_'))
-                    continue;
-                // macro is used in code, return false
-                if (printInformation)
-                    validateCfgError(cfg, macro);
-                return false;
-            }
+        // name
+        else if (std::isalnum((unsigned char)ch) || ch == '_') {
+            const std::string::size_type start = pos;
+            while (pos < code.size() && (std::isalnum((unsigned char)code[pos]) || code[pos] == '_'))
+                ++pos;
+            const std::set<std::string>::const_iterator macro = macros.find(code.substr(start, pos - start));
+            if (macro != macros.end())
+                used.insert(*macro);
         }
+
+        else
+            ++pos;
+    }
+
+    if (!used.empty()) {
+        // macro is used in code, return false
+        if (printInformation)
+            validateCfgError(cfg, *used.begin());
+        return false;
     }
 
     return true;
@@ -2964,13 +3258,87 @@ void Preprocessor::validateCfgError(const std::string &cfg, const std::string &m
     _errorLogger->reportInfo(errmsg);
 }
 
+/**
+ * @brief Append the expanded code of a macro to the output, with a
+ * Preprocessor::macroChar before each symbol/nr/operator.
+ * @param macrocode expanded code of the macro
+ * @param out output
+ */
+static void appendMacroCode(const std::string &macrocode, std::string &out)
+{
+    const char macroChar = Preprocessor::macroChar;
+    const std::size_t size = macrocode.size();
+    const std::size_t outStart = out.size();
+    bool str = false;
+    bool chr = false;
+    for (std::size_t i = 0U; i < size; ++i) {
+        // the characters from start to i are copied as they are
+        const std::size_t start = i;
+        const char prev = (out.size() > outStart) ? out.back() : '\0';
+        if (macrocode[i] == '\\') {
+            i++;
+        } else if (macrocode[i] == '\"')
+            str = !str;
+        else if (macrocode[i] == '\'')
+            chr = !chr;
+        else if (str || chr)
+            ;
+        else if (macrocode[i] == '.') { // 5. / .5
+            if ((i > 0U && std::isdigit((unsigned char)prev)) ||
+                (i+1 < size && std::isdigit((unsigned char)macrocode[i+1]))) {
+                if (i > 0U && !std::isdigit((unsigned char)prev))
+                    out += macroChar;
+                i++;
+                if (i<size && std::isdigit((unsigned char)macrocode[i]))
+                    i++;
+                if (i+1U < size &&
+                    (macrocode[i] == 'e' || macrocode[i] == 'E') &&
+                    (macrocode[i+1] == '+' || macrocode[i+1] == '-')) {
+                    i+=2;
+                }
+            }
+        } else if (std::isalnum((unsigned char)macrocode[i]) || macrocode[i] == '_') {
+            if ((i > 0U)                        &&
+                (!std::isalnum((unsigned char)prev)) &&
+                (prev != '_')         &&
+                (prev != macroChar)) {
+                out += macroChar;
+            }
+
+            // 1e-7 / 1e+7
+            if (i+3U < size     &&
+                (std::isdigit((unsigned char)macrocode[i]) || macrocode[i]=='.')  &&
+                (macrocode[i+1] == 'e' || macrocode[i+1] == 'E')   &&
+                (macrocode[i+2] == '-' || macrocode[i+2] == '+')   &&
+                std::isdigit((unsigned char)macrocode[i+3])) {
+                i += 3U;
+            }
+
+            // 1.f / 1.e7
+            if (i+2U < size    &&
+                std::isdigit((unsigned char)macrocode[i]) &&
+                macrocode[i+1] == '.'      &&
+                std::isalpha((unsigned char)macrocode[i+2])) {
+                i += 2U;
+                if (i+2U < size &&
+                    (macrocode[i+0] == 'e' || macrocode[i+0] == 'E')   &&
+                    (macrocode[i+1] == '-' || macrocode[i+1] == '+')   &&
+                    std::isdigit((unsigned char)macrocode[i+2])) {
+                    i += 2U;
+                }
+            }
+        }
+        out.append(macrocode, start, std::min(i, size - 1U) + 1U - start);
+    }
+}
+
 std::string Preprocessor::expandMacros(const std::string &code, std::string filename, const std::string &cfg, ErrorLogger *errorLogger)
 {
     // Search for macros and expand them..
     // --------------------------------------------
 
     // Available macros (key=macroname, value=macro).
-    std::map<std::string, PreprocessorMacro *> macros;
+    MacroTable macros;
     const Settings settings;
 
     {
@@ -2992,13 +3360,20 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
     // linenr, filename
     std::stack< std::pair<unsigned int, std::string> > fileinfo;
 
-    // output stream
-    std::ostringstream ostr;
+    // output
+    std::string ret;
+    ret.reserve(code.size() + code.size() / 4U);
+
+    // expanded code of the current macro, with macro characters
+    std::string expanded;
+
+    // current identifier
+    std::string id;
 
     // read code..
-    std::istringstream istr(code);
+    std::string::size_type codePos = 0;
     std::string line;
-    while (getlines(istr, line)) {
+    while (getlines(code, codePos, line)) {
         if (line.empty())
             continue;
 
@@ -3013,8 +3388,7 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
                     // BOOST_FOREACH is currently too complex to parse, so skip it.
                     delete macro;
                 } else {
-                    std::map<std::string, PreprocessorMacro *>::iterator it;
-                    it = macros.find(macro->name());
+                    const MacroTable::iterator it = macros.find(macro->name());
                     if (it != macros.end())
                         delete it->second;
                     macros[macro->name()] = macro;
@@ -3024,8 +3398,7 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
 
             // undefining a macro..
             else if (line.compare(1, 6, "undef ") == 0) {
-                std::map<std::string, PreprocessorMacro *>::iterator it;
-                it = macros.find(line.substr(7));
+                const MacroTable::iterator it = macros.find(line.substr(7));
                 if (it != macros.end()) {
                     delete it->second;
                     macros.erase(it);
@@ -3073,7 +3446,9 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
             // * when pos goes beyond a limit the limit needs to be
             //   deleted because it is unsafe to insert/delete text
             //   after the limit otherwise
-            std::map<const PreprocessorMacro *, std::size_t> limits;
+            // The limits are the hide set of the line, there are only
+            // a few at a time.
+            std::vector<std::pair<const PreprocessorMacro *, std::size_t> > limits;
 
             // pos is the current position in line
             std::string::size_type pos = 0;
@@ -3098,8 +3473,7 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
                                    "noQuoteCharPair",
                                    std::string("No pair for character (") + ch + "). Can't process file. File is either invalid or unicode, which is currently not supported.");
 
-                        std::map<std::string, PreprocessorMacro *>::iterator it;
-                        for (it = macros.begin(); it != macros.end(); ++it)
+                        for (MacroTable::iterator it = macros.begin(); it != macros.end(); ++it)
                             delete it->second;
                         macros.clear();
                         return "";
@@ -3122,11 +3496,10 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
                         ++pos;
 
                     // get identifier
-                    const std::string id = line.substr(pos1, pos - pos1);
+                    id.assign(line, pos1, pos - pos1);
 
                     // is there a macro with this name?
-                    std::map<std::string, PreprocessorMacro *>::const_iterator it;
-                    it = macros.find(id);
+                    const MacroTable::const_iterator it = macros.find(id);
                     if (it == macros.end())
                         break;  // no macro with this name exist
 
@@ -3134,11 +3507,11 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
 
                     // check that pos is within allowed limits for this
                     // macro
-                    {
-                        const std::map<const PreprocessorMacro *, std::size_t>::const_iterator it2 = limits.find(macro);
-                        if (it2 != limits.end() && pos <= line.length() - it2->second)
-                            break;
-                    }
+                    std::vector<std::pair<const PreprocessorMacro *, std::size_t> >::iterator limit = limits.begin();
+                    while (limit != limits.end() && limit->first != macro)
+                        ++limit;
+                    if (limit != limits.end() && pos <= line.length() - limit->second)
+                        break;
 
                     // get parameters from line..
                     if (macro->params().size() && pos >= line.length())
@@ -3171,7 +3544,8 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
 
                     // Create macro code..
                     std::string tempMacro;
-                    if (!macro->code(params, macros, tempMacro)) {
+                    std::vector<const PreprocessorMacro *> hidden;
+                    if (!macro->code(params, macros, hidden, tempMacro)) {
                         // Syntax error in code
                         writeError(filename,
                                    linenr + tmpLinenr,
@@ -3179,8 +3553,7 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
                                    "syntaxError",
                                    std::string("Syntax error. Not enough parameters for macro '") + macro->name() + "'.");
 
-                        std::map<std::string, PreprocessorMacro *>::iterator iter;
-                        for (iter = macros.begin(); iter != macros.end(); ++iter)
+                        for (MacroTable::iterator iter = macros.begin(); iter != macros.end(); ++iter)
                             delete iter->second;
                         macros.clear();
                         return "";
@@ -3194,88 +3567,33 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
                         ++pos2;
 
                     // Remove old limits
-                    for (std::map<const PreprocessorMacro *, std::size_t>::iterator iter = limits.begin();
-                         iter != limits.end();) {
-                        if ((line.length() - pos1) < iter->second) {
+                    for (std::size_t i = 0; i < limits.size();) {
+                        if ((line.length() - pos1) < limits[i].second) {
                             // We have gone past this limit, so just delete it
-                            limits.erase(iter++);
+                            limits[i] = limits.back();
+                            limits.pop_back();
                         } else {
-                            ++iter;
+                            ++i;
                         }
                     }
 
                     // don't allow this macro to be expanded again before pos2
-                    limits[macro] = line.length() - pos2;
-
-                    // erase macro
-                    line.erase(pos1, pos2 - pos1);
+                    limit = limits.begin();
+                    while (limit != limits.end() && limit->first != macro)
+                        ++limit;
+                    if (limit != limits.end())
+                        limit->second = line.length() - pos2;
+                    else
+                        limits.push_back(std::make_pair(macro, line.length() - pos2));
 
                     // Don't glue this macro into variable or number after it
-                    if (!line.empty() && (std::isalnum((unsigned char)line[pos1]) || line[pos1] == '_'))
+                    if (pos2 < line.length() && (std::isalnum((unsigned char)line[pos2]) || line[pos2] == '_'))
                         macrocode.append(1,' ');
 
-                    // insert macrochar before each symbol/nr/operator
-                    bool str = false;
-                    bool chr = false;
-                    for (std::size_t i = 0U; i < macrocode.size(); ++i) {
-                        if (macrocode[i] == '\\') {
-                            i++;
-                            continue;
-                        } else if (macrocode[i] == '\"')
-                            str = !str;
-                        else if (macrocode[i] == '\'')
-                            chr = !chr;
-                        else if (str || chr)
-                            continue;
-                        else if (macrocode[i] == '.') { // 5. / .5
-                            if ((i > 0U && std::isdigit((unsigned char)macrocode[i-1])) ||
-                                (i+1 < macrocode.size() && std::isdigit((unsigned char)macrocode[i+1]))) {
-                                if (i > 0U && !std::isdigit((unsigned char)macrocode[i-1])) {
-                                    macrocode.insert(i, 1U, macroChar);
-                                    i++;
-                                }
-                                i++;
-                                if (i<macrocode.size() && std::isdigit((unsigned char)macrocode[i]))
-                                    i++;
-                                if (i+1U < macrocode.size() &&
-                                    (macrocode[i] == 'e' || macrocode[i] == 'E') &&
-                                    (macrocode[i+1] == '+' || macrocode[i+1] == '-')) {
-                                    i+=2;
-                                }
-                            }
-                        } else if (std::isalnum((unsigned char)macrocode[i]) || macrocode[i] == '_') {
-                            if ((i > 0U)                        &&
-                                (!std::isalnum((unsigned char)macrocode[i-1])) &&
-                                (macrocode[i-1] != '_')         &&
-                                (macrocode[i-1] != macroChar)) {
-                                macrocode.insert(i, 1U, macroChar);
-                            }
-
-                            // 1e-7 / 1e+7
-                            if (i+3U < macrocode.size()     &&
-                                (std::isdigit((unsigned char)macrocode[i]) || macrocode[i]=='.')  &&
-                                (macrocode[i+1] == 'e' || macrocode[i+1] == 'E')   &&
-                                (macrocode[i+2] == '-' || macrocode[i+2] == '+')   &&
-                                std::isdigit((unsigned char)macrocode[i+3])) {
-                                i += 3U;
-                            }
-
-                            // 1.f / 1.e7
-                            if (i+2U < macrocode.size()    &&
-                                std::isdigit((unsigned char)macrocode[i]) &&
-                                macrocode[i+1] == '.'      &&
-                                std::isalpha((unsigned char)macrocode[i+2])) {
-                                i += 2U;
-                                if (i+2U < macrocode.size() &&
-                                    (macrocode[i+0] == 'e' || macrocode[i+0] == 'E')   &&
-                                    (macrocode[i+1] == '-' || macrocode[i+1] == '+')   &&
-                                    std::isdigit((unsigned char)macrocode[i+2])) {
-                                    i += 2U;
-                                }
-                            }
-                        }
-                    }
-                    line.insert(pos1, macroChar + macrocode);
+                    // replace the macro use with the code, insert macrochar before each symbol/nr/operator
+                    expanded.assign(1U, macroChar);
+                    appendMacroCode(macrocode, expanded);
+                    line.replace(pos1, pos2 - pos1, expanded);
 
                     // position = start position.
                     pos = pos1;
@@ -3283,21 +3601,18 @@ std::string Preprocessor::expandMacros(const std::string &code, std::string file
             }
         }
 
-        // the line has been processed in various ways. Now add it to the output stream
-        ostr << line;
+        // the line has been processed in various ways. Now add it to the output
+        ret += line;
 
         // update linenr
-        for (std::string::size_type p = 0; p < line.length(); ++p) {
-            if (line[p] == '\n')
-                ++linenr;
-        }
+        linenr += (unsigned int)std::count(line.begin(), line.end(), '\n');
     }
 
-    for (std::map<std::string, PreprocessorMacro *>::iterator it = macros.begin(); it != macros.end(); ++it)
+    for (MacroTable::iterator it = macros.begin(); it != macros.end(); ++it)
         delete it->second;
     macros.clear();
 
-    return ostr.str();
+    return ret;
 }
 
 
@@ -6,7 +6,9 @@
 #include <string>
 #include <list>
 #include <set>
+#include <vector>
 #include "config.h"
+#include "headercache.h"
 
 class ErrorLogger;
 class Settings;
@@ -41,6 +43,31 @@ public:
 /// @addtogroup Core
 /// @{
 
+/**
+ * @brief Were include files not found? The preprocessor collects this for
+ * its translation unit, ZKCheck and the executors merge it for the run.
+ */
+class ZKCHECKLIB MissingIncludes {
+public:
+    MissingIncludes() : user(false), system(false) {
+    }
+
+    bool any() const {
+        return user || system;
+    }
+
+    void merge(const MissingIncludes &other) {
+        user = user || other.user;
+        system = system || other.system;
+    }
+
+    /** an include "file" was not found */
+    bool user;
+
+    /** an include <file> was not found */
+    bool system;
+};
+
 /**
  * @brief The cppcheck preprocessor.
  * The preprocessor has special functionality for extracting the various ifdef
@@ -59,12 +86,21 @@ public:
     };
 
     /** character that is inserted in expanded macros */
-    static char macroChar;
+    static const char macroChar = char(1);
 
     Preprocessor(Settings& settings, ErrorLogger *errorLogger = nullptr);
 
-    static bool missingIncludeFlag;
-    static bool missingSystemIncludeFlag;
+    /**
+     * @brief Copy of a preprocessor that reports to another logger, so
+     * that the code of several configurations can be fetched at the same
+     * time. The directives are not copied, getcode() collects them anew.
+     */
+    Preprocessor(const Preprocessor &other, ErrorLogger *errorLogger);
+
+    /** @brief Include files of this translation unit that were not found */
+    const MissingIncludes &missingIncludes() const {
+        return _missingIncludes;
+    }
 
     /**
      * Extract the code for each configuration
@@ -98,11 +134,20 @@ public:
      */
     void preprocess(std::istream &srcCodeStream, std::string &processedFile, std::list<std::string> &resultConfigurations, const std::string &filename, const std::list<std::string> &includePaths);
 
+    /**
+     * Same as above, but the file data is read from a buffer, e.g. a
+     * memory mapped file. This avoids copying the data through a stream.
+     */
+    void preprocess(const char *data, std::size_t size, std::string &processedFile, std::list<std::string> &resultConfigurations, const std::string &filename, const std::list<std::string> &includePaths);
+
     /** Just read the code into a string. Perform simple cleanup of the code */
     std::string read(std::istream &istr, const std::string &filename);
 
-    /** read preprocessor statements into a string. */
-    static std::string readpreprocessor(std::istream &istr, const unsigned int bom);
+    /** Just read the code from a buffer into a string. Perform simple cleanup of the code */
+    std::string read(const char *data, std::size_t size, const std::string &filename);
+
+    /** read preprocessor statements into a string. @param text file data with "\n" newlines and no BOM */
+    static std::string readpreprocessor(const std::string &text);
 
     /** should __cplusplus be defined? */
     static bool cplusplus(const Settings *settings, const std::string &filename);
@@ -115,6 +160,44 @@ public:
      */
     std::string getcode(const std::string &filedata, const std::string &cfg, const std::string &filename);
 
+    /** @brief Code of a configuration before its macros are expanded, see getcodes() */
+    class ZKCHECKLIB ConfigurationCode {
+    public:
+        ConfigurationCode() : complete(true), errorLine(0) {
+        }
+
+        std::string code;
+
+        /** false if the configuration stopped at an #error or the checking was terminated */
+        bool complete;
+
+        /** #error to report for the configuration, empty if none */
+        std::string error;
+        std::string errorFile;
+        unsigned int errorLine;
+    };
+
+    /**
+     * @brief Get the code of several configurations with one walk over the
+     * directives. Each condition is evaluated once per configuration and
+     * the code between two directives is appended to each configuration it
+     * belongs to. Pass the results to getcode(code, cfg, filename) to
+     * validate them and expand the macros, which also reports the errors
+     * in the same order as calling getcode() for each configuration.
+     * @param filedata file data including preprocessing 'if', 'define', etc
+     * @param cfgs configurations to read out
+     * @param filename name of source file
+     */
+    std::vector<ConfigurationCode> getcodes(const std::string &filedata, const std::vector<std::string> &cfgs, const std::string &filename);
+
+    /**
+     * @brief Preprocessed code of a configuration from getcodes()
+     * @param code code from getcodes()
+     * @param cfg the configuration
+     * @param filename name of source file
+     */
+    std::string getcode(const ConfigurationCode &code, const std::string &cfg, const std::string &filename);
+
     /**
      * simplify condition
      * @param variables Variable values
@@ -237,7 +320,7 @@ public:
      * @param def condition
      * @return result when evaluating the condition
      */
-    bool match_cfg_def(std::map<std::string, std::string> cfg, std::string def);
+    bool match_cfg_def(const std::map<std::string, std::string> &cfg, std::string def);
 
     static void getErrorMessages(ErrorLogger *errorLogger, const Settings *settings);
 
@@ -251,7 +334,7 @@ public:
      * @param includes provide a empty list. this is just used to prevent recursive inclusions.
      * \return resulting string
      */
-    std::string handleIncludes(const std::string &code, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, std::list<std::string> includes);
+    std::string handleIncludes(const std::string &code, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, const std::list<std::string> &includes);
 
     void setFile0(const std::string &f) {
         file0 = f;
@@ -263,6 +346,21 @@ public:
     void dump(std::ostream &out) const;
 
 private:
+    /**
+     * Append code to out and include the headers for a specific
+     * configuration, see handleIncludes()
+     * @param index directives of code
+     * @param includes includes of the including files, used like a stack
+     * @return false if the code could not be handled, then out is incomplete
+     */
+    bool includeHeaders(const std::string &code, const DirectiveIndex &index, const std::string &filePath, const std::list<std::string> &includePaths, std::map<std::string,std::string> &defs, std::set<std::string> &pragmaOnce, std::vector<std::string> &includes, std::string &out);
+
+    /**
+     * Read a header through the header cache. Headers are read each time
+     * if reading them changes the settings, e.g. by inline suppressions.
+     */
+    std::shared_ptr<const HeaderCache::Header> readHeader(const std::string &filename);
+
     void missingInclude(const std::string &filename, unsigned int linenr, const std::string &header, HeaderTypes headerType);
 
     void error(const std::string &filename, unsigned int linenr, const std::string &msg);
@@ -288,6 +386,25 @@ private:
 
     /** filename for cpp/c file - useful when reporting errors */
     std::string file0;
+
+    /**
+     * @brief Directives of the file data given to getcfgs() and getcode().
+     * The index is built once and shared by the copies of this preprocessor.
+     */
+    const DirectiveIndex &directiveIndex(const std::string &filedata);
+
+    std::shared_ptr<const DirectiveIndex> _directiveIndex;
+
+    MissingIncludes _missingIncludes;
+
+    /**
+     * @brief getcodes() for at most 64 configurations
+     * @param first index of the first configuration in cfgs and result
+     */
+    void getcodes(const std::string &filedata, const std::vector<std::string> &cfgs, std::size_t first, const std::string &filename, std::vector<ConfigurationCode> &result);
+
+    /** @brief match_cfg_def() with the values of the variables already simplified */
+    bool matchSimplifiedCfg(const std::map<std::string, std::string> &variables, std::string def);
 };
 
 #endif
@@ -0,0 +1,224 @@
+/*
+
+ */
+
+#include "resultcache.h"
+#include "settings.h"
+#include "utils.h"
+#include "version.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+static const char CacheMagic[] = "zkcheck-cache 2";
+
+ResultCache::ResultCache(const std::string &dir)
+    : _dir(dir)
+{
+    if (_dir.empty())
+        return;
+    if (_dir[_dir.size() - 1U] != '/' && _dir[_dir.size() - 1U] != '\\')
+        _dir += '/';
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0777);
+#endif
+}
+
+std::string ResultCache::key(const Settings &settings, bool simplify, const std::string &filename, const std::string &cfg, const std::string &code)
+{
+    Hash128 hash;
+    hash.field(CacheMagic);
+    hash.field(ZKCHECK_VERSION_STRING);
+    hash.field(filename);
+    hash.field(cfg);
+    hash.field(code);
+
+    std::ostringstream ostr;
+    for (std::set<std::string>::const_iterator it = settings.enabled().begin(); it != settings.enabled().end(); ++it)
+        ostr << *it << ',';
+    ostr << '\n'
+         << simplify << settings.debugwarnings << settings.inconclusive << settings.experimental << settings.checkLibrary << '\n'
+         << settings.enforcedLang << ' ' << settings.standards.c << ' ' << settings.standards.cpp << ' ' << settings.standards.posix << '\n'
+         << settings.platformType << ' ' << static_cast<int>(settings.defaultSign) << ' '
+         << settings.char_bit << ' ' << settings.short_bit << ' ' << settings.int_bit << ' ' << settings.long_bit << ' ' << settings.long_long_bit << ' '
+         << settings.sizeof_bool << ' ' << settings.sizeof_short << ' ' << settings.sizeof_int << ' ' << settings.sizeof_long << ' '
+         << settings.sizeof_long_long << ' ' << settings.sizeof_float << ' ' << settings.sizeof_double << ' ' << settings.sizeof_long_double << ' '
+         << settings.sizeof_wchar_t << ' ' << settings.sizeof_size_t << ' ' << settings.sizeof_pointer << '\n'
+         << settings.budget.tokens << ' ' << settings.budget.valueFlowSteps << ' ' << settings.budget.templateExpansions << '\n';
+    hash.field(ostr.str());
+
+    hash.field(settings.userDefines);
+    for (std::set<std::string>::const_iterator it = settings.userUndefs.begin(); it != settings.userUndefs.end(); ++it)
+        hash.field(*it);
+    for (std::list<std::string>::const_iterator it = settings.userIncludes.begin(); it != settings.userIncludes.end(); ++it)
+        hash.field(*it);
+    for (std::list<Settings::Rule>::const_iterator it = settings.rules.begin(); it != settings.rules.end(); ++it) {
+        hash.field(it->tokenlist);
+        hash.field(it->pattern);
+        hash.field(it->id);
+        hash.field(it->summary);
+        hash.field(Severity::toString(it->severity));
+    }
+    hash.field(settings.library.checksum());
+
+    return hash.str();
+}
+
+std::string ResultCache::path(const std::string &key) const
+{
+    return _dir + key;
+}
+
+static void writeField(std::ostream &os, const std::string &str)
+{
+    os << str.size() << ' ' << str;
+}
+
+static bool readField(std::istream &is, std::string &str)
+{
+    std::size_t len = 0;
+    if (!(is >> len) || is.get() != ' ')
+        return false;
+    str.assign(len, '\0');
+    return len == 0U || is.read(&str[0], len);
+}
+
+static void writeMessage(std::ostream &os, const ErrorLogger::ErrorMessage &msg)
+{
+    // Unlike ErrorMessage::serialize() this keeps all characters as they are
+    writeField(os, msg.file0);
+    writeField(os, msg._id);
+    writeField(os, Severity::toString(msg._severity));
+    os << msg._cwe.id << ' ' << (msg._inconclusive ? 1 : 0) << ' ';
+    writeField(os, msg.shortMessage());
+    writeField(os, msg.verboseMessage());
+    os << msg._callStack.size() << ' ';
+    for (std::list<ErrorLogger::ErrorMessage::FileLocation>::const_iterator it = msg._callStack.begin(); it != msg._callStack.end(); ++it) {
+        os << it->line << ' ';
+        writeField(os, it->getfile(false));
+    }
+}
+
+static bool readMessage(std::istream &is, ErrorLogger::ErrorMessage &msg)
+{
+    std::string severity, shortMessage, verboseMessage;
+    int inconclusive = 0;
+    std::size_t callStackSize = 0;
+    if (!readField(is, msg.file0) || !readField(is, msg._id) || !readField(is, severity))
+        return false;
+    if (!(is >> msg._cwe.id >> inconclusive) || is.get() != ' ')
+        return false;
+    if (!readField(is, shortMessage) || !readField(is, verboseMessage))
+        return false;
+    if (!(is >> callStackSize) || is.get() != ' ')
+        return false;
+
+    msg._severity = Severity::fromString(severity);
+    msg._inconclusive = (inconclusive != 0);
+    if (verboseMessage.empty() || verboseMessage == shortMessage) {
+        if (!shortMessage.empty())
+            msg.setmsg(shortMessage);
+    } else {
+        msg.setmsg(shortMessage + '\n' + verboseMessage);
+    }
+
+    msg._callStack.clear();
+    for (std::size_t i = 0; i < callStackSize; ++i) {
+        unsigned int line = 0;
+        std::string file;
+        if (!(is >> line) || is.get() != ' ' || !readField(is, file))
+            return false;
+        msg._callStack.push_back(ErrorLogger::ErrorMessage::FileLocation(file, line));
+    }
+    return true;
+}
+
+bool ResultCache::load(const std::string &key, Entry &entry) const
+{
+    std::ifstream fin(path(key).c_str(), std::ios::in | std::ios::binary);
+    if (!fin.is_open())
+        return false;
+
+    std::string line;
+    if (!std::getline(fin, line) || line != CacheMagic)
+        return false;
+
+    Entry ret;
+    int internalError = 0;
+    if (!(fin >> line >> internalError >> ret.checksum.first >> ret.checksum.second) || line != "flags")
+        return false;
+    ret.internalError = (internalError != 0);
+
+    // Entries that were not completely written have no "end" marker
+    for (;;) {
+        std::string kind;
+        if (!(fin >> kind))
+            return false;
+        if (kind == "end")
+            break;
+        if ((kind != "E" && kind != "I") || fin.get() != ' ')
+            return false;
+
+        ErrorLogger::ErrorMessage msg;
+        if (!readMessage(fin, msg))
+            return false;
+        ret.messages.push_back(std::make_pair(msg, kind == "I"));
+    }
+
+    entry = ret;
+    return true;
+}
+
+void ResultCache::store(const std::string &key, const Entry &entry) const
+{
+    const std::string filename = path(key);
+
+    // Unique per process and thread
+    std::ostringstream tmp;
+#ifdef _WIN32
+    tmp << filename << '.' << _getpid();
+#else
+    tmp << filename << '.' << getpid();
+#endif
+    tmp << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    const std::string tmpfilename = tmp.str();
+
+    {
+        std::ofstream fout(tmpfilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!fout.is_open())
+            return;
+
+        fout << CacheMagic << '\n'
+             << "flags " << (entry.internalError ? 1 : 0) << ' ' << entry.checksum.first << ' ' << entry.checksum.second << '\n';
+        for (std::list<std::pair<ErrorLogger::ErrorMessage, bool> >::const_iterator it = entry.messages.begin(); it != entry.messages.end(); ++it) {
+            fout << (it->second ? "I " : "E ");
+            writeMessage(fout, it->first);
+            fout << '\n';
+        }
+        fout << "end\n";
+        if (!fout.good()) {
+            fout.close();
+            std::remove(tmpfilename.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(tmpfilename.c_str(), filename.c_str()) != 0) {
+        // Another writer was first (rename does not replace files on Windows)
+        std::remove(tmpfilename.c_str());
+    }
+}
@@ -0,0 +1,79 @@
+/*
+
+ */
+
+#include "config.h"
+#include "errorlogger.h"
+#include "utils.h"
+
+#include <list>
+#include <string>
+#include <utility>
+
+#ifndef resultcacheH
+#define resultcacheH
+
+class Settings;
+
+/**
+ * @brief On-disk cache of the messages found when checking one
+ * preprocessor configuration of a file (--cache-dir).
+ *
+ * The key hashes the preprocessed code of the configuration together with
+ * everything else that can change the result: file name, configuration,
+ * settings and the loaded library files. Entries are never invalidated,
+ * a changed input simply gives a different key.
+ */
+class ZKCHECKLIB ResultCache {
+public:
+    /** @brief Messages reported while checking one configuration */
+    class ZKCHECKLIB Entry {
+    public:
+        Entry() : internalError(false), checksum(0, 0) {
+        }
+
+        /** messages in the order they were reported, second is true for reportInfo() */
+        std::list<std::pair<ErrorLogger::ErrorMessage, bool> > messages;
+
+        /** was the checking aborted by an InternalError? */
+        bool internalError;
+
+        /** checksum of the simplified token list, (0, 0) if it was not calculated */
+        Hash128::Digest checksum;
+    };
+
+    /**
+     * @param dir cache directory, it is created if it does not exist
+     */
+    explicit ResultCache(const std::string &dir);
+
+    /**
+     * @brief Compute the key of a configuration.
+     * @param settings settings the configuration is checked with
+     * @param simplify is the simplified token list checked too?
+     * @param filename name of the checked file
+     * @param cfg the configuration
+     * @param code preprocessed code of the configuration
+     * @return key, 32 hexadecimal digits
+     */
+    static std::string key(const Settings &settings, bool simplify, const std::string &filename, const std::string &cfg, const std::string &code);
+
+    /**
+     * @brief Read a cache entry.
+     * @return false if there is no complete entry for the key
+     */
+    bool load(const std::string &key, Entry &entry) const;
+
+    /**
+     * @brief Write a cache entry. Concurrent writers of the same key are
+     * safe, every entry is written to a temporary file and then renamed.
+     */
+    void store(const std::string &key, const Entry &entry) const;
+
+private:
+    std::string path(const std::string &key) const;
+
+    std::string _dir;
+};
+
+#endif
@@ -10,6 +10,11 @@
 #include <fstream>
 #include <set>
 
+#ifdef HAVE_RULES
+#define PCRE_STATIC
+#include <pcre.h>
+#endif
+
 Settings::Settings()
     : _terminated(false),
       debug(false),
@@ -27,13 +32,17 @@ Settings::Settings()
       relativePaths(false),
       xml(false), xml_version(1),
       jobs(1),
+      configJobs(1),
       loadAverage(0),
+      workerPool(false),
+      inProcessThreads(false),
       exitCode(0),
-      //showtime(SHOWTIME_NONE),
+      showtime(SHOWTIME_NONE),
       preprocessOnly(false),
       maxConfigs(12),
       enforcedLang(None),
       reportProgress(false),
+      stats(false),
       checkConfiguration(false),
       checkLibrary(false)
 {
@@ -307,3 +316,108 @@ bool Settings::platformFile(const std::string &filename)
 
     return true;
 }
+
+#ifdef HAVE_RULES
+/** A pattern compiled and, if pcre supports it, JIT compiled */
+class Settings::Rule::Regex {
+public:
+    explicit Regex(const std::string &pattern)
+        : _pattern(pattern), _re(nullptr), _extra(nullptr) {
+        const char *error = nullptr;
+        int erroffset = 0;
+        _re = pcre_compile(pattern.c_str(), 0, &error, &erroffset, nullptr);
+        if (!_re) {
+            if (error)
+                _error = error;
+            return;
+        }
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+        const int studyOptions = PCRE_STUDY_JIT_COMPILE;
+#else
+        const int studyOptions = 0;
+#endif
+        // A failed study is not an error, the pattern is just not optimized
+        _extra = pcre_study(_re, studyOptions, &error);
+    }
+
+    ~Regex() {
+        if (_extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+            pcre_free_study(_extra);
+#else
+            pcre_free(_extra);
+#endif
+        }
+        if (_re)
+            pcre_free(_re);
+    }
+
+    const std::string &pattern() const {
+        return _pattern;
+    }
+
+    const std::string &error() const {
+        return _error;
+    }
+
+    bool match(const std::string &str, std::size_t offset, std::size_t &matchBegin, std::size_t &matchEnd) const {
+        if (!_re || offset >= str.size())
+            return false;
+        int ovector[30] = {0};
+        if (pcre_exec(_re, _extra, str.c_str(), (int)str.size(), (int)offset, 0, ovector, 30) < 0)
+            return false;
+        matchBegin = (std::size_t)ovector[0];
+        matchEnd = (std::size_t)ovector[1];
+        return true;
+    }
+
+private:
+    Regex(const Regex &);
+    void operator=(const Regex &);
+
+    const std::string _pattern;
+    std::string _error;
+    pcre *_re;
+    pcre_extra *_extra;
+};
+
+void Settings::Rule::compile()
+{
+    if (!_regex || _regex->pattern() != pattern)
+        _regex = std::make_shared<const Regex>(pattern);
+}
+
+std::string Settings::Rule::compileError() const
+{
+    return _regex ? _regex->error() : std::string();
+}
+
+bool Settings::Rule::match(const std::string &str, std::size_t offset, std::size_t &matchBegin, std::size_t &matchEnd) const
+{
+    return _regex && _regex->match(str, offset, matchBegin, matchEnd);
+}
+#else
+class Settings::Rule::Regex {
+};
+
+void Settings::Rule::compile()
+{
+}
+
+std::string Settings::Rule::compileError() const
+{
+    return std::string();
+}
+
+bool Settings::Rule::match(const std::string &, std::size_t, std::size_t &, std::size_t &) const
+{
+    return false;
+}
+#endif
+
+void Settings::compileRules()
+{
+    for (std::list<Rule>::iterator it = rules.begin(); it != rules.end(); ++it)
+        it->compile();
+}
@@ -3,14 +3,17 @@
  */
 
 #include <list>
+#include <memory>
 #include <vector>
 #include <string>
 #include <set>
 #include "config.h"
+#include "budget.h"
 #include "library.h"
 #include "suppressions.h"
 #include "standards.h"
 #include "errorlogger.h"
+#include "timer.h"
 
 #ifndef settingsH
 #define settingsH
@@ -103,9 +106,25 @@ public:
         time. Default is 1. (-j N) */
     unsigned int jobs;
 
+    /** @brief How many threads check the configurations of one file at
+        the same time. Default is 1. (--config-jobs=N) */
+    unsigned int configJobs;
+
     /** @brief Load average value */
     unsigned int loadAverage;
 
+    /** @brief Check the files in long-lived worker processes that are
+        reused for many files, instead of one process per file (--worker-pool) */
+    bool workerPool;
+
+    /** @brief Directory where the results of each checked configuration are
+        cached, keyed on a hash of its preprocessed code (--cache-dir) */
+    std::string cacheDir;
+
+    /** @brief Check the files with threads inside this process instead of
+        child processes (--executor=thread) */
+    bool inProcessThreads;
+
     /** @brief If errors are found, this value is returned from main().
         Default value is 0. */
     int exitCode;
@@ -114,8 +133,8 @@ public:
         e.g. "{severity} {file}:{line} {message} {id}" */
     std::string outputFormat;
 
-	/** @brief show timing information (--showtime=file|summary|top5) */
-    //SHOWTIME_MODES showtime;
+    /** @brief show timing information (--showtime=file|summary|top5) */
+    SHOWTIME_MODES showtime;
 
     /** @brief Using -E for debugging purposes */
     bool preprocessOnly;
@@ -134,6 +153,10 @@ public:
         Default is 12. (--max-configs=N) */
     unsigned int maxConfigs;
 
+    /** @brief Limits of the resources that checking one configuration of
+        a file may use. (--budget-tokens=N etc) */
+    Budget::Limits budget;
+
     /**
      * @brief Returns true if given id is in the list of
      * enabled extra checks (--enable)
@@ -153,6 +176,11 @@ public:
      */
     std::string addEnabled(const std::string &str);
 
+    /** @brief All ids given to --enable, see isEnabled() */
+    const std::set<std::string> &enabled() const {
+        return _enabled;
+    }
+
     /**
      * @brief Disables all severities, except from error.
      */
@@ -189,6 +217,9 @@ public:
     /** @brief --report-progress */
     bool reportProgress;
 
+    /** @brief Print statistics when the checking is finished (--stats) */
+    bool stats;
+
     /** Library (--library) */
     Library library;
 
@@ -206,8 +237,37 @@ public:
         std::string id;
         std::string summary;
         Severity::SeverityType severity;
+
+        /**
+         * @brief Compile the pattern with pcre, unless it is already
+         * compiled. Copies of the rule that are made afterwards share the
+         * compiled pattern, so it is compiled once and not for each file.
+         * Without HAVE_RULES this does nothing.
+         */
+        void compile();
+
+        /** @brief pcre_compile() error message, empty if the pattern was compiled */
+        std::string compileError() const;
+
+        /**
+         * @brief Search the pattern in @p str, starting at @p offset.
+         * compile() must have been called first.
+         * @param str text to search
+         * @param offset where to start the search
+         * @param matchBegin set to the offset of the match
+         * @param matchEnd set to the offset after the match
+         * @return true if there is a match
+         */
+        bool match(const std::string &str, std::size_t offset, std::size_t &matchBegin, std::size_t &matchEnd) const;
+
+    private:
+        class Regex;
+        std::shared_ptr<const Regex> _regex;
     };
 
+    /** @brief Compile all rules, see Rule::compile() */
+    void compileRules();
+
     /**
      * @brief Extra rules
      */
@@ -0,0 +1,140 @@
+/*
+
+ */
+
+#include "config.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#ifndef smallvectorH
+#define smallvectorH
+
+/**
+ * @brief Vector that stores up to N elements inside of itself.
+ *
+ * Only the elements beyond N are put on the heap, so small containers don't
+ * allocate at all. Elements can be appended and the container can be
+ * cleared, there is no erase. Appending may move the elements, iterators
+ * and references are invalidated then.
+ */
+template <class T, std::size_t N>
+class SmallVector {
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+    typedef std::size_t size_type;
+
+    SmallVector() : _data(inlineData()), _size(0), _capacity(N) {
+    }
+
+    SmallVector(const SmallVector &other) : _data(inlineData()), _size(0), _capacity(N) {
+        append(other.begin(), other.end());
+    }
+
+    ~SmallVector() {
+        clear();
+        if (_data != inlineData())
+            ::operator delete(_data);
+    }
+
+    SmallVector &operator=(const SmallVector &other) {
+        if (this != &other) {
+            clear();
+            append(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    iterator begin() {
+        return _data;
+    }
+    const_iterator begin() const {
+        return _data;
+    }
+    iterator end() {
+        return _data + _size;
+    }
+    const_iterator end() const {
+        return _data + _size;
+    }
+
+    size_type size() const {
+        return _size;
+    }
+    bool empty() const {
+        return _size == 0;
+    }
+
+    T &front() {
+        return _data[0];
+    }
+    const T &front() const {
+        return _data[0];
+    }
+    T &back() {
+        return _data[_size - 1];
+    }
+    const T &back() const {
+        return _data[_size - 1];
+    }
+
+    T &operator[](size_type i) {
+        return _data[i];
+    }
+    const T &operator[](size_type i) const {
+        return _data[i];
+    }
+
+    void push_back(const T &value) {
+        if (_size == _capacity) {
+            // the value may be an element, copy it before the elements move
+            const T copy(value);
+            grow();
+            new (_data + _size) T(copy);
+        } else {
+            new (_data + _size) T(value);
+        }
+        ++_size;
+    }
+
+    /** @brief Remove the elements, the heap memory is kept for reuse */
+    void clear() {
+        for (unsigned int i = 0; i < _size; ++i)
+            _data[i].~T();
+        _size = 0;
+    }
+
+private:
+    T *inlineData() {
+        return reinterpret_cast<T *>(&_inline);
+    }
+
+    template <class It>
+    void append(It first, It last) {
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+
+    void grow() {
+        const unsigned int capacity = 2 * _capacity;
+        T *data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+        for (unsigned int i = 0; i < _size; ++i) {
+            new (data + i) T(_data[i]);
+            _data[i].~T();
+        }
+        if (_data != inlineData())
+            ::operator delete(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+
+    T *_data;
+    unsigned int _size;
+    unsigned int _capacity;
+    typename std::aligned_storage<N * sizeof(T), std::alignment_of<T>::value>::type _inline;
+};
+
+#endif // smallvectorH
@@ -3,11 +3,13 @@
  */
 
 #include "templatesimplifier.h"
+#include "budget.h"
 #include "mathlib.h"
 #include "token.h"
 #include "tokenize.h"
 #include "errorlogger.h"
 #include "settings.h"
+#include "timer.h"
 #include <algorithm>
 #include <sstream>
 #include <list>
@@ -17,6 +19,7 @@
 #include <string>
 #include <cassert>
 #include <iostream>
+#include <unordered_map>
 
 #ifdef GDB_HELPERS
 
@@ -721,6 +724,102 @@ int TemplateSimplifier::getTemplateNamePosition(const Token *tok)
 }
 
 
+/**
+ * Copy one definition of a template to the end of the token list, with the
+ * template parameters replaced by the types of the instantiation.
+ * @param tok3 first token to copy
+ * @return the last token that was copied
+ */
+static const Token *copyTemplateDefinition(
+    TokenList& tokenlist,
+    const Token *tok3,
+    const std::string &name,
+    const std::vector<const Token *> &typeParametersInDeclaration,
+    const std::string &newName,
+    const std::vector<const Token *> &typesUsedInTemplateInstantiation,
+    std::list<Token *> &templateInstantiations)
+{
+    int indentlevel = 0;
+    std::stack<Token *> brackets; // holds "(", "[" and "{" tokens
+
+    for (; tok3; tok3 = tok3->next()) {
+        if (tok3->isName()) {
+            // search for this token in the type vector
+            unsigned int itype = 0;
+            while (itype < typeParametersInDeclaration.size() && typeParametersInDeclaration[itype]->str() != tok3->str())
+                ++itype;
+
+            // replace type with given type..
+            if (itype < typeParametersInDeclaration.size()) {
+                unsigned int typeindentlevel = 0;
+                for (const Token *typetok = typesUsedInTemplateInstantiation[itype];
+                     typetok && (typeindentlevel>0 || !Token::Match(typetok, ",|>"));
+                     typetok = typetok->next()) {
+                    if (Token::simpleMatch(typetok, ". . .")) {
+                        typetok = typetok->tokAt(2);
+                        continue;
+                    }
+                    if (Token::Match(typetok, "%name% <") && TemplateSimplifier::templateParameters(typetok->next()) > 0)
+                        ++typeindentlevel;
+                    else if (typeindentlevel > 0 && typetok->str() == ">")
+                        --typeindentlevel;
+                    tokenlist.addtoken(typetok, tok3->linenr(), tok3->fileIndex());
+                }
+                continue;
+            }
+        }
+
+        // replace name..
+        if (Token::Match(tok3, (name + " !!<").c_str())) {
+            tokenlist.addtoken(newName, tok3->linenr(), tok3->fileIndex());
+            continue;
+        }
+
+        // copy
+        tokenlist.addtoken(tok3, tok3->linenr(), tok3->fileIndex());
+        if (Token::Match(tok3, "%type% <") && Token::Match(tok3->next()->findClosingBracket(), ">|>> !!&")) {
+            templateInstantiations.push_back(tokenlist.back());
+        }
+
+        // link() newly tokens manually
+        else if (tok3->str() == "{") {
+            brackets.push(tokenlist.back());
+            indentlevel++;
+        } else if (tok3->str() == "(") {
+            brackets.push(tokenlist.back());
+        } else if (tok3->str() == "[") {
+            brackets.push(tokenlist.back());
+        } else if (tok3->str() == "}") {
+            assert(brackets.empty() == false && brackets.top()->str() == "{");
+            Token::createMutualLinks(brackets.top(), tokenlist.back());
+            if (tok3->strAt(1) == ";") {
+                const Token * tokSemicolon = tok3->next();
+                tokenlist.addtoken(tokSemicolon, tokSemicolon->linenr(), tokSemicolon->fileIndex());
+            }
+            brackets.pop();
+            if (indentlevel <= 1 && brackets.empty()) {
+                // there is a bug if indentlevel is 0
+                // the "}" token should only be added if indentlevel is 1 but I add it always intentionally
+                // if indentlevel ever becomes 0, cppcheck will write:
+                // ### Error: Invalid number of character {
+                break;
+            }
+            --indentlevel;
+        } else if (tok3->str() == ")") {
+            assert(brackets.empty() == false && brackets.top()->str() == "(");
+            Token::createMutualLinks(brackets.top(), tokenlist.back());
+            brackets.pop();
+        } else if (tok3->str() == "]") {
+            assert(brackets.empty() == false && brackets.top()->str() == "[");
+            Token::createMutualLinks(brackets.top(), tokenlist.back());
+            brackets.pop();
+        }
+    }
+
+    assert(brackets.empty());
+    return tok3;
+}
+
 void TemplateSimplifier::expandTemplate(
     TokenList& tokenlist,
     const Token *tok,
@@ -728,8 +827,27 @@ void TemplateSimplifier::expandTemplate(
     std::vector<const Token *> &typeParametersInDeclaration,
     const std::string &newName,
     std::vector<const Token *> &typesUsedInTemplateInstantiation,
-    std::list<Token *> &templateInstantiations)
+    std::list<Token *> &templateInstantiations,
+    std::vector<const Token *> &definitions)
 {
+    if (!definitions.empty()) {
+        for (std::vector<const Token *>::const_iterator it = definitions.begin(); it != definitions.end(); ++it) {
+            const Token *tok3 = *it;
+            if (tok3 == tok) {
+                tok3 = tok3->next();
+            } else if (tokenlist.validateToken(tok3) &&
+                       TemplateSimplifier::instantiateMatch(tok3, name, typeParametersInDeclaration.size(), ":: ~| %name% (")) {
+                tokenlist.addtoken(newName, tok3->linenr(), tok3->fileIndex());
+                while (tok3 && tok3->str() != "::")
+                    tok3 = tok3->next();
+            } else {
+                continue;
+            }
+            copyTemplateDefinition(tokenlist, tok3, name, typeParametersInDeclaration, newName, typesUsedInTemplateInstantiation, templateInstantiations);
+        }
+        return;
+    }
+
     bool inTemplateDefinition=false;
     std::vector<const Token *> localTypeParametersInDeclaration;
     for (const Token *tok3 = tokenlist.front(); tok3; tok3 = tok3 ? tok3->next() : nullptr) {
@@ -748,12 +866,14 @@ void TemplateSimplifier::expandTemplate(
 
         // Start of template..
         if (tok3 == tok) {
+            definitions.push_back(tok3);
             tok3 = tok3->next();
         }
 
         // member function implemented outside class definition
         else if (inTemplateDefinition &&
                  TemplateSimplifier::instantiateMatch(tok3, name, typeParametersInDeclaration.size(), ":: ~| %name% (")) {
+            definitions.push_back(tok3);
             tokenlist.addtoken(newName, tok3->linenr(), tok3->fileIndex());
             while (tok3 && tok3->str() != "::")
                 tok3 = tok3->next();
@@ -763,84 +883,7 @@ void TemplateSimplifier::expandTemplate(
         else
             continue;
 
-        int indentlevel = 0;
-        std::stack<Token *> brackets; // holds "(", "[" and "{" tokens
-
-        for (; tok3; tok3 = tok3->next()) {
-            if (tok3->isName()) {
-                // search for this token in the type vector
-                unsigned int itype = 0;
-                while (itype < typeParametersInDeclaration.size() && typeParametersInDeclaration[itype]->str() != tok3->str())
-                    ++itype;
-
-                // replace type with given type..
-                if (itype < typeParametersInDeclaration.size()) {
-                    unsigned int typeindentlevel = 0;
-                    for (const Token *typetok = typesUsedInTemplateInstantiation[itype];
-                         typetok && (typeindentlevel>0 || !Token::Match(typetok, ",|>"));
-                         typetok = typetok->next()) {
-                        if (Token::simpleMatch(typetok, ". . .")) {
-                            typetok = typetok->tokAt(2);
-                            continue;
-                        }
-                        if (Token::Match(typetok, "%name% <") && templateParameters(typetok->next()) > 0)
-                            ++typeindentlevel;
-                        else if (typeindentlevel > 0 && typetok->str() == ">")
-                            --typeindentlevel;
-                        tokenlist.addtoken(typetok, tok3->linenr(), tok3->fileIndex());
-                    }
-                    continue;
-                }
-            }
-
-            // replace name..
-            if (Token::Match(tok3, (name + " !!<").c_str())) {
-                tokenlist.addtoken(newName, tok3->linenr(), tok3->fileIndex());
-                continue;
-            }
-
-            // copy
-            tokenlist.addtoken(tok3, tok3->linenr(), tok3->fileIndex());
-            if (Token::Match(tok3, "%type% <") && Token::Match(tok3->next()->findClosingBracket(), ">|>> !!&")) {
-                templateInstantiations.push_back(tokenlist.back());
-            }
-
-            // link() newly tokens manually
-            else if (tok3->str() == "{") {
-                brackets.push(tokenlist.back());
-                indentlevel++;
-            } else if (tok3->str() == "(") {
-                brackets.push(tokenlist.back());
-            } else if (tok3->str() == "[") {
-                brackets.push(tokenlist.back());
-            } else if (tok3->str() == "}") {
-                assert(brackets.empty() == false && brackets.top()->str() == "{");
-                Token::createMutualLinks(brackets.top(), tokenlist.back());
-                if (tok3->strAt(1) == ";") {
-                    const Token * tokSemicolon = tok3->next();
-                    tokenlist.addtoken(tokSemicolon, tokSemicolon->linenr(), tokSemicolon->fileIndex());
-                }
-                brackets.pop();
-                if (indentlevel <= 1 && brackets.empty()) {
-                    // there is a bug if indentlevel is 0
-                    // the "}" token should only be added if indentlevel is 1 but I add it always intentionally
-                    // if indentlevel ever becomes 0, cppcheck will write:
-                    // ### Error: Invalid number of character {
-                    break;
-                }
-                --indentlevel;
-            } else if (tok3->str() == ")") {
-                assert(brackets.empty() == false && brackets.top()->str() == "(");
-                Token::createMutualLinks(brackets.top(), tokenlist.back());
-                brackets.pop();
-            } else if (tok3->str() == "]") {
-                assert(brackets.empty() == false && brackets.top()->str() == "[");
-                Token::createMutualLinks(brackets.top(), tokenlist.back());
-                brackets.pop();
-            }
-        }
-
-        assert(brackets.empty());
+        tok3 = copyTemplateDefinition(tokenlist, tok3, name, typeParametersInDeclaration, newName, typesUsedInTemplateInstantiation, templateInstantiations);
     }
 }
 
@@ -1180,6 +1223,110 @@ const Token * TemplateSimplifier::TemplateParametersInDeclaration(
     return tok;
 }
 
+/** Name of the template that is declared at tok, empty if it is not known */
+static std::string getTemplateName(const Token *tok)
+{
+    std::vector<const Token *> typeParametersInDeclaration;
+    tok = TemplateSimplifier::TemplateParametersInDeclaration(tok->tokAt(2), typeParametersInDeclaration);
+    const int namepos = tok ? TemplateSimplifier::getTemplateNamePosition(tok) : -1;
+    return (namepos == -1) ? emptyString : tok->strAt(namepos);
+}
+
+namespace {
+    /**
+     * The tokens with the name of one template, in the order of the token
+     * list. The usages of the template are replaced by visiting these
+     * instead of all the tokens after each instantiation. Deleted tokens
+     * stay in the list until the list is built again.
+     */
+    class TemplateNameTokens {
+    public:
+        typedef std::list<Token *>::const_iterator const_iterator;
+
+        /** @param name the text of a token of the token list, the texts are interned */
+        explicit TemplateNameTokens(const std::string &name) : _name(&name), _built(false), _tail(std::string::npos) {
+        }
+
+        bool built() const {
+            return _built;
+        }
+
+        /**
+         * @brief Collect the tokens of the whole token list
+         * @param tail first token of the code that will be simplified again, or nullptr
+         */
+        void build(Token *front, const Token *tail) {
+            clear();
+            for (Token *tok = front; tok; tok = tok->next()) {
+                if (tok == tail)
+                    _tail = _tokens.size();
+                add(tok);
+            }
+            _built = true;
+        }
+
+        void clear() {
+            _tokens.clear();
+            _position.clear();
+            _built = false;
+            _tail = std::string::npos;
+        }
+
+        /** @brief Add the tokens from tok on, code that has been added at the end of the token list */
+        void addTail(Token *tok) {
+            if (_tail == std::string::npos)
+                _tail = _tokens.size();
+            addFrom(tok);
+        }
+
+        /** @brief Collect the tokens added by addTail() again, from tok on */
+        void updateTail(Token *tok) {
+            if (_tail == std::string::npos)
+                return;
+            while (_tokens.size() > _tail) {
+                _position.erase(_tokens.back());
+                _tokens.pop_back();
+            }
+            _tail = std::string::npos;
+            addFrom(tok);
+        }
+
+        const_iterator find(const Token *tok) const {
+            const std::unordered_map<const Token *, const_iterator>::const_iterator it = _position.find(tok);
+            return (it == _position.end()) ? _tokens.end() : it->second;
+        }
+
+        const_iterator end() const {
+            return _tokens.end();
+        }
+
+    private:
+        void addFrom(Token *tok) {
+            for (; tok; tok = tok->next())
+                add(tok);
+        }
+
+        void add(Token *tok) {
+            if (&tok->str() != _name)
+                return;
+            // the memory of a deleted token can be used again for a new token
+            const std::unordered_map<const Token *, const_iterator>::iterator it = _position.find(tok);
+            if (it != _position.end())
+                _tokens.erase(it->second);
+            _tokens.push_back(tok);
+            _position[tok] = --_tokens.end();
+        }
+
+        const std::string *_name;
+        bool _built;
+        std::list<Token *> _tokens;
+        std::unordered_map<const Token *, const_iterator> _position;
+
+        /** Number of tokens before the ones added by addTail(), npos if none */
+        std::size_t _tail;
+    };
+}
+
 bool TemplateSimplifier::simplifyTemplateInstantiations(
     TokenList& tokenlist,
     ErrorLogger* errorlogger,
@@ -1187,12 +1334,10 @@ bool TemplateSimplifier::simplifyTemplateInstantiations(
     const Token *tok,
     const std::time_t maxtime,
     std::list<Token *> &templateInstantiations,
-    std::set<std::string> &expandedtemplates)
+    std::set<std::string> &expandedtemplates,
+    std::set<std::string> &usedNames,
+    TimerResultsIntf *timerResults)
 {
-    // this variable is not used at the moment. The intention was to
-    // allow continuous instantiations until all templates has been expanded
-    //bool done = false;
-
     // Contains tokens such as "T"
     std::vector<const Token *> typeParametersInDeclaration;
     tok = TemplateParametersInDeclaration(tok->tokAt(2), typeParametersInDeclaration);
@@ -1225,10 +1370,29 @@ bool TemplateSimplifier::simplifyTemplateInstantiations(
 
     bool instantiated = false;
 
+    // where the template is defined, found by the first expansion
+    std::vector<const Token *> definitions;
+
+    // The calculations are simplified in the whole token list once. After
+    // that only the code that has been expanded since is simplified, the
+    // rest of the token list has only had template usages replaced.
+    bool calculationsSimplified = false;
+    Token *lastBeforeExpanded = nullptr;
+
+    TemplateNameTokens nameTokens(tok->tokAt(namepos)->str());
+
     for (std::list<Token *>::const_iterator iter2 = templateInstantiations.begin(); iter2 != templateInstantiations.end(); ++iter2) {
         if (amountOftemplateInstantiations != templateInstantiations.size()) {
             amountOftemplateInstantiations = templateInstantiations.size();
-            simplifyCalculations(tokenlist.front());
+            if (!calculationsSimplified || !tokenlist.validateToken(lastBeforeExpanded)) {
+                simplifyCalculations(tokenlist.front());
+                calculationsSimplified = true;
+                nameTokens.clear();
+            } else if (lastBeforeExpanded) {
+                simplifyCalculations(lastBeforeExpanded);
+                nameTokens.updateTail(lastBeforeExpanded->next());
+            }
+            lastBeforeExpanded = nullptr;
             ++recursiveCount;
             if (recursiveCount > 100) {
                 // bail out..
@@ -1307,15 +1471,38 @@ bool TemplateSimplifier::simplifyTemplateInstantiations(
         const std::string newName(name + "<" + typeForNewName + ">");
 
         if (expandedtemplates.find(newName) == expandedtemplates.end()) {
+            // Stop instantiating once the budget is exceeded
+            Budget * const budget = tokenlist.budget();
+            if (budget && !budget->templateExpansion()) {
+                budget->degrade("template instantiation stopped");
+                return false;
+            }
             expandedtemplates.insert(newName);
-            TemplateSimplifier::expandTemplate(tokenlist, tok,name,typeParametersInDeclaration,newName,typesUsedInTemplateInstantiation,templateInstantiations);
+            Token * const back = tokenlist.back();
+            if (!lastBeforeExpanded)
+                lastBeforeExpanded = back;
+            const std::size_t usages = templateInstantiations.size();
+            Timer timer("TemplateSimplifier::expandTemplate", _settings->showtime, timerResults);
+            TemplateSimplifier::expandTemplate(tokenlist, tok,name,typeParametersInDeclaration,newName,typesUsedInTemplateInstantiation,templateInstantiations,definitions);
+            timer.Stop();
+            std::list<Token *>::const_reverse_iterator it = templateInstantiations.rbegin();
+            for (std::size_t i = usages; i < templateInstantiations.size(); ++i, ++it)
+                usedNames.insert((*it)->str());
+            if (nameTokens.built())
+                nameTokens.addTail(back->next());
             instantiated = true;
         }
 
         // Replace all these template usages..
+        TemplateNameTokens::const_iterator it4 = nameTokens.find(tok2);
+        if (it4 == nameTokens.end()) {
+            nameTokens.build(tokenlist.front(), lastBeforeExpanded ? lastBeforeExpanded->next() : nullptr);
+            it4 = nameTokens.find(tok2);
+        }
         std::list< std::pair<Token *, Token *> > removeTokens;
-        for (Token *tok4 = tok2; tok4; tok4 = tok4->next()) {
-            if (Token::simpleMatch(tok4, templateMatchPattern.c_str())) {
+        for (; it4 != nameTokens.end(); ++it4) {
+            Token * const tok4 = *it4;
+            if (tokenlist.validateToken(tok4) && Token::simpleMatch(tok4, templateMatchPattern.c_str())) {
                 Token * tok5 = tok4->tokAt(2);
                 unsigned int typeCountInInstantiation = 1U; // There is always at least one type
                 const Token *typetok = (!typesUsedInTemplateInstantiation.empty()) ? typesUsedInTemplateInstantiation[0] : 0;
@@ -1354,9 +1541,15 @@ bool TemplateSimplifier::simplifyTemplateInstantiations(
                     removeTokens.push_back(std::pair<Token*,Token*>(tok4, tok5->next()));
                 }
 
-                tok4 = tok5;
-                if (!tok4)
+                if (!tok5)
                     break;
+
+                // continue after tok5
+                for (const Token *tok6 = tok4->next(); tok6 != tok5->next(); tok6 = tok6->next()) {
+                    TemplateNameTokens::const_iterator next = it4;
+                    if (++next != nameTokens.end() && *next == tok6)
+                        it4 = next;
+                }
             }
         }
         while (!removeTokens.empty()) {
@@ -1375,7 +1568,8 @@ void TemplateSimplifier::simplifyTemplates(
     ErrorLogger* errorlogger,
     const Settings *_settings,
     const std::time_t maxtime,
-    bool &_codeWithTemplates
+    bool &_codeWithTemplates,
+    TimerResultsIntf *timerResults
 )
 {
 
@@ -1410,30 +1604,41 @@ void TemplateSimplifier::simplifyTemplates(
     // Template arguments with default values
     TemplateSimplifier::useDefaultArgumentValues(templates, &templateInstantiations);
 
-    // expand templates
-    //bool done = false;
-    //while (!done)
-    {
-        //done = true;
-        std::list<Token *> templates2;
-        for (std::list<Token *>::reverse_iterator iter1 = templates.rbegin(); iter1 != templates.rend(); ++iter1) {
+    // expand templates. A template is expanded again when the expansion of
+    // a template after it has added usages of it, until nothing new is used.
+    std::list<Token *> templates2;
+    std::vector<Token *> worklist(templates.rbegin(), templates.rend());
+    for (unsigned int round = 0; !worklist.empty() && round < 100; ++round) {
+        std::vector<std::set<std::string> > usedNames(worklist.size());
+        for (std::size_t i = 0; i < worklist.size(); ++i) {
             bool instantiated = TemplateSimplifier::simplifyTemplateInstantiations(tokenlist,
                                 errorlogger,
                                 _settings,
-                                *iter1,
+                                worklist[i],
                                 maxtime,
                                 templateInstantiations,
-                                expandedtemplates);
+                                expandedtemplates,
+                                usedNames[i],
+                                timerResults);
             if (instantiated)
-                templates2.push_back(*iter1);
+                templates2.push_back(worklist[i]);
         }
 
-        for (std::list<Token *>::const_iterator it = templates2.begin(); it != templates2.end(); ++it) {
-            std::list<Token *>::iterator it1 = std::find(templates.begin(), templates.end(), *it);
-            if (it1 != templates.end()) {
-                templates.erase(it1);
-                removeTemplate(*it);
-            }
+        std::vector<Token *> again;
+        std::set<std::string> usedLater;
+        for (std::size_t i = worklist.size(); i > 0; --i) {
+            if (!usedLater.empty() && usedLater.find(getTemplateName(worklist[i - 1])) != usedLater.end())
+                again.push_back(worklist[i - 1]);
+            usedLater.insert(usedNames[i - 1].begin(), usedNames[i - 1].end());
+        }
+        worklist.assign(again.rbegin(), again.rend());
+    }
+
+    for (std::list<Token *>::const_iterator it = templates2.begin(); it != templates2.end(); ++it) {
+        std::list<Token *>::iterator it1 = std::find(templates.begin(), templates.end(), *it);
+        if (it1 != templates.end()) {
+            templates.erase(it1);
+            removeTemplate(*it);
         }
     }
 }
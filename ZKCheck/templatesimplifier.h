@@ -13,6 +13,7 @@ class Token;
 class TokenList;
 class ErrorLogger;
 class Settings;
+class TimerResultsIntf;
 
 #ifndef templatesimplifierH
 #define templatesimplifierH
@@ -88,6 +89,12 @@ public:
      */
     static int getTemplateNamePosition(const Token *tok);
 
+    /**
+     * Expand one instantiation of a template
+     * @param definitions where the template and its member functions are
+     * defined. The first expansion of a template looks them up in the whole
+     * token list and fills this in, the following ones only visit these.
+     */
     static void expandTemplate(
         TokenList& tokenlist,
         const Token *tok,
@@ -95,7 +102,8 @@ public:
         std::vector<const Token *> &typeParametersInDeclaration,
         const std::string &newName,
         std::vector<const Token *> &typesUsedInTemplateInstantiation,
-        std::list<Token *> &templateInstantiations);
+        std::list<Token *> &templateInstantiations,
+        std::vector<const Token *> &definitions);
 
     /**
      * @brief TemplateParametersInDeclaration
@@ -120,6 +128,8 @@ public:
      * @param maxtime time when the simplification will stop
      * @param templateInstantiations a list of template usages (not necessarily just for this template)
      * @param expandedtemplates all templates that has been expanded so far. The full names are stored.
+     * @param usedNames names of the templates that are used by the expanded code are added here
+     * @param timerResults receives the time of each expansion
      * @return true if the template was instantiated
      */
     static bool simplifyTemplateInstantiations(
@@ -129,7 +139,9 @@ public:
         const Token *tok,
         const std::time_t maxtime,
         std::list<Token *> &templateInstantiations,
-        std::set<std::string> &expandedtemplates);
+        std::set<std::string> &expandedtemplates,
+        std::set<std::string> &usedNames,
+        TimerResultsIntf *timerResults);
 
     /**
      * Simplify templates
@@ -138,13 +150,15 @@ public:
      * @param _settings settings
      * @param maxtime time when the simplification should be stopped
      * @param _codeWithTemplates output parameter that is set if code contains templates
+     * @param timerResults receives the time of each expansion
      */
     static void simplifyTemplates(
         TokenList& tokenlist,
         ErrorLogger* errorlogger,
         const Settings *_settings,
         const std::time_t maxtime,
-        bool &_codeWithTemplates);
+        bool &_codeWithTemplates,
+        TimerResultsIntf *timerResults = nullptr);
 
     /**
      * Simplify constant calculations such as "1+2" => "3"
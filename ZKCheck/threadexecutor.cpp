@@ -5,7 +5,13 @@
 #include "threadexecutor.h"
 #include "zkcheck.h"
 #include "zkcheckexecutor.h"
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #ifdef __SVR4  // Solaris
 #include <sys/loadavg.h>
@@ -21,6 +27,7 @@
 #include <errno.h>
 #include <time.h>
 #include <cstring>
+#include <csignal>
 #include <sstream>
 #endif
 #ifdef THREADING_MODEL_WIN
@@ -35,7 +42,7 @@
 using std::memset;
 
 ThreadExecutor::ThreadExecutor(const std::map<std::string, std::size_t> &files, Settings &settings, ErrorLogger &errorLogger)
-    : _files(files), _settings(settings), _errorLogger(errorLogger), _fileCount(0)
+    : _files(files), _settings(settings), _errorLogger(errorLogger), _fileCount(0), _duplicatesDropped(0)
 {
 #if defined(THREADING_MODEL_FORK)
     _wpipe = 0;
@@ -74,7 +81,7 @@ int ThreadExecutor::handleRead(int rpipe, unsigned int &result)
         return -1;
     }
 
-    if (type != REPORT_OUT && type != REPORT_ERROR && type != REPORT_INFO && type != CHILD_END) {
+    if (type != REPORT_OUT && type != REPORT_ERROR && type != REPORT_INFO && type != CHILD_END && type != FILE_END && type != REPORT_TIMER) {
         std::cerr << "#### You found a bug from cppcheck.\nThreadExecutor::handleRead error, type was:" << type << std::endl;
         std::exit(0);
     }
@@ -115,13 +122,19 @@ int ThreadExecutor::handleRead(int rpipe, unsigned int &result)
                     _errorLogger.reportInfo(msg);
             }
         }
-    } else if (type == CHILD_END) {
+    } else if (type == REPORT_TIMER) {
+        _timerResults.deserialize(buf);
+    } else if (type == CHILD_END || type == FILE_END) {
         std::istringstream iss(buf);
         unsigned int fileResult = 0;
-        iss >> fileResult;
+        std::size_t duplicates = 0;
+        MissingIncludes missingIncludes;
+        iss >> fileResult >> duplicates >> missingIncludes.user >> missingIncludes.system;
         result += fileResult;
+        _duplicatesDropped += duplicates;
+        _missingIncludes.merge(missingIncludes);
         delete [] buf;
-        return -1;
+        return (type == CHILD_END) ? -1 : 2;
     }
 
     delete [] buf;
@@ -149,6 +162,63 @@ bool ThreadExecutor::checkLoadAverage(size_t nchildren)
 }
 
 unsigned int ThreadExecutor::check()
+{
+    if (_settings.inProcessThreads)
+        return checkInProcess();
+    if (_settings.workerPool)
+        return checkWorkerPool();
+    return checkForkPerFile();
+}
+
+unsigned int ThreadExecutor::checkFile(ZKCheck &fileChecker, const std::string &file)
+{
+    const std::map<std::string, std::string>::const_iterator fileContent = _fileContents.find(file);
+    if (fileContent != _fileContents.end()) {
+        // File content was given as a string
+        return fileChecker.check(file, fileContent->second);
+    }
+
+    // Read file from a file
+    return fileChecker.check(file);
+}
+
+void ThreadExecutor::reportChildCrash(const std::string &file, int signal)
+{
+    std::ostringstream oss;
+    oss << "Internal error: Child process crashed with signal " << signal;
+
+    std::list<ErrorLogger::ErrorMessage::FileLocation> locations;
+    locations.push_back(ErrorLogger::ErrorMessage::FileLocation(file, 0));
+    const ErrorLogger::ErrorMessage errmsg(locations,
+                                           Severity::error,
+                                           oss.str(),
+                                           "cppcheckError",
+                                           false);
+
+    if (!_settings.nomsg.isSuppressed(errmsg._id, file, 0))
+        _errorLogger.reportErr(errmsg);
+}
+
+static void createResultPipe(int pipes[2])
+{
+    if (pipe(pipes) == -1) {
+        std::cerr << "pipe() failed: "<< std::strerror(errno) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    int flags = 0;
+    if ((flags = fcntl(pipes[0], F_GETFL, 0)) < 0) {
+        std::cerr << "fcntl(F_GETFL) failed: "<< std::strerror(errno) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (fcntl(pipes[0], F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::cerr << "fcntl(F_SETFL) failed: "<< std::strerror(errno) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+unsigned int ThreadExecutor::checkForkPerFile()
 {
     _fileCount = 0;
     unsigned int result = 0;
@@ -168,21 +238,7 @@ unsigned int ThreadExecutor::check()
         size_t nchildren = rpipes.size();
         if (i != _files.end() && nchildren < _settings.jobs && checkLoadAverage(nchildren)) {
             int pipes[2];
-            if (pipe(pipes) == -1) {
-                std::cerr << "pipe() failed: "<< std::strerror(errno) << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
-
-            int flags = 0;
-            if ((flags = fcntl(pipes[0], F_GETFL, 0)) < 0) {
-                std::cerr << "fcntl(F_GETFL) failed: "<< std::strerror(errno) << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
-
-            if (fcntl(pipes[0], F_SETFL, flags | O_NONBLOCK) < 0) {
-                std::cerr << "fcntl(F_SETFL) failed: "<< std::strerror(errno) << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
+            createResultPipe(pipes);
 
             pid_t pid = fork();
             if (pid < 0) {
@@ -193,20 +249,15 @@ unsigned int ThreadExecutor::check()
                 close(pipes[0]);
                 _wpipe = pipes[1];
 
-                CppCheck fileChecker(*this, false);
+                ZKCheck fileChecker(*this, false);
                 fileChecker.settings() = _settings;
-                unsigned int resultOfCheck = 0;
-
-                if (!_fileContents.empty() && _fileContents.find(i->first) != _fileContents.end()) {
-                    // File content was given as a string
-                    resultOfCheck = fileChecker.check(i->first, _fileContents[ i->first ]);
-                } else {
-                    // Read file from a file
-                    resultOfCheck = fileChecker.check(i->first);
-                }
+                const unsigned int resultOfCheck = checkFile(fileChecker, i->first);
+                if (!fileChecker.timerResults().empty())
+                    writeToPipe(REPORT_TIMER, fileChecker.timerResults().serialize());
 
                 std::ostringstream oss;
-                oss << resultOfCheck;
+                oss << resultOfCheck << ' ' << fileChecker.duplicatesDropped()
+                    << ' ' << fileChecker.missingIncludes().user << ' ' << fileChecker.missingIncludes().system;
                 writeToPipe(CHILD_END, oss.str());
                 std::exit(0);
             }
@@ -247,7 +298,7 @@ unsigned int ThreadExecutor::check()
                             _fileCount++;
                             processedsize += size;
                             if (!_settings.quiet)
-                                CppCheckExecutor::reportStatus(_fileCount, _files.size(), processedsize, totalfilesize);
+                                ZKCheckExecutor::reportStatus(_fileCount, _files.size(), processedsize, totalfilesize);
 
                             close(*rp);
                             rp = rpipes.erase(rp);
@@ -268,28 +319,255 @@ unsigned int ThreadExecutor::check()
                     childFile.erase(c);
                 }
 
-                if (WIFSIGNALED(stat)) {
-                    std::ostringstream oss;
-                    oss << "Internal error: Child process crashed with signal " << WTERMSIG(stat);
+                if (WIFSIGNALED(stat))
+                    reportChildCrash(childname, WTERMSIG(stat));
+            }
+        } else {
+            // All done
+            break;
+        }
+    }
+
+
+    return result;
+}
+
+namespace {
+    /** A pooled worker process, as seen from the parent */
+    struct Worker {
+        Worker() : pid(0), rpipe(-1), taskPipe(-1) {}
+
+        pid_t pid;
+
+        /** read end of the pipe the worker reports through */
+        int rpipe;
+
+        /** write end of the pipe the file names are sent through, -1 once closed */
+        int taskPipe;
+
+        /** file the worker is checking now, empty if the worker is idle */
+        std::string file;
+    };
+
+    bool readAll(int fd, char *buf, std::size_t len)
+    {
+        while (len > 0) {
+            const ssize_t r = read(fd, buf, len);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                return false;
+            buf += r;
+            len -= static_cast<std::size_t>(r);
+        }
+        return true;
+    }
+
+    bool writeAll(int fd, const char *buf, std::size_t len)
+    {
+        while (len > 0) {
+            const ssize_t r = write(fd, buf, len);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                return false;
+            buf += r;
+            len -= static_cast<std::size_t>(r);
+        }
+        return true;
+    }
+
+    /** Send the name of the next file to check to a worker */
+    bool writeTask(int taskPipe, const std::string &file)
+    {
+        const unsigned int len = static_cast<unsigned int>(file.size());
+        return writeAll(taskPipe, reinterpret_cast<const char *>(&len), sizeof(len)) &&
+               writeAll(taskPipe, file.data(), len);
+    }
+
+    /** Wait for the name of the next file to check. Returns false when the parent closed the task pipe. */
+    bool readTask(int taskPipe, std::string &file)
+    {
+        unsigned int len = 0;
+        if (!readAll(taskPipe, reinterpret_cast<char *>(&len), sizeof(len)))
+            return false;
+        file.resize(len);
+        return len == 0 || readAll(taskPipe, &file[0], len);
+    }
+}
+
+void ThreadExecutor::workerLoop(int taskPipe)
+{
+    ZKCheck fileChecker(*this, false);
+    fileChecker.settings() = _settings;
+
+    std::string file;
+    std::size_t duplicatesDropped = 0;
+    while (readTask(taskPipe, file)) {
+        const unsigned int resultOfCheck = checkFile(fileChecker, file);
+        if (!fileChecker.timerResults().empty()) {
+            writeToPipe(REPORT_TIMER, fileChecker.timerResults().serialize());
+            fileChecker.timerResults().clear();
+        }
+
+        std::ostringstream oss;
+        oss << resultOfCheck << ' ' << (fileChecker.duplicatesDropped() - duplicatesDropped)
+            << ' ' << fileChecker.missingIncludes().user << ' ' << fileChecker.missingIncludes().system;
+        writeToPipe(FILE_END, oss.str());
+        duplicatesDropped = fileChecker.duplicatesDropped();
+    }
+    close(taskPipe);
+}
+
+unsigned int ThreadExecutor::checkWorkerPool()
+{
+    _fileCount = 0;
+    unsigned int result = 0;
+
+    std::size_t totalfilesize = 0;
+    for (std::map<std::string, std::size_t>::const_iterator i = _files.begin(); i != _files.end(); ++i) {
+        totalfilesize += i->second;
+    }
+
+    // A worker that died must not take the parent with it when a file name is sent to it
+    void (*previousSigPipe)(int) = std::signal(SIGPIPE, SIG_IGN);
+
+    std::list<Worker> workers;
+    std::size_t processedsize = 0;
+    std::map<std::string, std::size_t>::const_iterator i = _files.begin();
+    for (;;) {
+        std::size_t busy = 0;
+        for (std::list<Worker>::const_iterator w = workers.begin(); w != workers.end(); ++w) {
+            if (!w->file.empty())
+                ++busy;
+        }
+
+        // Hand out files to idle workers
+        for (std::list<Worker>::iterator w = workers.begin(); w != workers.end() && i != _files.end(); ++w) {
+            if (!w->file.empty() || w->taskPipe < 0 || !checkLoadAverage(busy))
+                continue;
+            w->file = i->first;
+            ++busy;
+            ++i;
+            if (!writeTask(w->taskPipe, w->file)) {
+                // The worker is gone, it is reaped when its result pipe is closed
+                close(w->taskPipe);
+                w->taskPipe = -1;
+            }
+        }
 
-                    std::list<ErrorLogger::ErrorMessage::FileLocation> locations;
-                    locations.push_back(ErrorLogger::ErrorMessage::FileLocation(childname, 0));
-                    const ErrorLogger::ErrorMessage errmsg(locations,
-                                                           Severity::error,
-                                                           oss.str(),
-                                                           "cppcheckError",
-                                                           false);
+        // Start a new worker
+        if (i != _files.end() && workers.size() < _settings.jobs && checkLoadAverage(busy)) {
+            int resultPipes[2];
+            createResultPipe(resultPipes);
 
-                    if (!_settings.nomsg.isSuppressed(errmsg._id, childname, 0))
-                        _errorLogger.reportErr(errmsg);
+            int taskPipes[2];
+            if (pipe(taskPipes) == -1) {
+                std::cerr << "pipe() failed: "<< std::strerror(errno) << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                // Error
+                std::cerr << "Failed to create child process: "<< std::strerror(errno) << std::endl;
+                std::exit(EXIT_FAILURE);
+            } else if (pid == 0) {
+                // Only keep this worker's own ends of its own pipes
+                for (std::list<Worker>::const_iterator w = workers.begin(); w != workers.end(); ++w) {
+                    close(w->rpipe);
+                    if (w->taskPipe >= 0)
+                        close(w->taskPipe);
+                }
+                close(resultPipes[0]);
+                close(taskPipes[1]);
+                _wpipe = resultPipes[1];
+
+                workerLoop(taskPipes[0]);
+                std::exit(0);
+            }
+
+            close(resultPipes[1]);
+            close(taskPipes[0]);
+
+            Worker worker;
+            worker.pid = pid;
+            worker.rpipe = resultPipes[0];
+            worker.taskPipe = taskPipes[1];
+            workers.push_back(worker);
+            continue;
+        }
+
+        // Workers without anything left to do are told to exit by closing their task pipe
+        if (i == _files.end()) {
+            for (std::list<Worker>::iterator w = workers.begin(); w != workers.end(); ++w) {
+                if (w->file.empty() && w->taskPipe >= 0) {
+                    close(w->taskPipe);
+                    w->taskPipe = -1;
                 }
             }
-        } else {
+        }
+
+        if (workers.empty()) {
             // All done
             break;
         }
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        int maxfd = 0;
+        for (std::list<Worker>::const_iterator w = workers.begin(); w != workers.end(); ++w) {
+            FD_SET(w->rpipe, &rfds);
+            maxfd = std::max(maxfd, w->rpipe);
+        }
+        struct timeval tv; // for every second polling of load average condition
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+        if (select(maxfd + 1, &rfds, nullptr, nullptr, &tv) <= 0)
+            continue;
+
+        std::list<Worker>::iterator w = workers.begin();
+        while (w != workers.end()) {
+            if (!FD_ISSET(w->rpipe, &rfds)) {
+                ++w;
+                continue;
+            }
+
+            const int readRes = handleRead(w->rpipe, result);
+            if (readRes != 2 && readRes != -1) {
+                ++w;
+                continue;
+            }
+
+            if (readRes == -1) {
+                // The worker exited, either because its task pipe was closed or because it crashed
+                close(w->rpipe);
+                if (w->taskPipe >= 0)
+                    close(w->taskPipe);
+
+                int stat = 0;
+                waitpid(w->pid, &stat, 0);
+                if (WIFSIGNALED(stat))
+                    reportChildCrash(w->file, WTERMSIG(stat));
+            }
+
+            if (!w->file.empty()) {
+                std::map<std::string, std::size_t>::const_iterator fs = _files.find(w->file);
+                _fileCount++;
+                processedsize += (fs != _files.end()) ? fs->second : 0;
+                if (!_settings.quiet)
+                    ZKCheckExecutor::reportStatus(_fileCount, _files.size(), processedsize, totalfilesize);
+                w->file.clear();
+            }
+
+            if (readRes == -1)
+                w = workers.erase(w);
+            else
+                ++w;
+        }
     }
 
+    std::signal(SIGPIPE, previousSigPipe);
 
     return result;
 }
@@ -336,6 +614,9 @@ void ThreadExecutor::addFileContent(const std::string &path, const std::string &
 
 unsigned int ThreadExecutor::check()
 {
+    if (_settings.inProcessThreads)
+        return checkInProcess();
+
     HANDLE *threadHandles = new HANDLE[_settings.jobs];
 
     _itNextFile = _files.begin();
@@ -441,6 +722,12 @@ unsigned int __stdcall ThreadExecutor::threadProc(void *args)
             LeaveCriticalSection(&threadExecutor->_reportSync);
         }
     }
+
+    EnterCriticalSection(&threadExecutor->_fileSync);
+    threadExecutor->_duplicatesDropped += fileChecker.duplicatesDropped();
+    threadExecutor->_timerResults.merge(fileChecker.timerResults());
+    threadExecutor->_missingIncludes.merge(fileChecker.missingIncludes());
+    LeaveCriticalSection(&threadExecutor->_fileSync);
     return result;
 }
 
@@ -510,7 +797,7 @@ void ThreadExecutor::addFileContent(const std::string &/*path*/, const std::stri
 
 unsigned int ThreadExecutor::check()
 {
-    return 0;
+    return checkInProcess();
 }
 
 void ThreadExecutor::reportOut(const std::string &/*outmsg*/)
@@ -528,3 +815,198 @@ void ThreadExecutor::reportInfo(const ErrorLogger::ErrorMessage &/*msg*/)
 }
 
 #endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+////// Threads inside this process, available on all platforms ////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+    typedef std::map<std::string, std::size_t>::const_iterator FileIterator;
+
+    bool biggerFile(const FileIterator &a, const FileIterator &b)
+    {
+        if (a->second != b->second)
+            return a->second > b->second;
+        return a->first < b->first;
+    }
+
+    /**
+     * Files queued for one worker thread. The owner takes files from the
+     * front, other workers steal from the back.
+     */
+    class FileDeque {
+    public:
+        void push(FileIterator file) {
+            _files.push_back(file);
+        }
+
+        bool pop(FileIterator &file) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_files.empty())
+                return false;
+            file = _files.front();
+            _files.pop_front();
+            return true;
+        }
+
+        bool steal(FileIterator &file) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_files.empty())
+                return false;
+            file = _files.back();
+            _files.pop_back();
+            return true;
+        }
+
+    private:
+        std::deque<FileIterator> _files;
+        std::mutex _mutex;
+    };
+
+    /**
+     * State shared by all worker threads. It is also the ErrorLogger of
+     * their ZKCheck instances: messages are filtered and made unique here
+     * before they are passed on to the real ErrorLogger.
+     */
+    class InProcessState : public ErrorLogger {
+    public:
+        InProcessState(const std::map<std::string, std::size_t> &files, Settings &settings, ErrorLogger &errorLogger, const std::map<std::string, std::string> &fileContents, std::size_t workers)
+            : _files(files), _settings(settings), _errorLogger(errorLogger), _fileContents(fileContents), _deques(workers), _processedFiles(0), _processedSize(0), _totalFileSize(0) {
+            std::vector<FileIterator> bySize;
+            for (FileIterator i = _files.begin(); i != _files.end(); ++i) {
+                bySize.push_back(i);
+                _totalFileSize += i->second;
+            }
+            std::sort(bySize.begin(), bySize.end(), biggerFile);
+
+            // Deal the files out so that every deque starts with its biggest file
+            for (std::size_t i = 0; i < bySize.size(); ++i)
+                _deques[i % workers].push(bySize[i]);
+        }
+
+        /** Give a worker's ZKCheck its own copy of the settings */
+        void copySettings(ZKCheck &fileChecker) {
+            std::lock_guard<std::mutex> lock(_reportSync);
+            fileChecker.settings() = _settings;
+        }
+
+        /** Get the next file for a worker, stealing one if its own deque is empty */
+        bool nextFile(std::size_t worker, FileIterator &file) {
+            if (_deques[worker].pop(file))
+                return true;
+            for (std::size_t i = 1; i < _deques.size(); ++i) {
+                if (_deques[(worker + i) % _deques.size()].steal(file))
+                    return true;
+            }
+            return false;
+        }
+
+        unsigned int checkFile(ZKCheck &fileChecker, FileIterator file) {
+            const std::map<std::string, std::string>::const_iterator fileContent = _fileContents.find(file->first);
+            const unsigned int result = (fileContent != _fileContents.end())
+                                        ? fileChecker.check(file->first, fileContent->second)
+                                        : fileChecker.check(file->first);
+
+            std::lock_guard<std::mutex> lock(_reportSync);
+            _processedSize += file->second;
+            _processedFiles++;
+            if (!_settings.quiet)
+                ZKCheckExecutor::reportStatus(_processedFiles, _files.size(), _processedSize, _totalFileSize);
+            return result;
+        }
+
+        void reportOut(const std::string &outmsg) {
+            std::lock_guard<std::mutex> lock(_reportSync);
+            _errorLogger.reportOut(outmsg);
+        }
+
+        void reportErr(const ErrorLogger::ErrorMessage &msg) {
+            report(msg, false);
+        }
+
+        void reportInfo(const ErrorLogger::ErrorMessage &msg) {
+            report(msg, true);
+        }
+
+    private:
+        void report(const ErrorLogger::ErrorMessage &msg, bool info) {
+            std::string file;
+            unsigned int line(0);
+            if (!msg._callStack.empty()) {
+                file = msg._callStack.back().getfile(false);
+                line = msg._callStack.back().line;
+            }
+
+            // Alert only about unique errors
+            const std::string errmsg = msg.toString(_settings.verbose);
+
+            std::lock_guard<std::mutex> lock(_reportSync);
+            if (_settings.nomsg.isSuppressed(msg._id, file, line))
+                return;
+            if (!_errorList.insert(errmsg).second)
+                return;
+            if (info)
+                _errorLogger.reportInfo(msg);
+            else
+                _errorLogger.reportErr(msg);
+        }
+
+        const std::map<std::string, std::size_t> &_files;
+        Settings &_settings;
+        ErrorLogger &_errorLogger;
+        const std::map<std::string, std::string> &_fileContents;
+
+        std::vector<FileDeque> _deques;
+
+        /** guards the members below, _settings.nomsg and the calls to _errorLogger */
+        std::mutex _reportSync;
+        std::set<std::string> _errorList;
+        std::size_t _processedFiles;
+        std::size_t _processedSize;
+        std::size_t _totalFileSize;
+    };
+
+    void checkInProcessWorker(InProcessState *state, std::size_t worker, unsigned int *result, std::size_t *duplicatesDropped, TimerResults *timerResults, MissingIncludes *missingIncludes)
+    {
+        ZKCheck fileChecker(*state, false);
+        state->copySettings(fileChecker);
+
+        FileIterator file;
+        while (state->nextFile(worker, file))
+            *result += state->checkFile(fileChecker, file);
+        *duplicatesDropped = fileChecker.duplicatesDropped();
+        timerResults->merge(fileChecker.timerResults());
+        *missingIncludes = fileChecker.missingIncludes();
+    }
+}
+
+unsigned int ThreadExecutor::checkInProcess()
+{
+#if defined(THREADING_MODEL_FORK) || defined(THREADING_MODEL_WIN)
+    const std::map<std::string, std::string> &fileContents = _fileContents;
+#else
+    const std::map<std::string, std::string> fileContents;
+#endif
+
+    const std::size_t workers = std::max<std::size_t>(1U, std::min<std::size_t>(_settings.jobs, _files.size()));
+    InProcessState state(_files, _settings, _errorLogger, fileContents, workers);
+
+    std::vector<unsigned int> results(workers, 0U);
+    std::vector<std::size_t> duplicates(workers, 0U);
+    std::vector<TimerResults> timerResults(workers);
+    std::vector<MissingIncludes> missingIncludes(workers);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < workers; ++i)
+        threads.push_back(std::thread(checkInProcessWorker, &state, i, &results[i], &duplicates[i], &timerResults[i], &missingIncludes[i]));
+
+    unsigned int result = 0;
+    for (std::size_t i = 0; i < workers; ++i) {
+        threads[i].join();
+        result += results[i];
+        _duplicatesDropped += duplicates[i];
+        _timerResults.merge(timerResults[i]);
+        _missingIncludes.merge(missingIncludes[i]);
+    }
+    return result;
+}
@@ -6,6 +6,8 @@
 #include <string>
 #include <list>
 #include "errorlogger.h"
+#include "preprocessor.h"
+#include "timer.h"
 
 #ifndef THREADEXECUTOR_H
 #define THREADEXECUTOR_H
@@ -18,6 +20,7 @@
 #endif
 
 class Settings;
+class ZKCheck;
 
 /**
  * This class will take a list of filenames and settings and check then
@@ -42,27 +45,76 @@ public:
      */
     void addFileContent(const std::string &path, const std::string &content);
 
+    /** @brief Number of duplicate messages the ZKCheck instances of all workers dropped */
+    std::size_t duplicatesDropped() const {
+        return _duplicatesDropped;
+    }
+
+    /** @brief Times measured by the ZKCheck instances of all workers (--showtime) */
+    const TimerResults &timerResults() const {
+        return _timerResults;
+    }
+
+    /** @brief Include files that the workers did not find */
+    const MissingIncludes &missingIncludes() const {
+        return _missingIncludes;
+    }
+
 private:
     const std::map<std::string, std::size_t> &_files;
     Settings &_settings;
     ErrorLogger &_errorLogger;
     unsigned int _fileCount;
+    std::size_t _duplicatesDropped;
+    TimerResults _timerResults;
+    MissingIncludes _missingIncludes;
+
+    /**
+     * @brief Check the files with std::thread workers inside this process
+     * (--executor=thread). Each worker owns its own ZKCheck and a deque of
+     * files. The deques are seeded largest file first and a worker that
+     * runs out of files steals from the others.
+     */
+    unsigned int checkInProcess();
 
 #if defined(THREADING_MODEL_FORK)
 
     /** @brief Key is file name, and value is the content of the file */
     std::map<std::string, std::string> _fileContents;
 private:
-    enum PipeSignal {REPORT_OUT='1',REPORT_ERROR='2', REPORT_INFO='3', CHILD_END='4'};
+    enum PipeSignal {REPORT_OUT='1',REPORT_ERROR='2', REPORT_INFO='3', CHILD_END='4', FILE_END='5', REPORT_TIMER='6'};
 
     /**
      * Read from the pipe, parse and handle what ever is in there.
      *@return -1 in case of error
      *         0 if there is nothing in the pipe to be read
      *         1 if we did read something
+     *         2 if a pooled worker finished its file and is ready for the next one
      */
     int handleRead(int rpipe, unsigned int &result);
     void writeToPipe(PipeSignal type, const std::string &data);
+
+    /** @brief Fork one child process for each file */
+    unsigned int checkForkPerFile();
+
+    /**
+     * @brief Fork at most _settings.jobs worker processes and hand the
+     * files to them one by one through a task pipe (--worker-pool).
+     */
+    unsigned int checkWorkerPool();
+
+    /**
+     * @brief Main loop of a pooled worker. The Settings (and the loaded
+     * Library) are copied once and reused for every file that is read
+     * from @p taskPipe, until the parent closes it.
+     */
+    void workerLoop(int taskPipe);
+
+    /** @brief Check one file, using the given content if there is any */
+    unsigned int checkFile(ZKCheck &fileChecker, const std::string &file);
+
+    /** @brief Report that the child process checking @p file was killed by @p signal */
+    void reportChildCrash(const std::string &file, int signal);
     /**
      * Write end of status pipe, different for each child.
      * Not used in master process.
@@ -120,7 +172,7 @@ public:
      * @return true if support for threads exist.
      */
     static bool isEnabled() {
-        return false;
+        return true;
     }
 #endif
 
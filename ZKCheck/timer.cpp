@@ -0,0 +1,206 @@
+/*
+
+ */
+
+#include "timer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/** Innermost running timer of this thread, the parent of the next one */
+static thread_local Timer *currentTimer = nullptr;
+
+namespace {
+    typedef std::pair<std::string, TimerResultsData> dataElementType;
+
+    bool more_total(const dataElementType &lhs, const dataElementType &rhs)
+    {
+        return lhs.second._total > rhs.second._total;
+    }
+
+    bool more_self(const dataElementType &lhs, const dataElementType &rhs)
+    {
+        return lhs.second._self > rhs.second._self;
+    }
+
+    void showLine(std::ostream &out, const dataElementType &data, unsigned int depth)
+    {
+        const double sec = TimerResultsData::seconds(data.second._total);
+        const double secAverage = sec / (double)(data.second._numberOfResults);
+        out << std::string(2 * depth, ' ') << data.first << ": " << sec << "s (self "
+            << TimerResultsData::seconds(data.second._self) << "s, avg. " << secAverage << "s - "
+            << data.second._numberOfResults << " result(s))" << std::endl;
+    }
+}
+
+void TimerResults::ShowResults(SHOWTIME_MODES mode, std::ostream &out) const
+{
+    if (mode != SHOWTIME_SUMMARY && mode != SHOWTIME_TOP5)
+        return;
+
+    out << std::endl;
+    if (mode == SHOWTIME_TOP5) {
+        std::vector<dataElementType> data(_results.begin(), _results.end());
+        std::sort(data.begin(), data.end(), more_self);
+        if (data.size() > 5)
+            data.resize(5);
+        for (std::vector<dataElementType>::const_iterator iter = data.begin(); iter != data.end(); ++iter)
+            showLine(out, *iter, 0);
+    } else {
+        showTree(out, emptyString, 0);
+    }
+
+    Duration overall(0);
+    for (std::map<std::string, TimerResultsData>::const_iterator iter = _results.begin(); iter != _results.end(); ++iter)
+        overall += iter->second._self;
+    out << "Overall time: " << TimerResultsData::seconds(overall) << "s" << std::endl;
+}
+
+void TimerResults::showTree(std::ostream &out, const std::string &parent, unsigned int depth) const
+{
+    std::vector<dataElementType> children;
+    for (std::map<std::string, TimerResultsData>::const_iterator iter = _results.begin(); iter != _results.end(); ++iter) {
+        if (iter->second._parent == parent && iter->first != parent)
+            children.push_back(*iter);
+    }
+    std::sort(children.begin(), children.end(), more_total);
+    for (std::vector<dataElementType>::const_iterator iter = children.begin(); iter != children.end(); ++iter) {
+        showLine(out, *iter, depth);
+        showTree(out, iter->first, depth + 1);
+    }
+}
+
+void TimerResults::AddResults(const std::string &str, const std::string &parent, Duration total, Duration self)
+{
+    TimerResultsData &data = _results[str];
+    if (data._numberOfResults == 0)
+        data._parent = parent;
+    data._total += total;
+    data._self += self;
+    data._numberOfResults++;
+}
+
+void TimerResults::merge(const TimerResults &other)
+{
+    for (std::map<std::string, TimerResultsData>::const_iterator iter = other._results.begin(); iter != other._results.end(); ++iter) {
+        TimerResultsData &data = _results[iter->first];
+        if (data._numberOfResults == 0)
+            data._parent = iter->second._parent;
+        data._total += iter->second._total;
+        data._self += iter->second._self;
+        data._numberOfResults += iter->second._numberOfResults;
+    }
+}
+
+std::string TimerResults::serialize() const
+{
+    // name <tab> parent <tab> total <tab> self <tab> count, one timer per line
+    std::ostringstream oss;
+    for (std::map<std::string, TimerResultsData>::const_iterator iter = _results.begin(); iter != _results.end(); ++iter) {
+        oss << iter->first << '\t' << iter->second._parent << '\t'
+            << iter->second._total.count() << '\t' << iter->second._self.count() << '\t'
+            << iter->second._numberOfResults << '\n';
+    }
+    return oss.str();
+}
+
+void TimerResults::deserialize(const std::string &data)
+{
+    TimerResults other;
+    std::istringstream iss(data);
+    std::string line;
+    while (std::getline(iss, line)) {
+        const std::string::size_type tab1 = line.find('\t');
+        const std::string::size_type tab2 = (tab1 == std::string::npos) ? tab1 : line.find('\t', tab1 + 1);
+        if (tab2 == std::string::npos)
+            continue;
+        std::istringstream values(line.substr(tab2 + 1));
+        long long total = 0, self = 0;
+        long count = 0;
+        if (!(values >> total >> self >> count))
+            continue;
+        TimerResultsData &result = other._results[line.substr(0, tab1)];
+        result._parent = line.substr(tab1 + 1, tab2 - tab1 - 1);
+        result._total = Duration(total);
+        result._self = Duration(self);
+        result._numberOfResults = count;
+    }
+    merge(other);
+}
+
+Timer::Timer(const std::string &str, SHOWTIME_MODES showtimeMode, TimerResultsIntf *timerResults)
+    : _timerResults(timerResults)
+    , _children(0)
+    , _parent(nullptr)
+    , _depth(0)
+    , _showtimeMode(showtimeMode)
+    , _stopped(true)
+{
+    if (showtimeMode != SHOWTIME_NONE) {
+        _str = str;
+        start();
+    }
+}
+
+Timer::~Timer()
+{
+    Stop();
+}
+
+void Timer::start()
+{
+    _parent = currentTimer;
+    _depth = _parent ? _parent->_depth + 1 : 0;
+    _children = TimerResultsIntf::Duration(0);
+    _stopped = false;
+    currentTimer = this;
+    _start = std::chrono::steady_clock::now();
+}
+
+void Timer::Stop()
+{
+    if (_stopped)
+        return;
+    _stopped = true;
+
+    const TimerResultsIntf::Duration total = std::chrono::steady_clock::now() - _start;
+    if (currentTimer == this)
+        currentTimer = _parent;
+    if (_parent)
+        _parent->_children += total;
+
+    if (_showtimeMode == SHOWTIME_FILE) {
+        std::cout << std::string(2 * _depth, ' ') << _str << ": " << TimerResultsData::seconds(total) << "s" << std::endl;
+    } else if (_timerResults) {
+        _timerResults->AddResults(_str, _parent ? _parent->_str : emptyString, total, total - _children);
+    }
+}
+
+PassTimer::PassTimer(const char prefix[], SHOWTIME_MODES showtimeMode, TimerResultsIntf *timerResults)
+    : _prefix(prefix)
+    , _timer(emptyString, SHOWTIME_NONE, timerResults)
+{
+    _timer._showtimeMode = showtimeMode;
+}
+
+PassTimer::~PassTimer()
+{
+}
+
+void PassTimer::pass(const char name[])
+{
+    if (_timer._showtimeMode == SHOWTIME_NONE)
+        return;
+    _timer.Stop();
+    _timer._str = _prefix;
+    _timer._str += "::";
+    _timer._str += name;
+    _timer.start();
+}
+
+void PassTimer::stop()
+{
+    _timer.Stop();
+}
@@ -0,0 +1,150 @@
+/*
+
+ */
+
+#include "config.h"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+
+#ifndef timerH
+#define timerH
+
+enum SHOWTIME_MODES {
+    SHOWTIME_NONE = 0,
+    SHOWTIME_FILE,
+    SHOWTIME_SUMMARY,
+    SHOWTIME_TOP5
+};
+
+/** @brief Receiver of the times measured by Timer */
+class ZKCHECKLIB TimerResultsIntf {
+public:
+    typedef std::chrono::steady_clock::duration Duration;
+
+    virtual ~TimerResultsIntf() { }
+
+    /**
+     * @brief Add one measurement
+     * @param str name of the timer
+     * @param parent name of the timer that was running around it, empty if none
+     * @param total time from start to stop
+     * @param self total minus the time of the timers nested inside it
+     */
+    virtual void AddResults(const std::string &str, const std::string &parent, Duration total, Duration self) = 0;
+};
+
+struct TimerResultsData {
+    TimerResultsData() : _total(0), _self(0), _numberOfResults(0) {
+    }
+
+    TimerResultsIntf::Duration _total;
+    TimerResultsIntf::Duration _self;
+    long _numberOfResults;
+
+    /** name of the enclosing timer, empty for a top level timer */
+    std::string _parent;
+
+    static double seconds(TimerResultsIntf::Duration d) {
+        return std::chrono::duration<double>(d).count();
+    }
+};
+
+/**
+ * @brief Times of all timers, accumulated by name. The results of the
+ * ZKCheck instances of several workers are combined with merge(), forked
+ * workers send theirs as text (serialize() / deserialize()).
+ */
+class ZKCHECKLIB TimerResults : public TimerResultsIntf {
+public:
+    TimerResults() {
+    }
+
+    /**
+     * @brief Print the results
+     * SHOWTIME_SUMMARY prints all timers as a tree, nested timers below the
+     * timer they ran in. SHOWTIME_TOP5 prints the five timers with the
+     * largest self time.
+     */
+    void ShowResults(SHOWTIME_MODES mode, std::ostream &out) const;
+
+    virtual void AddResults(const std::string &str, const std::string &parent, Duration total, Duration self);
+
+    void merge(const TimerResults &other);
+
+    bool empty() const {
+        return _results.empty();
+    }
+
+    void clear() {
+        _results.clear();
+    }
+
+    std::string serialize() const;
+
+    /** @brief Add the results serialized by another process */
+    void deserialize(const std::string &data);
+
+private:
+    void showTree(std::ostream &out, const std::string &parent, unsigned int depth) const;
+
+    std::map<std::string, TimerResultsData> _results;
+};
+
+/**
+ * @brief Measures the time from construction until Stop() or destruction.
+ *
+ * Timers nest: a Timer started while another one is running in the same
+ * thread becomes its child, and the child's time is taken out of the self
+ * time of the parent. Nothing is measured if the mode is SHOWTIME_NONE.
+ */
+class ZKCHECKLIB Timer {
+public:
+    Timer(const std::string &str, SHOWTIME_MODES showtimeMode, TimerResultsIntf *timerResults = nullptr);
+    ~Timer();
+    void Stop();
+
+private:
+    Timer(const Timer &);
+    Timer &operator=(const Timer &);
+
+    void start();
+
+    friend class PassTimer;
+
+    std::string _str;
+    TimerResultsIntf *_timerResults;
+    std::chrono::steady_clock::time_point _start;
+    TimerResultsIntf::Duration _children;
+    Timer *_parent;
+    unsigned int _depth;
+    SHOWTIME_MODES _showtimeMode;
+    bool _stopped;
+};
+
+/**
+ * @brief Times the consecutive passes of one function. Each pass() stops
+ * the timer of the previous pass and starts a timer named
+ * "<prefix>::<name>" for the next one.
+ */
+class ZKCHECKLIB PassTimer {
+public:
+    PassTimer(const char prefix[], SHOWTIME_MODES showtimeMode, TimerResultsIntf *timerResults);
+    ~PassTimer();
+
+    void pass(const char name[]);
+
+    /** @brief Stop the timer of the current pass */
+    void stop();
+
+private:
+    PassTimer(const PassTimer &);
+    PassTimer &operator=(const PassTimer &);
+
+    const char *_prefix;
+    Timer _timer;
+};
+
+#endif // timerH
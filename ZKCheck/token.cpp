@@ -14,12 +14,103 @@
 #include <iostream>
 #include <cctype>
 #include <sstream>
+#include <cstdint>
 #include <map>
 #include <stack>
+#include <unordered_map>
 #include <algorithm>
+#include <bitset>
+
+// Every token slot starts with a header that points at the arena that owns
+// it, so that "delete tok" can give the memory back without knowing the
+// token list, and that holds the id of the slot.
+const std::size_t TokenArena::SLOT_SIZE = sizeof(TokenArena::Header) + sizeof(Token);
+static const std::size_t TOKENS_PER_BLOCK = 1024;
+
+const ValueFlow::ValueList Token::noValues;
+
+TokenCold::~TokenCold()
+{
+    delete valuetype;
+}
+
+TokenArena::TokenArena() :
+    _next(nullptr),
+    _end(nullptr),
+    _free(nullptr),
+    _ids(0)
+{
+}
+
+TokenArena::~TokenArena()
+{
+    for (std::vector<char *>::const_iterator it = _blocks.begin(); it != _blocks.end(); ++it)
+        delete[] *it;
+    for (std::vector<TokenCold *>::const_iterator it = _cold.begin(); it != _cold.end(); ++it)
+        delete *it;
+}
+
+void TokenArena::grow()
+{
+    static_assert(sizeof(Header) % alignof(Token) == 0, "tokens after the header must be aligned");
+    _blocks.push_back(new char[TOKENS_PER_BLOCK * SLOT_SIZE]);
+    _next = _blocks.back();
+    _end = _next + TOKENS_PER_BLOCK * SLOT_SIZE;
+    _progress.resize(_blocks.size() * TOKENS_PER_BLOCK);
+    _cold.resize(_blocks.size() * TOKENS_PER_BLOCK);
+}
+
+void *TokenArena::allocate()
+{
+    Header *slot;
+    if (_free) {
+        slot = static_cast<Header *>(_free);
+        _free = slot->owner;
+    } else {
+        if (_next == _end)
+            grow();
+        slot = reinterpret_cast<Header *>(_next);
+        slot->id = _ids++;
+        _next += SLOT_SIZE;
+    }
+    slot->owner = this;
+    return slot + 1;
+}
+
+void TokenArena::deallocate(void *p)
+{
+    Header *slot = static_cast<Header *>(p) - 1;
+    slot->owner = _free;
+    _free = slot;
+}
+
+bool TokenArena::contains(const Token *tok) const
+{
+    // the header of a deleted token links the free list instead
+    return header(tok)->owner == this;
+}
+
+void *Token::operator new(std::size_t size, TokenArena &arena)
+{
+    assert(size == sizeof(Token));
+    (void)size;
+    return arena.allocate();
+}
+
+void Token::operator delete(void *p, TokenArena &arena)
+{
+    arena.deallocate(p);
+}
+
+void Token::operator delete(void *p)
+{
+    if (p)
+        TokenArena::of(static_cast<const Token *>(p)).deallocate(p);
+}
 
 Token::Token(Token **t) :
     tokensBack(t),
+    _str(&emptyString),
     _next(0),
     _previous(0),
     _link(0),
@@ -28,66 +119,92 @@ Token::Token(Token **t) :
     _varId(0),
     _fileIndex(0),
     _linenr(0),
-    _progressValue(0),
     _tokType(eNone),
     _flags(0),
     _astOperand1(nullptr),
     _astOperand2(nullptr),
-    _astParent(nullptr),
-    _originalName(nullptr),
-    valuetype(nullptr)
+    _astParent(nullptr)
 {
+    progressValue(0);
 }
 
 Token::~Token()
 {
-    delete _originalName;
-    delete valuetype;
+    TokenCold *&c = TokenArena::of(this)._cold[TokenArena::id(this)];
+    delete c;
+    c = nullptr;
+}
+
+TokenCold &Token::makeCold()
+{
+    TokenCold *&c = TokenArena::of(this)._cold[TokenArena::id(this)];
+    if (!c)
+        c = new TokenCold;
+    return *c;
+}
+
+void Token::takeCold(Token *tok)
+{
+    TokenCold * const from = TokenArena::of(tok)._cold[TokenArena::id(tok)];
+    if (!from) {
+        clearValues();
+        return;
+    }
+    if (!from->originalName.empty())
+        makeCold().originalName.swap(from->originalName);
+    if (from->values.empty())
+        clearValues();
+    else
+        makeCold().values = from->values;
+    if (from->valuetype) {
+        setValueType(from->valuetype);
+        from->valuetype = nullptr;
+    }
 }
 
 void Token::update_property_info()
 {
-    if (!_str.empty()) {
-        if (_str == "true" || _str == "false")
+    if (!_str->empty()) {
+        if (*_str == "true" || *_str == "false")
             _tokType = eBoolean;
-        else if (_str[0] == '_' || std::isalpha((unsigned char)_str[0])) { // Name
+        else if ((*_str)[0] == '_' || std::isalpha((unsigned char)(*_str)[0])) { // Name
             if (_varId)
                 _tokType = eVariable;
             else if (_tokType != eVariable && _tokType != eFunction && _tokType != eType && _tokType != eKeyword)
                 _tokType = eName;
-        } else if (std::isdigit((unsigned char)_str[0]) || (_str.length() > 1 && _str[0] == '-' && std::isdigit((unsigned char)_str[1])))
+        } else if (std::isdigit((unsigned char)(*_str)[0]) || (_str->length() > 1 && (*_str)[0] == '-' && std::isdigit((unsigned char)(*_str)[1])))
             _tokType = eNumber;
-        else if (_str.length() > 1 && _str[0] == '"' && _str.back() == '"')
+        else if (_str->length() > 1 && (*_str)[0] == '"' && _str->back() == '"')
             _tokType = eString;
-        else if (_str.length() > 1 && _str[0] == '\'' && _str.back() == '\'')
+        else if (_str->length() > 1 && (*_str)[0] == '\'' && _str->back() == '\'')
             _tokType = eChar;
-        else if (_str == "=" || _str == "<<=" || _str == ">>=" ||
-                 (_str.size() == 2U && _str[1] == '=' && std::strchr("+-*/%&^|", _str[0])))
+        else if (*_str == "=" || *_str == "<<=" || *_str == ">>=" ||
+                 (_str->size() == 2U && (*_str)[1] == '=' && std::strchr("+-*/%&^|", (*_str)[0])))
             _tokType = eAssignmentOp;
-        else if (_str.size() == 1 && _str.find_first_of(",[]()?:") != std::string::npos)
+        else if (_str->size() == 1 && _str->find_first_of(",[]()?:") != std::string::npos)
             _tokType = eExtendedOp;
-        else if (_str=="<<" || _str==">>" || (_str.size()==1 && _str.find_first_of("+-*/%") != std::string::npos))
+        else if (*_str=="<<" || *_str==">>" || (_str->size()==1 && _str->find_first_of("+-*/%") != std::string::npos))
             _tokType = eArithmeticalOp;
-        else if (_str.size() == 1 && _str.find_first_of("&|^~") != std::string::npos)
+        else if (_str->size() == 1 && _str->find_first_of("&|^~") != std::string::npos)
             _tokType = eBitOp;
-        else if (_str.size() <= 2 &&
-                 (_str == "&&" ||
-                  _str == "||" ||
-                  _str == "!"))
+        else if (_str->size() <= 2 &&
+                 (*_str == "&&" ||
+                  *_str == "||" ||
+                  *_str == "!"))
             _tokType = eLogicalOp;
-        else if (_str.size() <= 2 && !_link &&
-                 (_str == "==" ||
-                  _str == "!=" ||
-                  _str == "<"  ||
-                  _str == "<=" ||
-                  _str == ">"  ||
-                  _str == ">="))
+        else if (_str->size() <= 2 && !_link &&
+                 (*_str == "==" ||
+                  *_str == "!=" ||
+                  *_str == "<"  ||
+                  *_str == "<=" ||
+                  *_str == ">"  ||
+                  *_str == ">="))
             _tokType = eComparisonOp;
-        else if (_str.size() == 2 &&
-                 (_str == "++" ||
-                  _str == "--"))
+        else if (_str->size() == 2 &&
+                 (*_str == "++" ||
+                  *_str == "--"))
             _tokType = eIncDecOp;
-        else if (_str.size() == 1 && (_str.find_first_of("{}") != std::string::npos || (_link && _str.find_first_of("<>") != std::string::npos)))
+        else if (_str->size() == 1 && (_str->find_first_of("{}") != std::string::npos || (_link && _str->find_first_of("<>") != std::string::npos)))
             _tokType = eBracket;
         else
             _tokType = eOther;
@@ -107,10 +224,10 @@ void Token::update_property_isStandardType()
 {
     isStandardType(false);
 
-    if (_str.size() < 3)
+    if (_str->size() < 3)
         return;
 
-    if (stdTypes.find(_str)!=stdTypes.end()) {
+    if (stdTypes.find(*_str)!=stdTypes.end()) {
         isStandardType(true);
         _tokType = eType;
     }
@@ -121,8 +238,8 @@ bool Token::isUpperCaseName() const
 {
     if (!isName())
         return false;
-    for (size_t i = 0; i < _str.length(); ++i) {
-        if (std::islower(_str[i]))
+    for (size_t i = 0; i < _str->length(); ++i) {
+        if (std::islower((*_str)[i]))
             return false;
     }
     return true;
@@ -130,8 +247,9 @@ bool Token::isUpperCaseName() const
 
 void Token::concatStr(std::string const& b)
 {
-    _str.erase(_str.length() - 1);
-    _str.append(b.begin() + 1, b.end());
+    std::string s(_str->begin(), _str->end() - 1);
+    s.append(b.begin() + 1, b.end());
+    _str = &TokenArena::of(this).intern(s);
 
     update_property_info();
 }
@@ -139,7 +257,7 @@ void Token::concatStr(std::string const& b)
 std::string Token::strValue() const
 {
     assert(_tokType == eString);
-    std::string ret(_str.substr(1, _str.length() - 2));
+    std::string ret(_str->substr(1, _str->length() - 2));
     std::string::size_type pos = 0U;
     while ((pos = ret.find('\\', pos)) != std::string::npos) {
         ret.erase(pos,1U);
@@ -189,10 +307,9 @@ void Token::swapWithNext()
         std::swap(_link, _next->_link);
         std::swap(_scope, _next->_scope);
         std::swap(_function, _next->_function);
-        std::swap(_originalName, _next->_originalName);
-        std::swap(values, _next->values);
-        std::swap(valuetype, _next->valuetype);
-        std::swap(_progressValue, _next->_progressValue);
+        TokenArena &arena = TokenArena::of(this);
+        std::swap(arena._cold[TokenArena::id(this)], arena._cold[TokenArena::id(_next)]);
+        std::swap(arena._progress[TokenArena::id(this)], arena._progress[TokenArena::id(_next)]);
     }
 }
 
@@ -210,17 +327,7 @@ void Token::deleteThis()
         _function = _next->_function;
         _variable = _next->_variable;
         _type = _next->_type;
-        if (_next->_originalName) {
-            delete _originalName;
-            _originalName = _next->_originalName;
-            _next->_originalName = nullptr;
-        }
-        values = _next->values;
-        if (_next->valuetype) {
-            delete valuetype;
-            valuetype = _next->valuetype;
-            _next->valuetype = nullptr;
-        }
+        takeCold(_next);
         if (_link)
             _link->link(this);
 
@@ -237,17 +344,7 @@ void Token::deleteThis()
         _function = _previous->_function;
         _variable = _previous->_variable;
         _type = _previous->_type;
-        if (_previous->_originalName) {
-            delete _originalName;
-            _originalName = _previous->_originalName;
-            _previous->_originalName = nullptr;
-        }
-        values = _previous->values;
-        if (_previous->valuetype) {
-            delete valuetype;
-            valuetype = _previous->valuetype;
-            _previous->valuetype = nullptr;
-        }
+        takeCold(_previous);
         if (_link)
             _link->link(this);
 
@@ -290,7 +387,7 @@ void Token::replace(Token *replaceThis, Token *start, Token *end)
 
     // Update _progressValue, fileIndex and linenr
     for (Token *tok = start; tok != end->next(); tok = tok->next())
-        tok->_progressValue = replaceThis->_progressValue;
+        tok->progressValue(replaceThis->progressValue());
 
     // Delete old token, which is replaced
     delete replaceThis;
@@ -322,7 +419,7 @@ const Token *Token::linkAt(int index) const
 const std::string &Token::strAt(int index) const
 {
     const Token *tok = this->tokAt(index);
-    return tok ? tok->_str : emptyString;
+    return tok ? *tok->_str : emptyString;
 }
 
 static int multiComparePercent(const Token *tok, const char*& haystack, unsigned int varid)
@@ -527,7 +624,7 @@ bool Token::simpleMatch(const Token *tok, const char pattern[])
     while (*current) {
         std::size_t length = next - current;
 
-        if (!tok || length != tok->_str.length() || std::strncmp(current, tok->_str.c_str(), length))
+        if (!tok || length != tok->_str->length() || std::strncmp(current, tok->_str->c_str(), length))
             return false;
 
         current = next;
@@ -570,7 +667,7 @@ const char *Token::chrInFirstWord(const char *str, char c)
     }
 }
 
-bool Token::Match(const Token *tok, const char pattern[], unsigned int varid)
+bool Token::matchText(const Token *tok, const char pattern[], unsigned int varid)
 {
     const char *p = pattern;
     while (*p) {
@@ -657,6 +754,311 @@ bool Token::Match(const Token *tok, const char pattern[], unsigned int varid)
     return true;
 }
 
+/**
+ * @brief A Token::Match pattern split into words and alternatives once, so
+ * that matching doesn't have to parse the pattern text again. The matching
+ * rules, including the corner cases of empty alternatives, are the same as
+ * in Token::matchText.
+ */
+class MatchPattern {
+public:
+    explicit MatchPattern(const char pattern[]);
+
+    bool match(const Token *tok, unsigned int varid) const;
+
+private:
+    /** %cmd% alternatives; Literal compares the token text */
+    enum Command {
+        Literal, Any, Assign, Bool, Char, Comp, Cop, Name, Num, Op, Or, OrOr, Type, Str, Var, VarId, Unknown
+    };
+
+    struct Alternative {
+        Command command;
+        std::string text;
+    };
+
+    /** One word of the pattern */
+    struct Step {
+        enum Kind { CharSet, Not, Multi } kind;
+
+        /** Not: the rejected token */
+        std::string text;
+
+        /**
+         * CharSet: the accepted characters. Multi: the first characters of
+         * the literal alternatives, to reject most tokens at once
+         */
+        std::bitset<256> chars;
+
+        /** Multi: some alternative is a %cmd% */
+        bool commands;
+
+        /** Multi: the alternatives in pattern order */
+        std::vector<Alternative> alternatives;
+
+        /** Multi: the word ends with an empty alternative */
+        bool emptyAlternative;
+
+        /** Multi: last word of the pattern, see multiCompare() */
+        bool last;
+    };
+
+    static Command parseCommand(const char *&p);
+    static bool matchCommand(const Token *tok, Command command, unsigned int varid);
+    static int multiCompare(const Token *tok, const Step &step, unsigned int varid);
+
+    std::vector<Step> _steps;
+};
+
+MatchPattern::MatchPattern(const char pattern[])
+{
+    const char *p = pattern;
+    while (*p) {
+        while (*p == ' ')
+            ++p;
+        if (*p == '\0')
+            break;
+
+        const char *end = p;
+        while (*end && *end != ' ')
+            ++end;
+
+        Step step;
+        step.emptyAlternative = false;
+        step.commands = false;
+        step.last = (*end == '\0');
+        if (p[0] == '[' && std::find(p, end, ']') != end) {
+            step.kind = Step::CharSet;
+            const std::size_t brackets = std::count(p + 1, end, ']');
+            for (const char *c = p + 1; c != end; ++c) {
+                if (*c != ']' || brackets > 1)
+                    step.chars.set(static_cast<unsigned char>(*c));
+            }
+        } else if (p[0] == '!' && p[1] == '!' && p[2] != '\0') {
+            step.kind = Step::Not;
+            step.text.assign(p + 2, end);
+        } else {
+            step.kind = Step::Multi;
+            const char *alt = p;
+            for (;;) {
+                Alternative alternative;
+                if (alt[0] == '%' && alt[1] != '|' && alt[1] != '\0' && alt[1] != ' ') {
+                    alternative.command = parseCommand(alt);
+                    step.alternatives.push_back(alternative);
+                    step.commands = true;
+                    // a %cmd% that isn't followed by '|' ends the alternatives
+                    if (alternative.command == Unknown || *alt != '|')
+                        break;
+                } else {
+                    const char *altEnd = alt;
+                    while (altEnd != end && *altEnd != '|')
+                        ++altEnd;
+                    alternative.command = Literal;
+                    alternative.text.assign(alt, altEnd);
+                    step.alternatives.push_back(alternative);
+                    step.chars.set(static_cast<unsigned char>(alternative.text.c_str()[0]));
+                    alt = altEnd;
+                    if (alt == end)
+                        break;
+                }
+                ++alt;
+                if (alt >= end) {
+                    step.emptyAlternative = true;
+                    break;
+                }
+            }
+        }
+        _steps.push_back(step);
+        p = end;
+    }
+}
+
+MatchPattern::Command MatchPattern::parseCommand(const char *&p)
+{
+    // Same lookahead as multiComparePercent()
+    ++p;
+    switch (p[0]) {
+    case 'v':
+        if (p[3] == '%') {
+            p += 4;
+            return Var;
+        }
+        p += 6;
+        return VarId;
+    case 't':
+        p += 5;
+        return Type;
+    case 'a':
+        if (p[3] == '%') {
+            p += 4;
+            return Any;
+        }
+        p += 7;
+        return Assign;
+    case 'n':
+        if (p[4] == '%') {
+            p += 5;
+            return Name;
+        }
+        p += 4;
+        return Num;
+    case 'c':
+        ++p;
+        if (p[0] == 'h') {
+            p += 4;
+            return Char;
+        } else if (p[1] == 'p') {
+            p += 3;
+            return Cop;
+        }
+        p += 4;
+        return Comp;
+    case 's':
+        p += 4;
+        return Str;
+    case 'b':
+        p += 5;
+        return Bool;
+    case 'o':
+        ++p;
+        if (p[1] == '%') {
+            const bool op = (p[0] == 'p');
+            p += 2;
+            return op ? Op : Or;
+        }
+        p += 4;
+        return OrOr;
+    default:
+        return Unknown;
+    }
+}
+
+bool MatchPattern::matchCommand(const Token *tok, Command command, unsigned int varid)
+{
+    switch (command) {
+    case Literal:
+        break;
+    case Any:
+        return true;
+    case Assign:
+        return tok->isAssignmentOp();
+    case Bool:
+        return tok->isBoolean();
+    case Char:
+        return tok->tokType() == Token::eChar;
+    case Comp:
+        return tok->isComparisonOp();
+    case Cop:
+        return tok->isConstOp();
+    case Name:
+        return tok->isName();
+    case Num:
+        return tok->isNumber();
+    case Op:
+        return tok->isOp();
+    case Or:
+        return tok->tokType() == Token::eBitOp && tok->str() == "|";
+    case OrOr:
+        return tok->tokType() == Token::eLogicalOp && tok->str() == "||";
+    case Type:
+        return tok->isName() && tok->varId() == 0 && !tok->isKeyword();
+    case Str:
+        return tok->tokType() == Token::eString;
+    case Var:
+        return tok->varId() != 0;
+    case VarId:
+        if (varid == 0)
+            throw InternalError(tok, "Internal error. Token::Match called with varid 0. Please report this to Cppcheck developers");
+        return tok->varId() == varid;
+    case Unknown:
+        throw InternalError(tok, "Unexpected command");
+    }
+    return false;
+}
+
+int MatchPattern::multiCompare(const Token *tok, const Step &step, unsigned int varid)
+{
+    const std::string &text = tok->str();
+    if (step.commands || step.chars.test(static_cast<unsigned char>(text.c_str()[0]))) {
+        for (std::vector<Alternative>::const_iterator it = step.alternatives.begin(); it != step.alternatives.end(); ++it) {
+            if (it->command == Literal) {
+                if (it->text.size() == text.size() && std::memcmp(it->text.data(), text.data(), text.size()) == 0)
+                    return 1;
+            } else if (matchCommand(tok, it->command, varid))
+                return 1;
+        }
+    }
+    if (!step.emptyAlternative)
+        return -1;
+    // the text matcher compares the empty token with the terminating '\0'
+    return (step.last && text.empty()) ? 1 : 0;
+}
+
+bool MatchPattern::match(const Token *tok, unsigned int varid) const
+{
+    for (std::vector<Step>::const_iterator step = _steps.begin(); step != _steps.end(); ++step) {
+        if (!tok) {
+            // If we have no tokens, pattern "!!else" should return true
+            if (step->kind == Step::Not)
+                continue;
+            return false;
+        }
+
+        switch (step->kind) {
+        case Step::CharSet:
+            if (tok->str().length() != 1 || !step->chars.test(static_cast<unsigned char>(tok->str()[0])))
+                return false;
+            break;
+        case Step::Not:
+            if (step->text == tok->str())
+                return false;
+            break;
+        case Step::Multi: {
+            const int res = multiCompare(tok, *step, varid);
+            if (res == 0) // Empty alternative matches, use the same token on next round
+                continue;
+            if (res == -1)
+                return false;
+        }
+        break;
+        }
+
+        tok = tok->next();
+    }
+
+    return true;
+}
+
+// Patterns are cached per thread so that the checks don't need a lock. A
+// direct-mapped table in front of the map serves the hot patterns.
+static const unsigned int PATTERN_CACHE_BITS = 12;
+static const std::size_t PATTERN_CACHE_SLOTS = 1U << PATTERN_CACHE_BITS;
+
+namespace {
+    struct PatternCacheSlot {
+        const char *pattern;
+        const MatchPattern *compiled;
+    };
+}
+
+static thread_local PatternCacheSlot patternCacheSlots[PATTERN_CACHE_SLOTS];
+
+bool Token::matchCached(const Token *tok, const char pattern[], unsigned int varid)
+{
+    // Fibonacci hashing spreads literals that are packed next to each other
+    const std::uint32_t address = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(pattern));
+    PatternCacheSlot &slot = patternCacheSlots[(address * 2654435761U) >> (32 - PATTERN_CACHE_BITS)];
+    if (slot.pattern != pattern) {
+        static thread_local std::unordered_map<const char *, MatchPattern> patterns;
+        std::unordered_map<const char *, MatchPattern>::const_iterator it = patterns.find(pattern);
+        if (it == patterns.end())
+            it = patterns.insert(std::make_pair(pattern, MatchPattern(pattern))).first;
+        slot.pattern = pattern;
+        slot.compiled = &it->second;
+    }
+    return slot.compiled->match(tok, varid);
+}
+
 std::size_t Token::getStrLength(const Token *tok)
 {
     assert(tok != nullptr);
@@ -746,7 +1148,7 @@ void Token::move(Token *srcStart, Token *srcEnd, Token *newLocation)
 
     // Update _progressValue
     for (Token *tok = srcStart; tok != srcEnd->next(); tok = tok->next())
-        tok->_progressValue = newLocation->_progressValue;
+        tok->progressValue(newLocation->progressValue());
 }
 
 Token* Token::nextArgument() const
@@ -796,7 +1198,7 @@ const Token * Token::findClosingBracket() const
 {
     const Token *closing = nullptr;
 
-    if (_str == "<") {
+    if (*_str == "<") {
         unsigned int depth = 0;
         for (closing = this; closing != nullptr; closing = closing->next()) {
             if (Token::Match(closing, "{|[|(")) {
@@ -875,16 +1277,16 @@ void Token::insertToken(const std::string &tokenStr, const std::string &original
         return;
 
     Token *newToken;
-    if (_str.empty())
+    if (_str->empty())
         newToken = this;
     else
-        newToken = new Token(tokensBack);
+        newToken = new (TokenArena::of(this)) Token(tokensBack);
     newToken->str(tokenStr);
     if (!originalNameStr.empty())
         newToken->originalName(originalNameStr);
     newToken->_linenr = _linenr;
     newToken->_fileIndex = _fileIndex;
-    newToken->_progressValue = _progressValue;
+    newToken->progressValue(progressValue());
 
     if (newToken != this) {
         if (prepend) {
@@ -960,14 +1362,14 @@ void Token::stringify(std::ostream& os, bool varid, bool attributes, bool macro)
     }
     if (macro && isExpandedMacro())
         os << "$";
-    if (_str[0] != '\"' || _str.find('\0') == std::string::npos)
-        os << _str;
+    if ((*_str)[0] != '\"' || _str->find('\0') == std::string::npos)
+        os << *_str;
     else {
-        for (std::size_t i = 0U; i < _str.size(); ++i) {
-            if (_str[i] == '\0')
+        for (std::size_t i = 0U; i < _str->size(); ++i) {
+            if ((*_str)[i] == '\0')
                 os << "\\0";
             else
-                os << _str[i];
+                os << (*_str)[i];
         }
     }
     if (varid && _varId != 0)
@@ -1195,8 +1597,8 @@ static void astStringXml(const Token *tok, std::size_t indent, std::ostream &out
         out << " variable=\"" << tok->variable() << '\"';
     if (tok->function())
         out << " function=\"" << tok->function() << '\"';
-    if (!tok->values.empty())
-        out << " values=\"" << &tok->values << '\"';
+    if (!tok->values().empty())
+        out << " values=\"" << &tok->values() << '\"';
 
     if (!tok->astOperand1() && !tok->astOperand2()) {
         out << "/>" << std::endl;
@@ -1251,9 +1653,9 @@ std::string Token::astStringVerbose(const unsigned int indent1, const unsigned i
 
     if (isExpandedMacro())
         ret += '$';
-    ret += _str;
-    if (valuetype)
-        ret += " \'" + valuetype->str() + '\'';
+    ret += *_str;
+    if (valueType())
+        ret += " \'" + valueType()->str() + '\'';
     ret += '\n';
 
     if (_astOperand1) {
@@ -1280,19 +1682,19 @@ void Token::printValueFlow(bool xml, std::ostream &out) const
     else
         out << "\n\n##Value flow" << std::endl;
     for (const Token *tok = this; tok; tok = tok->next()) {
-        if (tok->values.empty())
+        if (tok->values().empty())
             continue;
         if (xml)
-            out << "    <values id=\"" << &tok->values << "\">" << std::endl;
+            out << "    <values id=\"" << &tok->values() << "\">" << std::endl;
         else if (line != tok->linenr())
             out << "Line " << tok->linenr() << std::endl;
         line = tok->linenr();
         if (!xml) {
-            out << "  " << tok->str() << (tok->values.front().isKnown() ? " always " : " possible ");
-            if (tok->values.size() > 1U)
+            out << "  " << tok->str() << (tok->values().front().isKnown() ? " always " : " possible ");
+            if (tok->values().size() > 1U)
                 out << '{';
         }
-        for (std::list<ValueFlow::Value>::const_iterator it=tok->values.begin(); it!=tok->values.end(); ++it) {
+        for (ValueFlow::ValueList::const_iterator it=tok->values().begin(); it!=tok->values().end(); ++it) {
             if (xml) {
                 out << "      <value ";
                 if (it->tokvalue)
@@ -1309,7 +1711,7 @@ void Token::printValueFlow(bool xml, std::ostream &out) const
             }
 
             else {
-                if (it != tok->values.begin())
+                if (it != tok->values().begin())
                     out << ",";
                 if (it->tokvalue)
                     out << it->tokvalue->str();
@@ -1319,7 +1721,7 @@ void Token::printValueFlow(bool xml, std::ostream &out) const
         }
         if (xml)
             out << "    </values>" << std::endl;
-        else if (tok->values.size() > 1U)
+        else if (tok->values().size() > 1U)
             out << '}' << std::endl;
         else
             out << std::endl;
@@ -1331,7 +1733,8 @@ void Token::printValueFlow(bool xml, std::ostream &out) const
 const ValueFlow::Value * Token::getValueLE(const MathLib::bigint val, const Settings *settings) const
 {
     const ValueFlow::Value *ret = nullptr;
-    std::list<ValueFlow::Value>::const_iterator it;
+    const ValueFlow::ValueList &values = this->values();
+    ValueFlow::ValueList::const_iterator it;
     for (it = values.begin(); it != values.end(); ++it) {
         if (it->intvalue <= val && !it->tokvalue) {
             if (!ret || ret->inconclusive || (ret->condition && !it->inconclusive))
@@ -1352,7 +1755,8 @@ const ValueFlow::Value * Token::getValueLE(const MathLib::bigint val, const Sett
 const ValueFlow::Value * Token::getValueGE(const MathLib::bigint val, const Settings *settings) const
 {
     const ValueFlow::Value *ret = nullptr;
-    std::list<ValueFlow::Value>::const_iterator it;
+    const ValueFlow::ValueList &values = this->values();
+    ValueFlow::ValueList::const_iterator it;
     for (it = values.begin(); it != values.end(); ++it) {
         if (it->intvalue >= val && !it->tokvalue) {
             if (!ret || ret->inconclusive || (ret->condition && !it->inconclusive))
@@ -1374,7 +1778,8 @@ const Token *Token::getValueTokenMinStrSize() const
 {
     const Token *ret = nullptr;
     std::size_t minsize = ~0U;
-    std::list<ValueFlow::Value>::const_iterator it;
+    const ValueFlow::ValueList &values = this->values();
+    ValueFlow::ValueList::const_iterator it;
     for (it = values.begin(); it != values.end(); ++it) {
         if (it->tokvalue && it->tokvalue->tokType() == Token::eString) {
             std::size_t size = getStrSize(it->tokvalue);
@@ -1391,7 +1796,8 @@ const Token *Token::getValueTokenMaxStrLength() const
 {
     const Token *ret = nullptr;
     std::size_t maxlength = 0U;
-    std::list<ValueFlow::Value>::const_iterator it;
+    const ValueFlow::ValueList &values = this->values();
+    ValueFlow::ValueList::const_iterator it;
     for (it = values.begin(); it != values.end(); ++it) {
         if (it->tokvalue && it->tokvalue->tokType() == Token::eString) {
             std::size_t length = getStrLength(it->tokvalue);
@@ -1415,7 +1821,8 @@ const Token *Token::getValueTokenDeadPointer() const
 {
     const Scope * const functionscope = getfunctionscope(this->scope());
 
-    std::list<ValueFlow::Value>::const_iterator it;
+    const ValueFlow::ValueList &values = this->values();
+    ValueFlow::ValueList::const_iterator it;
     for (it = values.begin(); it != values.end(); ++it) {
         // Is this a pointer alias?
         if (!it->tokvalue || it->tokvalue->str() != "&")
@@ -1451,14 +1858,15 @@ void Token::assignProgressValues(Token *tok)
         ++total_count;
     unsigned int count = 0;
     for (Token *tok2 = tok; tok2; tok2 = tok2->next())
-        tok2->_progressValue = count++ * 100 / total_count;
+        tok2->progressValue(count++ * 100 / total_count);
 }
 
 void Token::setValueType(ValueType *vt)
 {
-    if (vt != valuetype) {
-        delete valuetype;
-        valuetype = vt;
+    if (vt != valueType()) {
+        TokenCold &c = makeCold();
+        delete c.valuetype;
+        c.valuetype = vt;
     }
 }
 
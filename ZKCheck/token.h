@@ -2,8 +2,11 @@
 
  */
 
+#include <cstddef>
 #include <list>
 #include <string>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 #include <ostream>
 #include "config.h"
@@ -16,10 +19,133 @@ class Function;
 class Variable;
 class ValueType;
 class Settings;
+class Token;
 
 #ifndef tokenH
 #define tokenH
 
+/**
+ * @brief Data of a token that the traversals of the token list don't need.
+ * It is kept out of the token, in a side table of the TokenArena, and only
+ * exists for the tokens that have some.
+ */
+struct ZKCHECKLIB TokenCold {
+    TokenCold() : valuetype(nullptr) {
+    }
+    ~TokenCold();
+
+    /** Values of the token, see Token::values() */
+    ValueFlow::ValueList values;
+
+    ValueType *valuetype;
+
+    /** original name like size_t, empty if the token has none */
+    std::string originalName;
+
+private:
+    /** Disable copy constructor, no implementation */
+    TokenCold(const TokenCold &);
+
+    /** Disable assignment operator, no implementation */
+    TokenCold &operator=(const TokenCold &);
+};
+
+/**
+ * @brief Memory for the tokens of one token list.
+ *
+ * Tokens are carved out of large blocks instead of being allocated one at a
+ * time. Tokens that are deleted by the simplifications are put on a free list
+ * and reused for new tokens. All blocks are released together when the arena
+ * is destroyed, so the arena must outlive every token allocated from it.
+ *
+ * The arena also interns the token texts: every distinct string is stored
+ * once, and tokens with equal texts point at the same string.
+ *
+ * Every slot has an id, which indexes the side tables that hold the data of
+ * the token that is rarely used, so that the tokens themselves stay small.
+ */
+class ZKCHECKLIB TokenArena {
+public:
+    TokenArena();
+    ~TokenArena();
+
+    /** @brief Get memory for one token */
+    void *allocate();
+
+    /** @brief Give back the memory of a destroyed token */
+    void deallocate(void *p);
+
+    /** @brief Arena that the given token was allocated from */
+    static TokenArena &of(const Token *tok) {
+        return *static_cast<TokenArena *>(header(tok)->owner);
+    }
+
+    /** @brief Id of the token, ids of deleted tokens are reused */
+    static unsigned int id(const Token *tok) {
+        return header(tok)->id;
+    }
+
+    /**
+     * @brief Is the token allocated from this arena and not deleted?
+     * The memory of a deleted token must still belong to some arena.
+     */
+    bool contains(const Token *tok) const;
+
+    /** @brief Interned copy of str, valid as long as the arena */
+    const std::string &intern(const std::string &str) {
+        return *_strings.insert(str).first;
+    }
+
+private:
+    friend class Token;
+
+    /** Start of every token slot */
+    struct Header {
+        /** the arena, or the next free slot if the token is deleted */
+        void *owner;
+
+        /** id of the slot, fixed when the slot is carved out of a block */
+        unsigned int id;
+    };
+
+    /** Size of a header and a token */
+    static const std::size_t SLOT_SIZE;
+
+    static Header *header(const Token *tok) {
+        return reinterpret_cast<Header *>(const_cast<char *>(reinterpret_cast<const char *>(tok)) - sizeof(Header));
+    }
+
+    /** Disable copy constructor, no implementation */
+    TokenArena(const TokenArena &);
+
+    /** Disable assignment operator, no implementation */
+    TokenArena &operator=(const TokenArena &);
+
+    /** Allocate a new block for _next.._end */
+    void grow();
+
+    /** Blocks owned by this arena */
+    std::vector<char *> _blocks;
+
+    /** Unused part of the last block */
+    char *_next, *_end;
+
+    /** Slots of deleted tokens, linked through their first bytes */
+    void *_free;
+
+    /** Interned token texts */
+    std::unordered_set<std::string> _strings;
+
+    /** Number of slots carved out of the blocks */
+    unsigned int _ids;
+
+    /** Progress values of the tokens, by id */
+    std::vector<unsigned char> _progress;
+
+    /** Cold data of the tokens by id, nullptr if a token has none */
+    std::vector<TokenCold *> _cold;
+};
+
 /**
  * @brief The token list that the TokenList generates is a linked-list of this class.
  *
@@ -52,9 +178,13 @@ public:
     explicit Token(Token **tokensBack);
     ~Token();
 
-    template<typename T>
-    void str(T&& s) {
-        _str = s;
+    /** @brief Tokens on the heap are allocated from the arena of their token list */
+    static void *operator new(std::size_t size, TokenArena &arena);
+    static void operator delete(void *p, TokenArena &arena);
+    static void operator delete(void *p);
+
+    void str(const std::string &s) {
+        _str = &TokenArena::of(this).intern(s);
         _varId = 0;
 
         update_property_info();
@@ -67,7 +197,16 @@ public:
     void concatStr(std::string const& b);
 
     const std::string &str() const {
-        return _str;
+        return *_str;
+    }
+
+    /**
+     * @brief Does this token have the same text as the other token?
+     * Texts are interned per token list, so for tokens of the same list
+     * this is a pointer comparison.
+     */
+    bool strEquals(const Token *tok) const {
+        return _str == tok->_str || (&TokenArena::of(this) != &TokenArena::of(tok) && *_str == *tok->_str);
     }
 
     /**
@@ -161,6 +300,11 @@ public:
      * "const" or "void" and token after that is '{'. If even one of the tokens does not
      * match its pattern, false is returned.
      *
+     * A pattern given as a string literal is compiled the first time it is
+     * used and the compiled form is cached by the address of the literal.
+     * A pattern given as a pointer, e.g. one built at runtime, is parsed on
+     * every call. Don't pass modifiable char arrays, they would be cached too.
+     *
      * @param tok List of tokens to be compared to the pattern
      * @param pattern The pattern against which the tokens are compared,
      * e.g. "const" or ") const|volatile| {".
@@ -169,7 +313,16 @@ public:
      * @return true if given token matches with given pattern
      *         false if given token does not match with given pattern
      */
-    static bool Match(const Token *tok, const char pattern[], unsigned int varid = 0);
+    template<std::size_t N>
+    static bool Match(const Token *tok, const char (&pattern)[N], unsigned int varid = 0) {
+        return matchCached(tok, pattern, varid);
+    }
+
+    template<typename T>
+    static typename std::enable_if<std::is_convertible<T, const char *>::value, bool>::type
+    Match(const Token *tok, T pattern, unsigned int varid = 0) {
+        return matchText(tok, pattern, varid);
+    }
 
     /**
      * @return length of C-string.
@@ -200,7 +353,8 @@ public:
     static std::string getCharAt(const Token *tok, std::size_t index);
 
     const ValueType *valueType() const {
-        return valuetype;
+        const TokenCold * const c = cold();
+        return c ? c->valuetype : nullptr;
     }
     void setValueType(ValueType *vt);
 
@@ -208,7 +362,7 @@ public:
         const Token *top = this;
         while (top && !Token::Match(top->astParent(), ",|("))
             top = top->astParent();
-        return top ? top->valuetype : nullptr;
+        return top ? top->valueType() : nullptr;
     }
 
     Token::Type tokType() const {
@@ -393,6 +547,12 @@ public:
         return const_cast<Token *>(findmatch(const_cast<const Token *>(startTok), pattern, end, varId));
     }
 
+    /** @brief Match() with the compiled form of a pattern literal, from the per-thread pattern cache */
+    static bool matchCached(const Token *tok, const char pattern[], unsigned int varid);
+
+    /** @brief Match() that parses the pattern text while matching */
+    static bool matchText(const Token *tok, const char pattern[], unsigned int varid);
+
     /**
      * Needle is build from multiple alternatives. If one of
      * them is equal to haystack, return value is 1. If there
@@ -439,7 +599,8 @@ public:
 
     /**
      * Insert new token after this token. This function will handle
-     * relations between next and previous token also.
+     * relations between next and previous token also. The new token is
+     * allocated from the same arena as this token.
      * @param tokenStr String for the new token.
      * @param originalNameStr String used for Token::originalName().
      * @param prepend Insert the new token before this token when it's not
@@ -531,7 +692,7 @@ public:
      */
     void link(Token *linkToToken) {
         _link = linkToToken;
-        if (_str == "<" || _str == ">")
+        if (*_str == "<" || *_str == ">")
             update_property_info();
     }
 
@@ -644,7 +805,7 @@ public:
 
     /** Get progressValue */
     unsigned int progressValue() const {
-        return _progressValue;
+        return TokenArena::of(this)._progress[TokenArena::id(this)];
     }
 
     /** Calculate progress values for all tokens */
@@ -683,7 +844,8 @@ public:
      * @return the original name.
      */
     const std::string & originalName() const {
-        return _originalName ? *_originalName : emptyString;
+        const TokenCold * const c = cold();
+        return c ? c->originalName : emptyString;
     }
 
     /**
@@ -691,17 +853,29 @@ public:
      */
     template<typename T>
     void originalName(T&& name) {
-        if (!_originalName)
-            _originalName = new std::string(name);
-        else
-            *_originalName = name;
+        makeCold().originalName = name;
     }
 
     /** Values of token */
-    std::list<ValueFlow::Value> values;
+    const ValueFlow::ValueList &values() const {
+        const TokenCold * const c = cold();
+        return c ? c->values : noValues;
+    }
+
+    /** @brief Values of the token for ValueFlow to change */
+    ValueFlow::ValueList &changeValues() {
+        return makeCold().values;
+    }
+
+    void clearValues() {
+        TokenCold * const c = TokenArena::of(this)._cold[TokenArena::id(this)];
+        if (c)
+            c->values.clear();
+    }
 
     const ValueFlow::Value * getValue(const MathLib::bigint val) const {
-        std::list<ValueFlow::Value>::const_iterator it;
+        const ValueFlow::ValueList &values = this->values();
+        ValueFlow::ValueList::const_iterator it;
         for (it = values.begin(); it != values.end(); ++it) {
             if (it->intvalue == val && !it->tokvalue)
                 return &(*it);
@@ -711,7 +885,8 @@ public:
 
     const ValueFlow::Value * getMaxValue(bool condition) const {
         const ValueFlow::Value *ret = nullptr;
-        std::list<ValueFlow::Value>::const_iterator it;
+        const ValueFlow::ValueList &values = this->values();
+        ValueFlow::ValueList::const_iterator it;
         for (it = values.begin(); it != values.end(); ++it) {
             if (it->tokvalue)
                 continue;
@@ -739,6 +914,23 @@ private:
         _previous = previousToken;
     }
 
+    void progressValue(unsigned int value) {
+        TokenArena::of(this)._progress[TokenArena::id(this)] = static_cast<unsigned char>(value);
+    }
+
+    const TokenCold *cold() const {
+        return TokenArena::of(this)._cold[TokenArena::id(this)];
+    }
+
+    /** Cold data of the token, created if there is none */
+    TokenCold &makeCold();
+
+    /** Take the original name, the values and the value type from tok, see deleteThis() */
+    void takeCold(Token *tok);
+
+    /** Shared by the tokens without values */
+    static const ValueFlow::ValueList noValues;
+
     /**
      * Works almost like strcmp() except returns only true or false and
      * if str has empty space &apos; &apos; character, that character is handled
@@ -753,7 +945,8 @@ private:
      */
     static const char *chrInFirstWord(const char *str, char c);
 
-    std::string _str;
+    /** Token text, interned in the arena of the token list */
+    const std::string *_str;
 
     Token *_next;
     Token *_previous;
@@ -771,12 +964,6 @@ private:
     unsigned int _fileIndex;
     unsigned int _linenr;
 
-    /**
-     * A value from 0-100 that provides a rough idea about where in the token
-     * list this token is located.
-     */
-    unsigned int _progressValue;
-
     Token::Type _tokType;
 
     enum {
@@ -831,11 +1018,9 @@ private:
     Token *_astOperand2;
     Token *_astParent;
 
-    // original name like size_t
-    std::string* _originalName;
-
-    // ValueType
-    ValueType *valuetype;
+    // The original name, the values, the ValueType and the progress value
+    // (a value from 0-100 that provides a rough idea about where in the
+    // token list this token is located) are in the side tables of the arena
 
 public:
     void astOperand1(Token *tok);
@@ -876,7 +1061,7 @@ public:
             ret = _astOperand1->astString(sep);
         if (_astOperand2)
             ret += _astOperand2->astString(sep);
-        return ret + sep + _str;
+        return ret + sep + *_str;
     }
 
     std::string astStringVerbose(const unsigned int indent1, const unsigned int indent2) const;
@@ -4,21 +4,25 @@
 
 //---------------------------------------------------------------------------
 #include "tokenize.h"
+#include "budget.h"
 #include "mathlib.h"
 #include "settings.h"
 #include "check.h"
 #include "path.h"
 #include "symboldatabase.h"
 #include "templatesimplifier.h"
-//#include "timer.h"
+#include "timer.h"
 #include "utils.h"
+#include "varidmap.h"
 
 #include <cstring>
 #include <sstream>
 #include <cassert>
 #include <cctype>
+#include <climits>
 #include <stack>
 #include <iostream>
+#include <unordered_map>
 
 //---------------------------------------------------------------------------
 
@@ -93,6 +97,7 @@ Tokenizer::Tokenizer() :
     _symbolDatabase(0),
     _varId(0),
     _codeWithTemplates(false), //is there any templates?
+    _unnamedCount(0),
     m_timerResults(nullptr)
 #ifdef MAXTIME
     ,maxtime(std::time(0) + MAXTIME)
@@ -107,6 +112,7 @@ Tokenizer::Tokenizer(const Settings *settings, ErrorLogger *errorLogger) :
     _symbolDatabase(0),
     _varId(0),
     _codeWithTemplates(false), //is there any templates?
+    _unnamedCount(0),
     m_timerResults(nullptr)
 #ifdef MAXTIME
     ,maxtime(std::time(0) + MAXTIME)
@@ -121,6 +127,17 @@ Tokenizer::~Tokenizer()
     delete _symbolDatabase;
 }
 
+bool Tokenizer::isMaxTime() const
+{
+    if (list.budget() && list.budget()->timeExceeded())
+        return true;
+#ifdef MAXTIME
+    return (std::time(0) > maxtime);
+#else
+    return false;
+#endif
+}
+
 
 //---------------------------------------------------------------------------
 // SizeOfType - gives the size of a type
@@ -383,7 +400,71 @@ struct Space {
     bool isNamespace;
 };
 
-static Token *splitDefinitionFromTypedef(Token *tok)
+namespace {
+    /**
+     * Upper bound of the number of name tokens with each text, so that
+     * simplifyTypedef() can skip the scan for a typedef whose name is not
+     * used after it. The bound is counted once and never decreased. The
+     * texts that the substitutions copy into the token list (the type of a
+     * typedef, class names) are marked as unbounded before they are copied.
+     */
+    class TypedefNameIndex {
+    public:
+        explicit TypedefNameIndex(const Token *tok) : _enabled(tok != nullptr) {
+            // The scan reports a syntax error for 'operator ( ) {' at the start of the code
+            if (tok && tok->str() == "operator")
+                _enabled = false;
+            for (; tok; tok = tok->next()) {
+                if (tok->isName())
+                    ++_count[&tok->str()];
+            }
+        }
+
+        /** @brief Tokens with this text may be copied any number of times */
+        void copied(const std::string &str) {
+            _count[&str] = UINT_MAX;
+        }
+
+        /** @brief Texts of the names from start to end, except skip, may be copied */
+        void copied(const Token *start, const Token *end, const Token *skip) {
+            for (const Token *tok = start; tok; tok = tok->next()) {
+                if (tok != skip && tok->isName())
+                    copied(tok->str());
+                if (tok == end)
+                    break;
+            }
+        }
+
+        /**
+         * @brief Is there a token with the text of name after end?
+         * @param start first token of the typedef, before end
+         * @param end last token that was parsed of the typedef
+         * @param name typedef name
+         */
+        bool usedAfter(const Token *start, const Token *end, const Token *name) const {
+            if (!_enabled)
+                return true;
+            const std::unordered_map<const std::string *, unsigned int>::const_iterator it = _count.find(&name->str());
+            if (it == _count.end() || it->second == UINT_MAX)
+                return true;
+            unsigned int count = 0;
+            for (const Token *tok = start; tok; tok = tok->next()) {
+                if (tok->strEquals(name))
+                    ++count;
+                if (tok == end)
+                    break;
+            }
+            return count < it->second;
+        }
+
+    private:
+        /** Token texts are interned, the key is the address of the interned text */
+        std::unordered_map<const std::string *, unsigned int> _count;
+        bool _enabled;
+    };
+}
+
+static Token *splitDefinitionFromTypedef(Token *tok, unsigned int &unnamedCount, TypedefNameIndex &nameIndex)
 {
     Token *tok1;
     std::string name;
@@ -402,10 +483,10 @@ static Token *splitDefinitionFromTypedef(Token *tok)
             if (Token::Match(tok1->next(), "%type%"))
                 name = tok1->next()->str();
             else { // create a unique name
-                static unsigned int count = 0;
-                name = "Unnamed" + MathLib::toString(count++);
+                name = "Unnamed" + MathLib::toString(unnamedCount++);
             }
             tok->next()->insertToken(name);
+            nameIndex.copied(tok->strAt(2));
         } else
             return nullptr;
     } else if (tok->strAt(3) == ":") {
@@ -445,6 +526,7 @@ static Token *splitDefinitionFromTypedef(Token *tok)
         tok1->insertToken(tok->next()->str()); // struct, union or enum
         tok1 = tok1->next();
         tok1->insertToken(name);
+        nameIndex.copied(tok1->strAt(1));
         tok->deleteThis();
         tok = tok3;
     }
@@ -519,6 +601,7 @@ Token *Tokenizer::processFunc(Token *tok2, bool inOperator) const
 
 void Tokenizer::simplifyTypedef()
 {
+    TypedefNameIndex nameIndex(list.front());
     std::vector<Space> spaceInfo;
     bool isNamespace = false;
     std::string className;
@@ -549,6 +632,8 @@ void Tokenizer::simplifyTypedef()
                 isNamespace = (tok->str() == "namespace");
                 hasClass = true;
                 className = tok->next()->str();
+                // the substitutions insert class names
+                nameIndex.copied(tok->next()->str());
             } else if (hasClass && tok->str() == ";") {
                 hasClass = false;
             } else if (hasClass && tok->str() == "{") {
@@ -568,7 +653,7 @@ void Tokenizer::simplifyTypedef()
         // pull struct, union, enum or class definition out of typedef
         // use typedef name for unnamed struct, union, enum or class
         if (Token::Match(tok->next(), "const| struct|enum|union|class %type%| {")) {
-            Token *tok1 = splitDefinitionFromTypedef(tok);
+            Token *tok1 = splitDefinitionFromTypedef(tok, _unnamedCount, nameIndex);
             if (!tok1)
                 continue;
             tok = tok1;
@@ -577,7 +662,7 @@ void Tokenizer::simplifyTypedef()
             while (tok1 && tok1->str() != ";" && tok1->str() != "{")
                 tok1 = tok1->next();
             if (tok1 && tok1->str() == "{") {
-                tok1 = splitDefinitionFromTypedef(tok);
+                tok1 = splitDefinitionFromTypedef(tok, _unnamedCount, nameIndex);
                 if (!tok1)
                     continue;
                 tok = tok1;
@@ -987,7 +1072,15 @@ void Tokenizer::simplifyTypedef()
             bool globalScope = false;
             std::size_t classLevel = spaceInfo.size();
 
-            for (Token *tok2 = tok; tok2; tok2 = tok2->next()) {
+            // The substitutions copy the type. A lone 'typename', 'class'
+            // or 'struct' type may be skipped up to the typedef name.
+            const bool typeMayReachName = (typeStart == typeEnd && Token::Match(typeStart, "typename|class|struct"));
+            nameIndex.copied(typeDef, tok, typeMayReachName ? nullptr : typeName);
+
+            // Nothing is changed unless the typedef name is found after the typedef
+            Token *scanStart = nameIndex.usedAfter(typeDef, tok, typeName) ? tok : nullptr;
+
+            for (Token *tok2 = scanStart; tok2; tok2 = tok2->next()) {
                 if (_settings->terminated())
                     return;
 
@@ -1660,6 +1753,15 @@ bool Tokenizer::createTokens(std::istream &code,
     return list.createTokens(code, Path::getRelativePath(Path::simplifyPath(FileName), _settings->basePaths));
 }
 
+bool Tokenizer::createTokens(const std::string &code,
+                             const char FileName[])
+{
+    // make sure settings specified
+    assert(_settings);
+
+    return list.createTokens(code.data(), code.size(), Path::getRelativePath(Path::simplifyPath(FileName), _settings->basePaths));
+}
+
 bool Tokenizer::simplifyTokens1(const std::string &configuration,
                                 bool noSymbolDB_AST)
 {
@@ -1668,8 +1770,11 @@ bool Tokenizer::simplifyTokens1(const std::string &configuration,
 
     _configuration = configuration;
 
+    PassTimer passes("Tokenizer::simplifyTokens1", _settings->showtime, m_timerResults);
+    passes.pass("simplifyTokenList1");
     if (simplifyTokenList1(list.getFiles()[0].c_str())) {
         if (!noSymbolDB_AST) {
+            passes.pass("createSymbolDatabase");
             createSymbolDatabase();
 
             // Use symbol database to identify rvalue references. Split && to & &. This is safe, since it doesn't delete any tokens (which might be referenced by symbol database)
@@ -1683,12 +1788,18 @@ bool Tokenizer::simplifyTokens1(const std::string &configuration,
                 }
             }
 
+            passes.pass("createAst");
             list.createAst();
             list.validateAst();
 
+            passes.pass("setValueType");
             SymbolDatabase::setValueTypeInTokenList(list.front(), isCPP(), _settings->defaultSign);
-            ValueFlow::setValues(&list, _symbolDatabase, _errorLogger, _settings);
+            passes.pass("ValueFlow");
+            if (list.budget())
+                list.budget()->check(list.front());
+            ValueFlow::setValues(&list, _symbolDatabase, _errorLogger, _settings, m_timerResults);
         }
+        passes.stop();
 
         printDebugOutput(1);
 
@@ -1716,11 +1827,8 @@ bool Tokenizer::tokenizeCondition(const std::string &code)
     // Fill the map _typeSize..
     fillTypeSizes();
 
-    {
-        std::istringstream istr(code);
-        if (!list.createTokens(istr))
-            cppcheckError(nullptr);
-    }
+    if (!list.createTokens(code.data(), code.size()))
+        cppcheckError(nullptr);
 
     // Combine strings
     combineStrings();
@@ -1820,72 +1928,78 @@ void Tokenizer::combineOperators()
     for (Token *tok = list.front();
          tok && tok->next();
          tok = tok->next()) {
-        const char c1 = tok->str()[0];
+        tok = combineOperators(tok, cpp);
+    }
+}
+
+Token *Tokenizer::combineOperators(Token *tok, bool cpp)
+{
+    const char c1 = tok->str()[0];
 
-        if (tok->str().length() == 1 && tok->next()->str().length() == 1) {
-            const char c2 = tok->next()->str()[0];
+    if (tok->str().length() == 1 && tok->next()->str().length() == 1) {
+        const char c2 = tok->next()->str()[0];
 
-            // combine +-*/ and =
-            if (c2 == '=' && (std::strchr("+-*/%&|^=!<>", c1))) {
-                tok->str(tok->str() + c2);
-                tok->deleteNext();
-                continue;
-            }
+        // combine +-*/ and =
+        if (c2 == '=' && (std::strchr("+-*/%&|^=!<>", c1))) {
+            tok->str(tok->str() + c2);
+            tok->deleteNext();
+            return tok;
+        }
 
-            // simplify "->"
-            else if (c1 == '-' && c2 == '>') {
-                // If the preceding sequence is "( & %name% )", replace it by "%name%"
-                Token *t = tok->tokAt(-4);
-                if (t && Token::Match(t, "( & %name% )")) {
-                    t->deleteThis();
-                    t->deleteThis();
-                    t->deleteNext();
-                    tok = t->next();
-                }
-                // Replace "->" with "."
-                tok->str(".");
-                tok->originalName("->");
-                tok->deleteNext();
-                continue;
+        // simplify "->"
+        else if (c1 == '-' && c2 == '>') {
+            // If the preceding sequence is "( & %name% )", replace it by "%name%"
+            Token *t = tok->tokAt(-4);
+            if (t && Token::Match(t, "( & %name% )")) {
+                t->deleteThis();
+                t->deleteThis();
+                t->deleteNext();
+                tok = t->next();
             }
-        } else if (tok->next()->str() == "=") {
-            if (tok->str() == ">>") {
-                tok->str(">>=");
-                tok->deleteNext();
-            } else if (tok->str() == "<<") {
-                tok->str("<<=");
-                tok->deleteNext();
-            }
-        } else if (cpp && (c1 == 'p' || c1 == '_') &&
-                   Token::Match(tok, "private|protected|public|__published : !!:")) {
-            bool simplify = false;
-            unsigned int par = 0U;
-            for (const Token *prev = tok->tokAt(-1); prev; prev = prev->previous()) {
-                if (prev->str() == ")") {
-                    ++par;
-                } else if (prev->str() == "(") {
-                    if (par == 0U)
-                        break;
-                    --par;
-                }
-                if (par != 0U || prev->str() == "(")
-                    continue;
-                if (Token::Match(prev, "[;{}]")) {
-                    simplify = true;
+            // Replace "->" with "."
+            tok->str(".");
+            tok->originalName("->");
+            tok->deleteNext();
+            return tok;
+        }
+    } else if (tok->next()->str() == "=") {
+        if (tok->str() == ">>") {
+            tok->str(">>=");
+            tok->deleteNext();
+        } else if (tok->str() == "<<") {
+            tok->str("<<=");
+            tok->deleteNext();
+        }
+    } else if (cpp && (c1 == 'p' || c1 == '_') &&
+               Token::Match(tok, "private|protected|public|__published : !!:")) {
+        bool simplify = false;
+        unsigned int par = 0U;
+        for (const Token *prev = tok->tokAt(-1); prev; prev = prev->previous()) {
+            if (prev->str() == ")") {
+                ++par;
+            } else if (prev->str() == "(") {
+                if (par == 0U)
                     break;
-                }
-                if (prev->isName() && prev->isUpperCaseName())
-                    continue;
-                if (prev->isName() && prev->str()[prev->str().size() - 1U] == ':')
-                    simplify = true;
-                break;
+                --par;
             }
-            if (simplify) {
-                tok->str(tok->str() + ":");
-                tok->deleteNext();
+            if (par != 0U || prev->str() == "(")
+                continue;
+            if (Token::Match(prev, "[;{}]")) {
+                simplify = true;
+                break;
             }
+            if (prev->isName() && prev->isUpperCaseName())
+                continue;
+            if (prev->isName() && prev->str()[prev->str().size() - 1U] == ':')
+                simplify = true;
+            break;
+        }
+        if (simplify) {
+            tok->str(tok->str() + ":");
+            tok->deleteNext();
         }
     }
+    return tok;
 }
 
 void Tokenizer::combineStrings()
@@ -1940,37 +2054,70 @@ void Tokenizer::simplifyFileAndLineMacro()
 
 void Tokenizer::simplifyNull()
 {
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->str() == "NULL" && (!Token::Match(tok->previous(), "[(,] NULL [,)]") || tok->strAt(-2) == "="))
-            tok->str("0");
-        else if (tok->str() == "__null" || tok->str() == "'\\0'" || tok->str() == "'\\x0'") {
-            tok->originalName(tok->str());
-            tok->str("0");
-        }
-    }
+    const bool nullptrIsNull = isCPP() && _settings->standards.cpp == Standards::CPP11;
+    for (Token *tok = list.front(); tok; tok = tok->next())
+        simplifyNull(tok, nullptrIsNull);
+}
 
-    // nullptr..
-    if (isCPP() && _settings->standards.cpp == Standards::CPP11) {
-        for (Token *tok = list.front(); tok; tok = tok->next()) {
-            if (tok->str() == "nullptr")
-                tok->str("0");
-        }
-    }
+void Tokenizer::simplifyNull(Token *tok, bool nullptrIsNull)
+{
+    if (tok->str() == "NULL" && (!Token::Match(tok->previous(), "[(,] NULL [,)]") || tok->strAt(-2) == "="))
+        tok->str("0");
+    else if (tok->str() == "__null" || tok->str() == "'\\0'" || tok->str() == "'\\x0'") {
+        tok->originalName(tok->str());
+        tok->str("0");
+    } else if (nullptrIsNull && tok->str() == "nullptr")
+        tok->str("0");
 }
 
 void Tokenizer::concatenateNegativeNumberAndAnyPositive()
 {
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (!Token::Match(tok, "?|:|,|(|[|{|return|case|sizeof|%op% +|-") || tok->tokType() == Token::eIncDecOp)
-            continue;
+    for (Token *tok = list.front(); tok; tok = tok->next())
+        concatenateNegativeNumberAndAnyPositive(tok);
+}
 
-        while (tok->next() && tok->next()->str() == "+")
-            tok->deleteNext();
+void Tokenizer::concatenateNegativeNumberAndAnyPositive(Token *tok)
+{
+    if (!Token::Match(tok, "?|:|,|(|[|{|return|case|sizeof|%op% +|-") || tok->tokType() == Token::eIncDecOp)
+        return;
 
-        if (Token::Match(tok->next(), "- %num%")) {
-            tok->deleteNext();
-            tok->next()->str("-" + tok->next()->str());
+    while (tok->next() && tok->next()->str() == "+")
+        tok->deleteNext();
+
+    if (Token::Match(tok->next(), "- %num%")) {
+        tok->deleteNext();
+        tok->next()->str("-" + tok->next()->str());
+    }
+}
+
+void Tokenizer::simplifyCAlternativeTokensAndNull()
+{
+    // Neither pass looks at what the other one changes: the alternative
+    // tokens are names that become operators, NULL becomes a number, and
+    // the patterns of both accept a name and a number alike.
+    const bool nullptrIsNull = isCPP() && _settings->standards.cpp == Standards::CPP11;
+    unsigned int executableScopeLevel = 0;
+    for (Token *tok = list.front(); tok; tok = tok->next()) {
+        simplifyCAlternativeTokens(tok, executableScopeLevel);
+        simplifyNull(tok, nullptrIsNull);
+    }
+}
+
+void Tokenizer::combineOperatorsAndNegativeNumbers()
+{
+    // "- %num%" after a token is combined before the operators of the
+    // token and the next one are, that is what combineOperators() sees
+    // when it runs after concatenateNegativeNumberAndAnyPositive().
+    const bool cpp = isCPP();
+    Token *pending = list.front();
+    for (Token *tok = list.front(); tok; tok = tok->next()) {
+        while (pending && (pending == tok || pending == tok->next())) {
+            concatenateNegativeNumberAndAnyPositive(pending);
+            pending = pending->next();
         }
+        if (!tok->next())
+            break;
+        tok = combineOperators(tok, cpp);
     }
 }
 
@@ -2345,12 +2492,13 @@ void Tokenizer::simplifyTemplates()
 #else
         0, // ignored
 #endif
-        _codeWithTemplates);
+        _codeWithTemplates,
+        m_timerResults);
 }
 //---------------------------------------------------------------------------
 
 
-static bool setVarIdParseDeclaration(const Token **tok, const std::map<std::string,unsigned int> &variableId, bool executableScope, bool cpp, bool c)
+static bool setVarIdParseDeclaration(const Token **tok, const ScopedVarIds &variableId, bool executableScope, bool cpp, bool c)
 {
     const Token *tok2 = *tok;
     if (!tok2->isName())
@@ -2371,7 +2519,7 @@ static bool setVarIdParseDeclaration(const Token **tok, const std::map<std::stri
                 singleNameCount = 0;
             } else if (tok2->str() == "const") {
                 ;  // just skip "const"
-            } else if (!hasstruct && variableId.find(tok2->str()) != variableId.end() && tok2->previous()->str() != "::") {
+            } else if (!hasstruct && variableId.find(tok2->str()) && tok2->previous()->str() != "::") {
                 ++typeCount;
                 tok2 = tok2->next();
                 if (!tok2 || tok2->str() != "::")
@@ -2428,7 +2576,7 @@ static bool setVarIdParseDeclaration(const Token **tok, const std::map<std::stri
 
 
 static void setVarIdStructMembers(Token **tok1,
-                                  std::map<unsigned int, std::map<std::string, unsigned int> >& structMembers,
+                                  VarIdTable &structMembers,
                                   unsigned int *_varId)
 {
     Token *tok = *tok1;
@@ -2442,13 +2590,12 @@ static void setVarIdStructMembers(Token **tok1,
         if (TemplateSimplifier::templateParameters(tok->next()) > 0)
             break;
 
-        std::map<std::string, unsigned int>& members = structMembers[struct_varid];
-        const std::map<std::string, unsigned int>::iterator it = members.find(tok->str());
-        if (it == members.end()) {
-            members[tok->str()] = ++(*_varId);
+        unsigned int &memberId = structMembers(tok->str(), struct_varid);
+        if (memberId == 0) {
+            memberId = ++(*_varId);
             tok->varId(*_varId);
         } else {
-            tok->varId(it->second);
+            tok->varId(memberId);
         }
     }
     // tok can't be null
@@ -2457,9 +2604,9 @@ static void setVarIdStructMembers(Token **tok1,
 
 
 void Tokenizer::setVarIdClassDeclaration(Token * const startToken,
-        const std::map<std::string, unsigned int> &variableId,
+        const ScopedVarIds &variableId,
         const unsigned int scopeStartVarId,
-        std::map<unsigned int, std::map<std::string,unsigned int> >& structMembers)
+        VarIdTable &structMembers)
 {
     // end of scope
     const Token * const endToken = startToken->link();
@@ -2497,9 +2644,9 @@ void Tokenizer::setVarIdClassDeclaration(Token * const startToken,
         } else if (tok->str() == "}")
             --indentlevel;
         else if (initList && indentlevel == 0 && Token::Match(tok->previous(), "[,:] %name% [({]")) {
-            const std::map<std::string, unsigned int>::const_iterator it = variableId.find(tok->str());
-            if (it != variableId.end()) {
-                tok->varId(it->second);
+            const unsigned int varId = variableId.find(tok->str());
+            if (varId) {
+                tok->varId(varId);
             }
         } else if (tok->isName() && tok->varId() <= scopeStartVarId) {
             if (indentlevel > 0 || initList) {
@@ -2514,9 +2661,9 @@ void Tokenizer::setVarIdClassDeclaration(Token * const startToken,
                         continue;
                 }
 
-                const std::map<std::string, unsigned int>::const_iterator it = variableId.find(tok->str());
-                if (it != variableId.end()) {
-                    tok->varId(it->second);
+                const unsigned int varId = variableId.find(tok->str());
+                if (varId) {
+                    tok->varId(varId);
                     setVarIdStructMembers(&tok, structMembers, &_varId);
                 }
             }
@@ -2533,7 +2680,7 @@ static void setVarIdClassFunction(const std::string &classname,
                                   Token * const startToken,
                                   const Token * const endToken,
                                   const std::map<std::string, unsigned int> &varlist,
-                                  std::map<unsigned int, std::map<std::string, unsigned int> >& structMembers,
+                                  VarIdTable &structMembers,
                                   unsigned int *_varId)
 {
     for (Token *tok2 = startToken; tok2 && tok2 != endToken; tok2 = tok2->next()) {
@@ -2578,9 +2725,8 @@ void Tokenizer::setVarId()
 
     // variable id
     _varId = 0;
-    std::map<std::string, unsigned int> variableId;
-    std::map<unsigned int, std::map<std::string, unsigned int> > structMembers;
-    std::stack< std::map<std::string, unsigned int> > scopeInfo;
+    ScopedVarIds variableId;
+    VarIdTable structMembers;
 
     std::stack<scopeStackEntryType> scopeStack;
 
@@ -2593,10 +2739,9 @@ void Tokenizer::setVarId()
             if (tok->str() == ":")
                 initlist = true;
             else if (tok->str() == ";") {
-                if (scopeInfo.empty())
+                if (!variableId.inScope())
                     cppcheckError(tok);
-                variableId.swap(scopeInfo.top());
-                scopeInfo.pop();
+                variableId.leaveScope();
             } else if (tok->str() == "{")
                 scopeStack.push(scopeStackEntryType(true, _varId));
         } else if (!initlist && tok->str()=="(") {
@@ -2611,7 +2756,7 @@ void Tokenizer::setVarId()
             if (newFunctionDeclEnd &&
                 (functionDeclEndStack.empty() || newFunctionDeclEnd != functionDeclEndStack.top())) {
                 functionDeclEndStack.push(newFunctionDeclEnd);
-                scopeInfo.push(variableId);
+                variableId.enterScope();
             }
         } else if (tok->str() == "{") {
             // parse anonymous unions as part of the current scope
@@ -2623,7 +2768,7 @@ void Tokenizer::setVarId()
                 } else {
                     isExecutable = ((scopeStack.top().isExecutable || initlist || tok->strAt(-1) == "else") &&
                                     !isClassStructUnionEnumStart(tok));
-                    scopeInfo.push(variableId);
+                    variableId.enterScope();
                 }
                 initlist = false;
                 scopeStack.push(scopeStackEntryType(isExecutable, _varId));
@@ -2643,11 +2788,10 @@ void Tokenizer::setVarId()
                                              structMembers);
                 }
 
-                if (scopeInfo.empty()) {
+                if (!variableId.inScope()) {
                     variableId.clear();
                 } else {
-                    variableId.swap(scopeInfo.top());
-                    scopeInfo.pop();
+                    variableId.leaveScope();
                 }
 
                 scopeStack.pop();
@@ -2722,7 +2866,7 @@ void Tokenizer::setVarId()
                                     continue;
 
                                 if (tok3->isLiteral() ||
-                                    (tok3->isName() && (variableId.find(tok3->str()) != variableId.end())) ||
+                                    (tok3->isName() && variableId.find(tok3->str())) ||
                                     tok3->isOp() ||
                                     tok3->str() == "(" ||
                                     notstart.find(tok3->str()) != notstart.end()) {
@@ -2740,7 +2884,7 @@ void Tokenizer::setVarId()
                     decl = false;
 
                 if (decl) {
-                    variableId[prev2->str()] = ++_varId;
+                    variableId.declare(prev2->str(), ++_varId);
 
                     // set varid for template parameters..
                     tok = tok->next();
@@ -2749,8 +2893,8 @@ void Tokenizer::setVarId()
                     if (tok && tok->str() == "<") {
                         const Token *end = tok->findClosingBracket();
                         while (tok != end) {
-                            if (tok->isName() && variableId.find(tok->str()) != variableId.end())
-                                tok->varId(variableId[tok->str()]);
+                            if (tok->isName() && variableId.find(tok->str()))
+                                tok->varId(variableId.find(tok->str()));
                             tok = tok->next();
                         }
                     }
@@ -2795,9 +2939,9 @@ void Tokenizer::setVarId()
                     continue;
             }
 
-            const std::map<std::string, unsigned int>::const_iterator it = variableId.find(tok->str());
-            if (it != variableId.end()) {
-                tok->varId(it->second);
+            const unsigned int varId = variableId.find(tok->str());
+            if (varId) {
+                tok->varId(varId);
                 setVarIdStructMembers(&tok, structMembers, &_varId);
             }
         } else if (Token::Match(tok, "::|. %name%")) {
@@ -3151,9 +3295,7 @@ bool Tokenizer::simplifySizeof()
 
             else if (Token::Match(tok->previous(), "%type% %name% [ %num% ] [,)]") ||
                      Token::Match(tok->tokAt(-2), "%type% * %name% [ %num% ] [,)]")) {
-                Token tempTok(0);
-                tempTok.str("*");
-                sizeOfVar[varId] = sizeOfType(&tempTok);
+                sizeOfVar[varId] = _settings->sizeof_pointer;
                 declTokOfVar[varId] = tok;
             }
         }
@@ -3302,6 +3444,9 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     if (_settings->terminated())
         return false;
 
+    PassTimer passes("Tokenizer::simplifyTokenList1", _settings->showtime, m_timerResults);
+
+    passes.pass("removeMacros");
     // if MACRO
     for (Token *tok = list.front(); tok; tok = tok->next()) {
         if (Token::Match(tok, "if|for|while|BOOST_FOREACH %name% (")) {
@@ -3330,6 +3475,7 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     // Concatenate double sharp: 'a ## b' -> 'ab'
     concatenateDoubleSharp();
 
+    passes.pass("createLinks");
     createLinks();
 
     // if (x) MACRO() ..
@@ -3347,23 +3493,19 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     if (_settings->terminated())
         return false;
 
+    passes.pass("simplifyOperators");
     // Remove [[deprecated]]
     simplifyDeprecated();
 
-    // Simplify the C alternative tokens (and, or, etc.)
-    simplifyCAlternativeTokens();
-
+    // Simplify the C alternative tokens (and, or, etc.) and
     // replace 'NULL' and similar '0'-defined macros with '0'
-    simplifyNull();
+    simplifyCAlternativeTokensAndNull();
 
     // replace 'sin(0)' to '0' and other similar math expressions
     simplifyMathExpressions();
 
-    // combine "- %num%"
-    concatenateNegativeNumberAndAnyPositive();
-
-    // Combine tokens..
-    combineOperators();
+    // combine "- %num%" and combine tokens..
+    combineOperatorsAndNegativeNumbers();
 
     // simplify simple calculations
     for (Token *tok = list.front() ? list.front()->next() : nullptr; tok; tok = tok->next()) {
@@ -3403,6 +3545,7 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     if (_settings->terminated())
         return false;
 
+    passes.pass("simplifyDeclarations");
     // Remove "volatile", "inline", "register", and "restrict"
     simplifyKeyword();
 
@@ -3426,6 +3569,7 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     if (_settings->terminated())
         return false;
 
+    passes.pass("removeExtensions");
     // remove calling conventions __cdecl, __stdcall..
     simplifyCallingConvention();
 
@@ -3480,12 +3624,8 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     simplifyVarDecl(false);
 
     // typedef..
-    if (m_timerResults) {
-        //Timer t("Tokenizer::tokenize::simplifyTypedef", _settings->showtime, m_timerResults);
-        simplifyTypedef();
-    } else {
-        simplifyTypedef();
-    }
+    passes.pass("simplifyTypedef");
+    simplifyTypedef();
 
     for (Token* tok = list.front(); tok;) {
         if (Token::Match(tok, "union|struct|class union|struct|class"))
@@ -3511,12 +3651,14 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     validate();
 
     // enum..
+    passes.pass("simplifyEnum");
     simplifyEnum();
 
     // The simplify enum have inner loops
     if (_settings->terminated())
         return false;
 
+    passes.pass("simplifyTypes");
     // Put ^{} statements in asm()
     simplifyAsm2();
 
@@ -3562,6 +3704,7 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     // Remove redundant parentheses
     simplifyRedundantParentheses();
 
+    passes.pass("simplifyTemplates");
     if (!isC()) {
         // TODO: Only simplify template parameters
         for (Token *tok = list.front(); tok; tok = tok->next())
@@ -3582,6 +3725,7 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
         TemplateSimplifier::cleanupAfterSimplify(list.front());
     }
 
+    passes.pass("simplifyFunctionPointers");
     // Simplify pointer to standard types (C only)
     simplifyPointerToStandardType();
 
@@ -3596,13 +3740,10 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
 
     validate(); // #6772 "segmentation fault (invalid code) in Tokenizer::setVarId"
 
-    if (m_timerResults) {
-        //Timer t("Tokenizer::tokenize::setVarId", _settings->showtime, m_timerResults);
-        setVarId();
-    } else {
-        setVarId();
-    }
+    passes.pass("setVarId");
+    setVarId();
 
+    passes.pass("simplifyStatements");
     // Link < with >
     createLinks2();
 
@@ -3654,6 +3795,9 @@ bool Tokenizer::simplifyTokenList2()
     for (Token *tok = list.front(); tok; tok = tok->next())
         tok->clearAst();	 
 
+    PassTimer passes("Tokenizer::simplifyTokenList2", _settings->showtime, m_timerResults);
+
+    passes.pass("simplifyAssignments");
     // f(x=g())   =>   x=g(); f(x)
     simplifyAssignmentInFunctionCall();
 
@@ -3670,6 +3814,7 @@ bool Tokenizer::simplifyTokenList2()
     if (_settings->terminated())
         return false;
 
+    passes.pass("simplifySizeof");
     simplifySizeof();
 
     simplifyUndefinedSizeArray();
@@ -3683,6 +3828,7 @@ bool Tokenizer::simplifyTokenList2()
     if (_settings->terminated())
         return false;
 
+    passes.pass("simplifyPointers");
     // Replace "*(ptr + num)" => "ptr[num]"
     simplifyOffsetPointerDereference();
 
@@ -3715,6 +3861,7 @@ bool Tokenizer::simplifyTokenList2()
         }
     }
 
+    passes.pass("simplifyKnownVariables");
     bool modified = true;
     while (modified) {
         if (_settings->terminated())
@@ -3733,6 +3880,7 @@ bool Tokenizer::simplifyTokenList2()
         validate();
     }
 
+    passes.pass("removeRedundantCode");
     // simplify redundant loops
     simplifyWhile0();
     removeRedundantFor();
@@ -3770,15 +3918,19 @@ bool Tokenizer::simplifyTokenList2()
 
     Token::assignProgressValues(list.front());
 
+    passes.pass("createSymbolDatabase");
     // Create symbol database and then remove const keywords
     createSymbolDatabase();
     simplifyPointerConst();
 
+    passes.pass("createAst");
     list.createAst();
     // skipping this here may help improve performance. Might be enabled later on demand. #7208
     // list.validateAst();
 
-    ValueFlow::setValues(&list, _symbolDatabase, _errorLogger, _settings);
+    passes.pass("ValueFlow");
+    ValueFlow::setValues(&list, _symbolDatabase, _errorLogger, _settings, m_timerResults);
+    passes.stop();
 
     if (_settings->terminated())
         return false;
@@ -3894,8 +4046,8 @@ void Tokenizer::dump(std::ostream &out) const
             out << " variable=\"" << tok->variable() << '\"';
         if (tok->function())
             out << " function=\"" << tok->function() << '\"';
-        if (!tok->values.empty())
-            out << " values=\"" << &tok->values << '\"';
+        if (!tok->values().empty())
+            out << " values=\"" << &tok->values() << '\"';
         if (tok->type())
             out << " type-scope=\"" << tok->type()->classScope << '\"';
         if (tok->astParent())
@@ -5985,39 +6137,46 @@ bool Tokenizer::simplifyCAlternativeTokens()
 
     bool ret = false;
     for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->str() == "{") {
-            if (executableScopeLevel > 0 || Token::simpleMatch(tok->previous(), ") {"))
-                ++executableScopeLevel;
-            continue;
-        }
+        if (simplifyCAlternativeTokens(tok, executableScopeLevel))
+            ret = true;
+    }
+    return ret;
+}
 
-        if (tok->str() == "}") {
-            if (executableScopeLevel > 0)
-                --executableScopeLevel;
-            continue;
-        }
+bool Tokenizer::simplifyCAlternativeTokens(Token *tok, unsigned int &executableScopeLevel) const
+{
+    if (tok->str() == "{") {
+        if (executableScopeLevel > 0 || Token::simpleMatch(tok->previous(), ") {"))
+            ++executableScopeLevel;
+        return false;
+    }
 
-        if (!tok->isName())
-            continue;
+    if (tok->str() == "}") {
+        if (executableScopeLevel > 0)
+            --executableScopeLevel;
+        return false;
+    }
 
-        const std::map<std::string, std::string>::const_iterator cOpIt = cAlternativeTokens.find(tok->str());
-        if (cOpIt != cAlternativeTokens.end()) {
-            if (isC() && !Token::Match(tok->previous(), "%name%|%num%|%char%|)|]|> %name% %name%|%num%|%char%|%op%|("))
-                continue;
-            tok->str(cOpIt->second);
-            ret = true;
-        } else if (Token::Match(tok, "not|compl")) {
-            // Don't simplify 'not p;' (in case 'not' is a type)
-            if (isC() && (!Token::Match(tok->next(), "%name%|%op%|(") ||
-                          Token::Match(tok->previous(), "[;{}]") ||
-                          (executableScopeLevel == 0U && tok->strAt(-1) == "(")))
-                continue;
+    if (!tok->isName())
+        return false;
 
-            tok->str((tok->str() == "not") ? "!" : "~");
-            ret = true;
-        }
+    const std::map<std::string, std::string>::const_iterator cOpIt = cAlternativeTokens.find(tok->str());
+    if (cOpIt != cAlternativeTokens.end()) {
+        if (isC() && !Token::Match(tok->previous(), "%name%|%num%|%char%|)|]|> %name% %name%|%num%|%char%|%op%|("))
+            return false;
+        tok->str(cOpIt->second);
+        return true;
+    } else if (Token::Match(tok, "not|compl")) {
+        // Don't simplify 'not p;' (in case 'not' is a type)
+        if (isC() && (!Token::Match(tok->next(), "%name%|%op%|(") ||
+                      Token::Match(tok->previous(), "[;{}]") ||
+                      (executableScopeLevel == 0U && tok->strAt(-1) == "(")))
+            return false;
+
+        tok->str((tok->str() == "not") ? "!" : "~");
+        return true;
     }
-    return ret;
+    return false;
 }
 
 // int i(0); => int i; i = 0;
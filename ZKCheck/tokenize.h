@@ -15,6 +15,8 @@
 class Settings;
 class SymbolDatabase;
 class TimerResults;
+class ScopedVarIds;
+class VarIdTable;
 
 #ifndef tokenizeH
 #define tokenizeH
@@ -55,6 +57,9 @@ public:
     bool createTokens(std::istream &code,
                       const char FileName[]);
 
+    bool createTokens(const std::string &code,
+                      const char FileName[]);
+
     bool simplifyTokens1(const std::string &configuration,
                          bool noSymbolDB_AST = false);
     /**
@@ -547,6 +552,41 @@ private:
     /** Simplify function pointers */
     void simplifyFunctionPointers();
 
+    /**
+     * simplifyCAlternativeTokens() and simplifyNull() in one traversal
+     * of the token list
+     */
+    void simplifyCAlternativeTokensAndNull();
+
+    /**
+     * concatenateNegativeNumberAndAnyPositive() and combineOperators() in
+     * one traversal of the token list
+     */
+    void combineOperatorsAndNegativeNumbers();
+
+    /**
+     * Simplify the C alternative token at tok
+     * @param tok token to simplify
+     * @param executableScopeLevel executable scope level at tok (C only), updated for braces
+     * @return true if tok was simplified
+     */
+    bool simplifyCAlternativeTokens(Token *tok, unsigned int &executableScopeLevel) const;
+
+    /**
+     * Replace 'NULL' at tok and similar '0'-defined macros with '0'
+     * @param nullptrIsNull replace 'nullptr' too
+     */
+    static void simplifyNull(Token *tok, bool nullptrIsNull);
+
+    /** Combine "- %num%" after tok and remove the "+" signs there */
+    static void concatenateNegativeNumberAndAnyPositive(Token *tok);
+
+    /**
+     * Combine the operator at tok with the following token
+     * @return the token the traversal continues after
+     */
+    static Token *combineOperators(Token *tok, bool cpp);
+
     /**
      * Send error message to error logger about internal bug.
      * @param tok the token that this bug concerns.
@@ -690,9 +730,9 @@ private:
     void unsupportedTypedef(const Token *tok) const;
 
     void setVarIdClassDeclaration(Token * const startToken,
-                                  const std::map<std::string, unsigned int> &variableId,
+                                  const ScopedVarIds &variableId,
                                   const unsigned int scopeStartVarId,
-                                  std::map<unsigned int, std::map<std::string,unsigned int> >& structMembers);
+                                  VarIdTable &structMembers);
 
 
     /**
@@ -792,13 +832,8 @@ public:
     */
     static const Token * startOfExecutableScope(const Token * tok);
 
-    bool isMaxTime() const {
-#ifdef MAXTIME
-        return (std::time(0) > maxtime);
-#else
-        return false;
-#endif
-    }
+    /** @brief Is the time up? See MAXTIME and the time budget of the token list */
+    bool isMaxTime() const;
 
 private:
     /** Disable copy constructor, no implementation */
@@ -837,6 +872,9 @@ private:
      */
     bool _codeWithTemplates;
 
+    /** number of names given to unnamed structs, so far */
+    unsigned int _unnamedCount;
+
     /**
      * TimerResults
      */
@@ -14,6 +14,7 @@
 #include <cstring>
 #include <sstream>
 #include <cctype>
+#include <iterator>
 #include <stack>
 
 // How many compileExpression recursions are allowed?
@@ -26,6 +27,7 @@ TokenList::TokenList(const Settings* settings) :
     _front(0),
     _back(0),
     _settings(settings),
+    _budget(nullptr),
     _isC(false),
     _isCPP(false)
 {
@@ -123,7 +125,7 @@ void TokenList::addtoken(std::string str, const unsigned int lineno, const unsig
     if (_back) {
         _back->insertToken(str);
     } else {
-        _front = new Token(&_back);
+        _front = new (_arena) Token(&_back);
         _back = _front;
         _back->str(str);
     }
@@ -142,7 +144,7 @@ void TokenList::addtoken(const Token * tok, const unsigned int lineno, const uns
     if (_back) {
         _back->insertToken(tok->str(), tok->originalName());
     } else {
-        _front = new Token(&_back);
+        _front = new (_arena) Token(&_back);
         _back = _front;
         _back->str(tok->str());
         if (!tok->originalName().empty())
@@ -187,7 +189,50 @@ void TokenList::insertTokens(Token *dest, const Token *src, unsigned int n)
 // Tokenize - tokenizes a given file.
 //---------------------------------------------------------------------------
 
+namespace {
+    /** Classification of the characters for createTokens() */
+    class CharTable {
+    public:
+        enum {
+            OPERATOR = 1,    ///< ends the current token: "+-*/%&|^?!=<>[](){};:,.~\n "
+            DOUBLED = 2,     ///< can be doubled: "++", "--", "<<", ">>", "==", "::", "&&", "||"
+            SPECIAL = 4      ///< quote or end of code, needs special handling
+        };
+
+        CharTable() {
+            std::memset(_flags, 0, sizeof(_flags));
+            for (const char *c = "+-*/%&|^?!=<>[](){};:,.~\n "; *c; ++c)
+                _flags[(unsigned char)*c] |= OPERATOR;
+            for (const char *c = "+-<>=:&|"; *c; ++c)
+                _flags[(unsigned char)*c] |= DOUBLED;
+            _flags[(unsigned char)'\''] |= SPECIAL;
+            _flags[(unsigned char)'\"'] |= SPECIAL;
+            _flags[0] |= SPECIAL;
+        }
+
+        bool is(char ch, unsigned char flag) const {
+            return (_flags[(unsigned char)ch] & flag) != 0;
+        }
+
+        /** Is the character simply appended to the current token? */
+        bool isPlain(char ch) const {
+            return _flags[(unsigned char)ch] == 0 && ch != Preprocessor::macroChar;
+        }
+
+    private:
+        unsigned char _flags[256];
+    };
+
+    const CharTable charTable;
+}
+
 bool TokenList::createTokens(std::istream &code, const std::string& file0)
+{
+    const std::string data((std::istreambuf_iterator<char>(code)), std::istreambuf_iterator<char>());
+    return createTokens(data.data(), data.size(), file0);
+}
+
+bool TokenList::createTokens(const char *code, std::size_t size, const std::string& file0)
 {
     appendFileIfNew(file0);
 
@@ -212,11 +257,24 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
 
     bool expandedMacro = false;
 
-    // Read one byte at a time from code and create tokens
-    for (char ch = (char)code.get(); code.good() && ch; ch = (char)code.get()) {
+    // Create tokens, a null character ends the code
+    for (std::size_t pos = 0; pos < size && code[pos]; ++pos) {
+        const char ch = code[pos];
+        const char next = (pos + 1 < size) ? code[pos + 1] : '\0';
+
+        // Identifiers, numbers etc: append the whole run of characters at once
+        if (charTable.isPlain(ch)) {
+            std::size_t end = pos + 1;
+            while (end < size && charTable.isPlain(code[end]))
+                ++end;
+            CurrentToken.append(code + pos, end - pos);
+            pos = end - 1;
+            continue;
+        }
+
         if (ch == Preprocessor::macroChar) {
-            while (code.peek() == Preprocessor::macroChar)
-                code.get();
+            while (pos + 1 < size && code[pos + 1] == Preprocessor::macroChar)
+                ++pos;
             if (!CurrentToken.empty()) {
                 addtoken(CurrentToken, lineno, FileIndex, true);
                 _back->isExpandedMacro(expandedMacro);
@@ -229,25 +287,17 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
         // char/string..
         // multiline strings are not handled. The preprocessor should handle that for us.
         else if (ch == '\'' || ch == '\"') {
-            std::string line;
-
-            // read char
-            bool special = false;
-            char c = ch;
-            do {
-                // Append token..
-                line += c;
-
-                // Special sequence '\.'
-                if (special)
-                    special = false;
-                else
-                    special = (c == '\\');
+            // find the end of the literal, skipping escaped characters
+            std::size_t end = pos + 1;
+            bool special = (ch == '\\');
+            while (end < size && (special || code[end] != ch)) {
+                special = !special && (code[end] == '\\');
+                ++end;
+            }
 
-                // Get next character
-                c = (char)code.get();
-            } while (code.good() && (special || c != ch));
+            std::string line(code + pos, end - pos);
             line += ch;
+            pos = (end < size) ? end : size;
 
             // Handle #file "file.h"
             if (CurrentToken == "#file") {
@@ -276,29 +326,36 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
             continue;
         }
 
+        // Skip spaces between tokens
+        if (ch == ' ' && CurrentToken.empty()) {
+            while (pos + 1 < size && code[pos + 1] == ' ')
+                ++pos;
+            continue;
+        }
+
         if (ch == '.' &&
             !CurrentToken.empty() &&
             std::isdigit((unsigned char)CurrentToken[0])) {
             // Don't separate doubles "5.4"
-        } else if (std::strchr("+-", ch) &&
+        } else if ((ch == '+' || ch == '-') &&
                    CurrentToken.length() > 0 &&
                    std::isdigit((unsigned char)CurrentToken[0]) &&
                    (CurrentToken.back() == 'e' ||
                     CurrentToken.back() == 'E') &&
                    !MathLib::isIntHex(CurrentToken)) {
             // Don't separate doubles "4.2e+10"
-        } else if (CurrentToken.empty() && ch == '.' && std::isdigit((unsigned char)code.peek())) {
+        } else if (CurrentToken.empty() && ch == '.' && std::isdigit((unsigned char)next)) {
             // tokenize .125 into 0.125
             CurrentToken = "0";
-        } else if (std::strchr("+-*/%&|^?!=<>[](){};:,.~\n ", ch)) {
+        } else if (charTable.is(ch, CharTable::OPERATOR)) {
             if (CurrentToken == "#file") {
                 // Handle this where strings are handled
                 continue;
             } else if (CurrentToken == "#line") {
                 // Read to end of line
-                std::string line;
-
-                std::getline(code, line);
+                const char *lineEnd = static_cast<const char *>(std::memchr(code + pos + 1, '\n', size - pos - 1));
+                const std::string line(code + pos + 1, lineEnd ? lineEnd : code + size);
+                pos = lineEnd ? (std::size_t)(lineEnd - code) : size;
 
                 unsigned int row=0;
                 std::istringstream fiss(line);
@@ -351,8 +408,10 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
 
             CurrentToken += ch;
             // Add "++", "--", ">>" or ... token
-            if (std::strchr("+-<>=:&|", ch) && (code.peek() == ch))
-                CurrentToken += (char)code.get();
+            if (charTable.is(ch, CharTable::DOUBLED) && next == ch) {
+                CurrentToken += ch;
+                ++pos;
+            }
             addtoken(CurrentToken, lineno, FileIndex);
             _back->isExpandedMacro(expandedMacro);
             CurrentToken.clear();
@@ -372,7 +431,7 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
             continue;
         if (Token::Match(tok->previous(), "%num% ++|--") ||
             Token::Match(tok, "++|-- %num%")) {
-            tok->str(tok->str()[0]);
+            tok->str(std::string(1, tok->str()[0]));
             tok->insertToken(tok->str());
         }
     }
@@ -387,27 +446,18 @@ bool TokenList::createTokens(std::istream &code, const std::string& file0)
 
 //---------------------------------------------------------------------------
 
-unsigned long long TokenList::calculateChecksum() const
+Hash128::Digest TokenList::calculateChecksum(bool withLocation) const
 {
-    unsigned long long checksum = 0;
+    Hash128 hash;
     for (const Token* tok = front(); tok; tok = tok->next()) {
-        const unsigned int subchecksum1 = tok->flags() + tok->varId() + tok->tokType();
-        unsigned int subchecksum2 = 0;
-        for (std::size_t i = 0; i < tok->str().size(); i++)
-            subchecksum2 += (unsigned int)tok->str()[i];
-        if (!tok->originalName().empty()) {
-            for (std::size_t i = 0; i < tok->originalName().size(); i++)
-                subchecksum2 += (unsigned int) tok->originalName()[i];
-        }
-
-        checksum ^= ((static_cast<unsigned long long>(subchecksum1) << 32) | subchecksum2);
-
-        const bool bit1 = (checksum & 1) != 0;
-        checksum >>= 1;
-        if (bit1)
-            checksum |= (1ULL << 63);
+        const unsigned int fields[5] = { tok->flags(), tok->varId(), static_cast<unsigned int>(tok->tokType()),
+                                         withLocation ? tok->linenr() : 0U, withLocation ? tok->fileIndex() : 0U
+                                       };
+        hash.update(reinterpret_cast<const char *>(fields), sizeof(fields));
+        hash.field(tok->str());
+        hash.field(tok->originalName());
     }
-    return checksum;
+    return hash.digest();
 }
 
 
@@ -1123,11 +1173,7 @@ std::string TokenList::fileLine(const Token *tok) const
 
 bool TokenList::validateToken(const Token* tok) const
 {
-    if (!tok)
-        return true;
-    for (const Token *t = _front; t; t = t->next()) {
-        if (tok==t)
-            return true;
-    }
-    return false;
+    // The tokens are only deleted by unlinking them, so a token that is
+    // still allocated is in the list. That avoids walking the whole list.
+    return !tok || _arena.contains(tok);
 }
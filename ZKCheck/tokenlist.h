@@ -5,8 +5,10 @@
 #include <string>
 #include <vector>
 #include "config.h"
+#include "token.h"
+#include "utils.h"
 
-class Token;
+class Budget;
 class Settings;
 
 #ifndef tokenlistH
@@ -21,6 +23,15 @@ public:
         _settings = settings;
     }
 
+    /** @brief Budget of the checking of this token list, nullptr if it is unlimited */
+    Budget *budget() const {
+        return _budget;
+    }
+
+    void setBudget(Budget *budget) {
+        _budget = budget;
+    }
+
     /** @return the source file path. e.g. "file.cpp" */
     const std::string& getSourceFilePath() const;
 
@@ -56,6 +67,14 @@ public:
      */
     bool createTokens(std::istream &code, const std::string& file0 = emptyString);
 
+    /**
+     * Create tokens from code in a buffer, see above.
+     * @param code the code, a null character also ends it
+     * @param size size of the code
+     * @param file0 source file name
+     */
+    bool createTokens(const char *code, std::size_t size, const std::string& file0 = emptyString);
+
     /** Deallocate list */
     void deallocateTokens();
 
@@ -102,10 +121,12 @@ public:
     std::string fileLine(const Token *tok) const;
 
     /**
-    * Calculates a 64-bit checksum of the token list used to compare
-    * multiple token lists with each other as quickly as possible.
-    */
-    unsigned long long calculateChecksum() const;
+     * Calculates a 128-bit checksum of the token list used to compare
+     * multiple token lists with each other as quickly as possible.
+     * @param withLocation also hash the file and line of every token, for
+     * token lists that are compared before the line numbers stop mattering
+     */
+    Hash128::Digest calculateChecksum(bool withLocation = false) const;
 
     /**
      * Create abstract syntax tree.
@@ -119,10 +140,10 @@ public:
     void validateAst();
 
     /**
-     * Verify that the given token is an element of the tokenlist.
-     * That method is implemented for debugging purposes.
-     * @param[in] tok token to be checked
-     * \return true if token was found in tokenlist, false else. In case of nullptr true is returned.
+     * Verify that the given token is an element of the tokenlist and has
+     * not been deleted. That method is implemented for debugging purposes.
+     * @param[in] tok token of this tokenlist, or a deleted one
+     * \return true if token is in the tokenlist, false else. In case of nullptr true is returned.
      */
     bool validateToken(const Token* tok) const;
 
@@ -134,6 +155,9 @@ private:
     /** Disable assignment operator, no implementation */
     TokenList &operator=(const TokenList &);
 
+    /** Memory for the tokens, declared first so it outlives them */
+    TokenArena _arena;
+
     /** Token list */
     Token *_front, *_back;
 
@@ -143,6 +167,9 @@ private:
     /** settings */
     const Settings* _settings;
 
+    /** budget, see budget() */
+    Budget *_budget;
+
     /** File is known to be C/C++ code */
     bool _isC, _isCPP;
 };
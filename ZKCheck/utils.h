@@ -3,6 +3,9 @@
  */
 
 #include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
 
 #ifndef utilsH
 #define utilsH
@@ -39,4 +42,119 @@ private:
     Cont data_;
 };
 
+/**
+ * @brief Incremental 128-bit hash, used where a collision would silently
+ * give wrong results (cached results, skipped configurations).
+ *
+ * Input is mixed eight bytes at a time into two 64-bit lanes in the
+ * style of MurmurHash3 x64_128. The result only depends on the bytes
+ * hashed, not on how they were split over calls to update().
+ */
+class Hash128 {
+public:
+    typedef std::pair<unsigned long long, unsigned long long> Digest;
+
+    Hash128() : _h1(0x9e3779b97f4a7c15ULL), _h2(0xc2b2ae3d27d4eb4fULL), _length(0), _pending(0) {
+    }
+
+    void update(const char *data, std::size_t len) {
+        _length += len;
+        if (_pending > 0) {
+            const std::size_t n = std::min<std::size_t>(len, 8U - _pending);
+            std::memcpy(_buffer + _pending, data, n);
+            _pending += n;
+            data += n;
+            len -= n;
+            if (_pending < 8U)
+                return;
+            mix(_buffer);
+            _pending = 0;
+        }
+        for (; len >= 8U; data += 8, len -= 8U)
+            mix(data);
+        std::memcpy(_buffer, data, len);
+        _pending = len;
+    }
+
+    void update(const std::string &str) {
+        update(str.data(), str.size());
+    }
+
+    /** Hash a string and its length, so that consecutive fields can't run into each other */
+    void field(const std::string &str) {
+        const unsigned long long len = str.size();
+        update(reinterpret_cast<const char *>(&len), sizeof(len));
+        update(str);
+    }
+
+    /** The hash of everything given so far. More data can still be added afterwards. */
+    Digest digest() const {
+        unsigned long long k = 0;
+        for (std::size_t i = 0; i < _pending; ++i)
+            k |= static_cast<unsigned long long>(static_cast<unsigned char>(_buffer[i])) << (8U * i);
+        unsigned long long h1 = _h1 ^ (k * c1);
+        unsigned long long h2 = _h2 ^ (k * c2);
+        h1 ^= _length;
+        h2 ^= _length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        return std::make_pair(h1, h2);
+    }
+
+    /** The digest as 32 hexadecimal digits */
+    std::string str() const {
+        static const char hexdigits[] = "0123456789abcdef";
+        const Digest d = digest();
+        std::string ret(32U, '0');
+        for (std::size_t i = 0; i < 16U; ++i) {
+            ret[15U - i] = hexdigits[(d.first >> (4U * i)) & 0xfU];
+            ret[31U - i] = hexdigits[(d.second >> (4U * i)) & 0xfU];
+        }
+        return ret;
+    }
+
+private:
+    static const unsigned long long c1 = 0x87c37b91114253d5ULL;
+    static const unsigned long long c2 = 0x4cf5ad432745937fULL;
+
+    static unsigned long long rotl(unsigned long long x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static unsigned long long fmix(unsigned long long k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    void mix(const char *data) {
+        unsigned long long k = 0;
+        for (std::size_t i = 0; i < 8U; ++i)
+            k |= static_cast<unsigned long long>(static_cast<unsigned char>(data[i])) << (8U * i);
+
+        unsigned long long k1 = rotl(k * c1, 31) * c2;
+        _h1 ^= k1;
+        _h1 = rotl(_h1, 27) + _h2;
+        _h1 = _h1 * 5U + 0x52dce729U;
+
+        unsigned long long k2 = rotl(k * c2, 33) * c1;
+        _h2 ^= k2;
+        _h2 = rotl(_h2, 31) + _h1;
+        _h2 = _h2 * 5U + 0x38495ab5U;
+    }
+
+    unsigned long long _h1;
+    unsigned long long _h2;
+    unsigned long long _length;
+    char _buffer[8];
+    std::size_t _pending;
+};
+
 #endif
@@ -4,10 +4,12 @@
 
 #include "valueflow.h"
 #include "astutils.h"
+#include "budget.h"
 #include "errorlogger.h"
 #include "mathlib.h"
 #include "settings.h"
 #include "symboldatabase.h"
+#include "timer.h"
 #include "token.h"
 #include "tokenlist.h"
 #include <stack>
@@ -73,6 +75,28 @@ static void bailout(TokenList *tokenlist, ErrorLogger *errorLogger, const Token
     errorLogger->reportErr(errmsg);
 }
 
+static const char ValueFlowDegraded[] = "ValueFlow limited to single blocks";
+
+/** Is the budget of the checking exceeded? Then the analysis stays within single blocks. */
+static bool budgetExceeded(TokenList *tokenlist)
+{
+    Budget * const budget = tokenlist->budget();
+    if (!budget || !budget->exceeded())
+        return false;
+    budget->degrade(ValueFlowDegraded);
+    return true;
+}
+
+/** Count one step of the forward or reverse analysis, false if it must stop at tok */
+static bool budgetStep(TokenList *tokenlist, const Token *tok)
+{
+    Budget * const budget = tokenlist->budget();
+    if (!budget || budget->valueFlowStep() || (tok->str() != "{" && tok->str() != "}"))
+        return true;
+    budget->degrade(ValueFlowDegraded);
+    return false;
+}
+
 static bool bailoutFunctionPar(const Token *tok, const ValueFlow::Value &value, const Settings *settings, bool *inconclusive)
 {
     if (!tok)
@@ -283,17 +307,18 @@ static bool addValue(Token *tok, const ValueFlow::Value &value)
 {
     if (value.isKnown()) {
         // Clear all other values since value is known
-        tok->values.clear();
+        tok->clearValues();
     }
 
     // Don't handle more than 10 values for performance reasons
     // TODO: add setting?
-    if (tok->values.size() >= 10U)
+    if (tok->values().size() >= 10U)
         return false;
 
     // if value already exists, don't add it again
-    std::list<ValueFlow::Value>::iterator it;
-    for (it = tok->values.begin(); it != tok->values.end(); ++it) {
+    ValueFlow::ValueList &values = tok->changeValues();
+    ValueFlow::ValueList::iterator it;
+    for (it = values.begin(); it != values.end(); ++it) {
         // different intvalue => continue
         if (it->intvalue != value.intvalue)
             continue;
@@ -317,11 +342,11 @@ static bool addValue(Token *tok, const ValueFlow::Value &value)
     }
 
     // Add value
-    if (it == tok->values.end()) {
+    if (it == values.end()) {
         ValueFlow::Value v(value);
         if (v.varId == 0)
             v.varId = tok->varId();
-        tok->values.push_back(v);
+        values.push_back(v);
     }
 
     return true;
@@ -380,10 +405,10 @@ static void setTokenValue(Token* tok, const ValueFlow::Value &value)
     else if ((parent->isArithmeticalOp() || parent->isComparisonOp() || (parent->tokType() == Token::eBitOp)) &&
              parent->astOperand1() &&
              parent->astOperand2()) {
-        const bool known = ((parent->astOperand1()->values.size() == 1U &&
-                             parent->astOperand1()->values.front().isKnown()) ||
-                            (parent->astOperand2()->values.size() == 1U &&
-                             parent->astOperand2()->values.front().isKnown()));
+        const bool known = ((parent->astOperand1()->values().size() == 1U &&
+                             parent->astOperand1()->values().front().isKnown()) ||
+                            (parent->astOperand2()->values().size() == 1U &&
+                             parent->astOperand2()->values().front().isKnown()));
 
         // known result when a operand is 0.
         if (Token::Match(parent, "[&*]") && value.isKnown() && value.tokvalue==nullptr && value.intvalue==0) {
@@ -391,11 +416,11 @@ static void setTokenValue(Token* tok, const ValueFlow::Value &value)
             return;
         }
 
-        std::list<ValueFlow::Value>::const_iterator value1, value2;
-        for (value1 = parent->astOperand1()->values.begin(); value1 != parent->astOperand1()->values.end(); ++value1) {
+        ValueFlow::ValueList::const_iterator value1, value2;
+        for (value1 = parent->astOperand1()->values().begin(); value1 != parent->astOperand1()->values().end(); ++value1) {
             if (value1->tokvalue && (!parent->isComparisonOp() || value1->tokvalue->tokType() != Token::eString))
                 continue;
-            for (value2 = parent->astOperand2()->values.begin(); value2 != parent->astOperand2()->values.end(); ++value2) {
+            for (value2 = parent->astOperand2()->values().begin(); value2 != parent->astOperand2()->values().end(); ++value2) {
                 if (value2->tokvalue && (!parent->isComparisonOp() || value2->tokvalue->tokType() != Token::eString || value1->tokvalue))
                     continue;
                 if (known || value1->varId == 0U || value2->varId == 0U ||
@@ -495,8 +520,8 @@ static void setTokenValue(Token* tok, const ValueFlow::Value &value)
 
     // !
     else if (parent->str() == "!") {
-        std::list<ValueFlow::Value>::const_iterator it;
-        for (it = tok->values.begin(); it != tok->values.end(); ++it) {
+        ValueFlow::ValueList::const_iterator it;
+        for (it = tok->values().begin(); it != tok->values().end(); ++it) {
             if (it->tokvalue)
                 continue;
             ValueFlow::Value v(*it);
@@ -507,11 +532,11 @@ static void setTokenValue(Token* tok, const ValueFlow::Value &value)
 
     // Array element
     else if (parent->str() == "[" && parent->astOperand1() && parent->astOperand2()) {
-        std::list<ValueFlow::Value>::const_iterator value1, value2;
-        for (value1 = parent->astOperand1()->values.begin(); value1 != parent->astOperand1()->values.end(); ++value1) {
+        ValueFlow::ValueList::const_iterator value1, value2;
+        for (value1 = parent->astOperand1()->values().begin(); value1 != parent->astOperand1()->values().end(); ++value1) {
             if (!value1->tokvalue)
                 continue;
-            for (value2 = parent->astOperand2()->values.begin(); value2 != parent->astOperand2()->values.end(); ++value2) {
+            for (value2 = parent->astOperand2()->values().begin(); value2 != parent->astOperand2()->values().end(); ++value2) {
                 if (value2->tokvalue)
                     continue;
                 if (value1->varId == 0U || value2->varId == 0U ||
@@ -752,6 +777,9 @@ static void valueFlowReverse(TokenList *tokenlist,
             break;
         }
 
+        if (!budgetStep(tokenlist, tok2))
+            break;
+
         if (tok2->varId() == varid) {
             // bailout: assignment
             if (Token::Match(tok2->previous(), "!!* %name% =")) {
@@ -1047,6 +1075,9 @@ static bool valueFlowForward(Token * const               startToken,
     bool read = false;  // is variable value read?
 
     for (Token *tok2 = startToken; tok2 && tok2 != endToken; tok2 = tok2->next()) {
+        if (!budgetStep(tokenlist, tok2))
+            return false;
+
         if (indentlevel >= 0 && tok2->str() == "{")
             ++indentlevel;
         else if (indentlevel >= 0 && tok2->str() == "}") {
@@ -1152,7 +1183,7 @@ static bool valueFlowForward(Token * const               startToken,
             }
 
             const Token * const condTok = tok2->next()->astOperand2();
-            const bool condAlwaysTrue = (condTok && condTok->values.size() == 1U && condTok->values.front().isKnown() && condTok->values.front().intvalue != 0);
+            const bool condAlwaysTrue = (condTok && condTok->values().size() == 1U && condTok->values().front().isKnown() && condTok->values().front().intvalue != 0);
 
             // Should scope be skipped because variable value is checked?
             std::list<ValueFlow::Value> truevalues;
@@ -1366,8 +1397,8 @@ static bool valueFlowForward(Token * const               startToken,
             if (!condition || !op2) // Ticket #6713
                 continue;
 
-            if (condition->values.size() == 1U && condition->values.front().isKnown() && !condition->values.front().tokvalue) {
-                const ValueFlow::Value &condValue = condition->values.front();
+            if (condition->values().size() == 1U && condition->values().front().isKnown() && !condition->values().front().tokvalue) {
+                const ValueFlow::Value &condValue = condition->values().front();
                 const Token *expr = (condValue.intvalue != 0) ? op2->astOperand1() : op2->astOperand2();
                 std::list<ValueFlow::Value>::const_iterator it;
                 for (it = values.begin(); it != values.end(); ++it)
@@ -1552,10 +1583,10 @@ static void valueFlowAfterAssign(TokenList *tokenlist, SymbolDatabase* symboldat
             const Token * const endOfVarScope = var->typeStartToken()->scope()->classEnd;
 
             // Rhs values..
-            if (!tok->astOperand2() || tok->astOperand2()->values.empty())
+            if (!tok->astOperand2() || tok->astOperand2()->values().empty())
                 continue;
 
-            std::list<ValueFlow::Value> values = tok->astOperand2()->values;
+            std::list<ValueFlow::Value> values(tok->astOperand2()->values().begin(), tok->astOperand2()->values().end());
             const bool constValue = tok->astOperand2()->isNumber();
 
             // Static variable initialisation?
@@ -1741,8 +1772,8 @@ static void execute(const Token *expr,
     if (!expr)
         *error = true;
 
-    else if (expr->values.size() == 1U && expr->values.front().isKnown() && !expr->values.front().tokvalue) {
-        *result = expr->values.front().intvalue;
+    else if (expr->values().size() == 1U && expr->values().front().isKnown() && !expr->values().front().tokvalue) {
+        *result = expr->values().front().intvalue;
     }
 
     else if (expr->isNumber()) {
@@ -1861,11 +1892,11 @@ static void execute(const Token *expr,
         if (var != programMemory->tokvalues.end()) {
             tokvalue = var->second;
         } else {
-            if (expr->astOperand1()->values.size() != 1U) {
+            if (expr->astOperand1()->values().size() != 1U) {
                 *error = true;
                 return;
             }
-            tokvalue = expr->astOperand1()->values.front().tokvalue;
+            tokvalue = expr->astOperand1()->values().front().tokvalue;
         }
         if (!tokvalue || !tokvalue->isLiteral()) {
             *error = true;
@@ -2224,8 +2255,8 @@ static void valueFlowSubFunction(TokenList *tokenlist, ErrorLogger *errorLogger,
             std::list<ValueFlow::Value> argvalues;
 
             // passing value(s) to function
-            if (!argtok->values.empty() && Token::Match(argtok, "%name%|%num%|%str% [,)]"))
-                argvalues = argtok->values;
+            if (!argtok->values().empty() && Token::Match(argtok, "%name%|%num%|%str% [,)]"))
+                argvalues.assign(argtok->values().begin(), argtok->values().end());
             else {
                 // bool operator => values 1/0 are passed to function..
                 const Token *op = argtok;
@@ -2235,8 +2266,8 @@ static void valueFlowSubFunction(TokenList *tokenlist, ErrorLogger *errorLogger,
                     argvalues.clear();
                     argvalues.push_back(ValueFlow::Value(0));
                     argvalues.push_back(ValueFlow::Value(1));
-                } else if (Token::Match(op, "%cop%") && !op->values.empty()) {
-                    argvalues = op->values;
+                } else if (Token::Match(op, "%cop%") && !op->values().empty()) {
+                    argvalues.assign(op->values().begin(), op->values().end());
                 } else {
                     // possible values are unknown..
                     continue;
@@ -2267,9 +2298,9 @@ static void valueFlowFunctionDefaultParameter(TokenList *tokenlist, SymbolDataba
         for (std::size_t arg = function->minArgCount(); arg < function->argCount(); arg++) {
             const Variable* var = function->getArgumentVar(arg);
             if (var && var->hasDefault() && Token::Match(var->nameToken(), "%var% = %num%|%str% [,)]")) {
-                const std::list<ValueFlow::Value> &values = var->nameToken()->tokAt(2)->values;
+                const ValueFlow::ValueList &values = var->nameToken()->tokAt(2)->values();
                 std::list<ValueFlow::Value> argvalues;
-                for (std::list<ValueFlow::Value>::const_iterator it = values.begin(); it != values.end(); ++it) {
+                for (ValueFlow::ValueList::const_iterator it = values.begin(); it != values.end(); ++it) {
                     ValueFlow::Value v(*it);
                     v.defaultArg = true;
                     v.changeKnownToPossible();
@@ -2285,7 +2316,7 @@ static void valueFlowFunctionDefaultParameter(TokenList *tokenlist, SymbolDataba
 
 static bool constval(const Token * tok)
 {
-    return tok && tok->values.size() == 1U && tok->values.front().varId == 0U;
+    return tok && tok->values().size() == 1U && tok->values().front().varId == 0U;
 }
 
 static void valueFlowFunctionReturn(TokenList *tokenlist, ErrorLogger *errorLogger, const Settings *settings)
@@ -2302,10 +2333,10 @@ static void valueFlowFunctionReturn(TokenList *tokenlist, ErrorLogger *errorLogg
                 partok = partok->astOperand1();
             if (!constval(partok))
                 continue;
-            parvalues.push_back(partok->values.front().intvalue);
+            parvalues.push_back(partok->values().front().intvalue);
             partok = partok->astParent();
             while (partok && partok->str() == ",") {
-                parvalues.push_back(partok->astOperand2()->values.front().intvalue);
+                parvalues.push_back(partok->astOperand2()->values().front().intvalue);
                 partok = partok->astParent();
             }
             if (partok != tok)
@@ -2347,25 +2378,45 @@ static void valueFlowFunctionReturn(TokenList *tokenlist, ErrorLogger *errorLogg
     }
 }
 
-void ValueFlow::setValues(TokenList *tokenlist, SymbolDatabase* symboldatabase, ErrorLogger *errorLogger, const Settings *settings)
+void ValueFlow::setValues(TokenList *tokenlist, SymbolDatabase* symboldatabase, ErrorLogger *errorLogger, const Settings *settings, TimerResultsIntf *timerResults)
 {
+    PassTimer passes("ValueFlow", settings->showtime, timerResults);
+
     for (Token *tok = tokenlist->front(); tok; tok = tok->next())
-        tok->values.clear();
+        tok->clearValues();
 
+    passes.pass("valueFlowNumber");
     valueFlowNumber(tokenlist);
+    passes.pass("valueFlowString");
     valueFlowString(tokenlist);
+    passes.pass("valueFlowArray");
     valueFlowArray(tokenlist);
+    passes.pass("valueFlowPointerAlias");
     valueFlowPointerAlias(tokenlist);
-    valueFlowFunctionReturn(tokenlist, errorLogger, settings);
+    // The analysis across functions is skipped when the budget is exceeded
+    passes.pass("valueFlowFunctionReturn");
+    if (!budgetExceeded(tokenlist))
+        valueFlowFunctionReturn(tokenlist, errorLogger, settings);
+    passes.pass("valueFlowBitAnd");
     valueFlowBitAnd(tokenlist);
+    passes.pass("valueFlowOppositeCondition");
     valueFlowOppositeCondition(symboldatabase, settings);
+    passes.pass("valueFlowForLoop");
     valueFlowForLoop(tokenlist, symboldatabase, errorLogger, settings);
+    passes.pass("valueFlowBeforeCondition");
     valueFlowBeforeCondition(tokenlist, symboldatabase, errorLogger, settings);
+    passes.pass("valueFlowAfterAssign");
     valueFlowAfterAssign(tokenlist, symboldatabase, errorLogger, settings);
+    passes.pass("valueFlowAfterCondition");
     valueFlowAfterCondition(tokenlist, symboldatabase, errorLogger, settings);
+    passes.pass("valueFlowSwitchVariable");
     valueFlowSwitchVariable(tokenlist, symboldatabase, errorLogger, settings);
-    valueFlowSubFunction(tokenlist, errorLogger, settings);
-    valueFlowFunctionDefaultParameter(tokenlist, symboldatabase, errorLogger, settings);
+    passes.pass("valueFlowSubFunction");
+    if (!budgetExceeded(tokenlist))
+        valueFlowSubFunction(tokenlist, errorLogger, settings);
+    passes.pass("valueFlowFunctionDefaultParameter");
+    if (!budgetExceeded(tokenlist))
+        valueFlowFunctionDefaultParameter(tokenlist, symboldatabase, errorLogger, settings);
 }
 
 
@@ -4,12 +4,14 @@
 
 #include <string>
 #include "config.h"
+#include "smallvector.h"
 
 class Token;
 class TokenList;
 class SymbolDatabase;
 class ErrorLogger;
 class Settings;
+class TimerResultsIntf;
 
 #ifndef valueflowH
 #define valueflowH
@@ -78,7 +80,10 @@ namespace ValueFlow {
         }
     };
 
-    void setValues(TokenList *tokenlist, SymbolDatabase* symboldatabase, ErrorLogger *errorLogger, const Settings *settings);
+    /** Values of a token, most tokens have no more than two */
+    typedef SmallVector<Value, 2> ValueList;
+
+    void setValues(TokenList *tokenlist, SymbolDatabase* symboldatabase, ErrorLogger *errorLogger, const Settings *settings, TimerResultsIntf *timerResults = nullptr);
 
     std::string eitherTheConditionIsRedundant(const Token *condition);
 }
@@ -0,0 +1,84 @@
+/*
+
+ */
+
+#include "varidmap.h"
+
+#include <cstdint>
+
+static const std::size_t INITIAL_SLOTS = 256;
+
+VarIdTable::VarIdTable() : _slots(INITIAL_SLOTS), _used(0)
+{
+}
+
+std::size_t VarIdTable::slot(const std::string *name, unsigned int owner) const
+{
+    std::size_t h = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(name) / sizeof(void *));
+    h ^= owner * 0x9E3779B9U;
+    h *= 0x9E3779B9U;
+    h ^= h >> 15;
+
+    const std::size_t mask = _slots.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+        const Slot &s = _slots[i];
+        if (!s.name || (s.name == name && s.owner == owner))
+            return i;
+    }
+}
+
+unsigned int VarIdTable::find(const std::string &name, unsigned int owner) const
+{
+    return _slots[slot(&name, owner)].varId;
+}
+
+unsigned int &VarIdTable::operator()(const std::string &name, unsigned int owner)
+{
+    // keep at least a quarter of the slots empty
+    if ((_used + 1) * 4 > _slots.size() * 3)
+        grow();
+
+    Slot &s = _slots[slot(&name, owner)];
+    if (!s.name) {
+        s.name = &name;
+        s.owner = owner;
+        ++_used;
+    }
+    return s.varId;
+}
+
+void VarIdTable::grow()
+{
+    std::vector<Slot> old(_slots.size() * 2);
+    old.swap(_slots);
+    for (std::vector<Slot>::const_iterator it = old.begin(); it != old.end(); ++it) {
+        if (it->name)
+            _slots[slot(it->name, it->owner)] = *it;
+    }
+}
+
+void VarIdTable::clear()
+{
+    if (_used == 0)
+        return;
+    _slots.assign(_slots.size(), Slot());
+    _used = 0;
+}
+
+void ScopedVarIds::declare(const std::string &name, unsigned int varId)
+{
+    unsigned int &id = _table(name);
+    if (!_scopes.empty())
+        _undo.push_back(Undo(&name, id));
+    id = varId;
+}
+
+void ScopedVarIds::leaveScope()
+{
+    const std::size_t start = _scopes.back();
+    _scopes.pop_back();
+    while (_undo.size() > start) {
+        _table(*_undo.back().name) = _undo.back().varId;
+        _undo.pop_back();
+    }
+}
@@ -0,0 +1,105 @@
+/*
+
+ */
+
+#include "config.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef varidmapH
+#define varidmapH
+
+/**
+ * @brief Hash table from (owner, name) to a variable id, used by
+ * Tokenizer::setVarId().
+ *
+ * The names are the texts of tokens. Token texts are interned per token list,
+ * so the table hashes and compares the address of the text, and all names
+ * must come from tokens of the same token list. The owner is the variable id
+ * of the struct for struct members and 0 for variables. Entries are never
+ * removed, a variable id 0 means that there is no variable.
+ */
+class ZKCHECKLIB VarIdTable {
+public:
+    VarIdTable();
+
+    /** @brief Variable id of the name, 0 if there is none */
+    unsigned int find(const std::string &name, unsigned int owner = 0) const;
+
+    /** @brief Variable id of the name for assignment, 0 if there is none yet */
+    unsigned int &operator()(const std::string &name, unsigned int owner = 0);
+
+    void clear();
+
+private:
+    struct Slot {
+        Slot() : name(nullptr), owner(0), varId(0) { }
+        const std::string *name;
+        unsigned int owner;
+        unsigned int varId;
+    };
+
+    /** Index of the slot of the name, or of the empty slot where it goes */
+    std::size_t slot(const std::string *name, unsigned int owner) const;
+
+    void grow();
+
+    /** Open addressing with linear probing, the size is a power of two */
+    std::vector<Slot> _slots;
+
+    /** Number of used slots */
+    std::size_t _used;
+};
+
+/**
+ * @brief Variable ids of the names that are visible in the current scope.
+ *
+ * Entering a scope does not copy the variables. The previous variable ids of
+ * the names that are declared in a scope are remembered and put back when
+ * the scope is left.
+ */
+class ZKCHECKLIB ScopedVarIds {
+public:
+    /** @brief Variable id of the name, 0 if there is none */
+    unsigned int find(const std::string &name) const {
+        return _table.find(name);
+    }
+
+    /** @brief Declare the name in the current scope */
+    void declare(const std::string &name, unsigned int varId);
+
+    void enterScope() {
+        _scopes.push_back(_undo.size());
+    }
+
+    /** @brief Forget the names declared since the last enterScope() */
+    void leaveScope();
+
+    bool inScope() const {
+        return !_scopes.empty();
+    }
+
+    /** @brief Forget all names, only allowed outside of scopes */
+    void clear() {
+        _table.clear();
+    }
+
+private:
+    struct Undo {
+        Undo(const std::string *n, unsigned int v) : name(n), varId(v) { }
+        const std::string *name;
+        unsigned int varId;
+    };
+
+    VarIdTable _table;
+
+    /** Previous variable ids of the names declared in the scopes */
+    std::vector<Undo> _undo;
+
+    /** Size of _undo when each scope was entered */
+    std::vector<std::size_t> _scopes;
+};
+
+#endif // varidmapH
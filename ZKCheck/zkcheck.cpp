@@ -7,29 +7,325 @@
 #include "tokenize.h" // Tokenizer
 
 #include "check.h"
+#include "mappedfile.h"
 #include "path.h"
+#include "utils.h"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 #include "version.h"
 
-#ifdef HAVE_RULES
-#define PCRE_STATIC
-#include <pcre.h>
-#endif
-
 static const char Version[] = ZKCHECK_VERSION_STRING;
 static const char ExtraVersion[] = "";
 
-//static TimerResults S_timerResults;
-
 // CWE ids used
 static const CWE CWE398(398U);  // Indicator of Poor Code Quality
 
+/**
+ * @brief Checksums of the configurations of one file that were checked
+ * already. A configuration is skipped as soon as its code, its tokens or
+ * its simplified tokens equal those of a configuration checked before.
+ * The first two are compared before the expensive simplification runs.
+ * They are only recorded for configurations that got through
+ * simplifyTokens1(), the syntax errors of the others mention the
+ * configuration.
+ */
+class ConfigurationChecksums {
+public:
+    /**
+     * @param enabled compare the simplified tokens
+     * @param early compare the code and the tokens too
+     */
+    ConfigurationChecksums(bool enabled, bool early) : enabled(enabled), early(enabled && early) {
+    }
+
+    Hash128::Digest codeChecksum(const std::string &code) const {
+        if (!early)
+            return Hash128::Digest(0, 0);
+        Hash128 hash;
+        hash.update(code);
+        return hash.digest();
+    }
+
+    bool codeChecked(const Hash128::Digest &code) const {
+        return early && _code.find(code) != _code.end();
+    }
+
+    bool tokensChecked(const Hash128::Digest &tokens) const {
+        return early && _tokens.find(tokens) != _tokens.end();
+    }
+
+    /**
+     * @brief Record a configuration that got through simplifyTokens1()
+     * @return true if its simplified tokens were met before
+     */
+    bool simplifiedTokensChecked(const Hash128::Digest &code, const Hash128::Digest &tokens, const Hash128::Digest &simplified) {
+        if (early) {
+            _code.insert(code);
+            _tokens.insert(tokens);
+        }
+        return !_simplified.insert(simplified).second;
+    }
+
+    /** @brief Record a configuration whose results were read from the result cache */
+    void cached(const Hash128::Digest &code, const Hash128::Digest &simplified) {
+        if (early)
+            _code.insert(code);
+        _simplified.insert(simplified);
+    }
+
+    const bool enabled;
+    const bool early;
+
+private:
+    std::set<Hash128::Digest> _code;
+    std::set<Hash128::Digest> _tokens;
+    std::set<Hash128::Digest> _simplified;
+};
+
+/**
+ * @brief Receives what checking one configuration reports, see
+ * ZKCheck::checkConfiguration(). The checking stops when
+ * tokensChecked() or simplifiedTokensChecked() return true.
+ */
+class ConfigurationLogger : public ErrorLogger {
+public:
+    explicit ConfigurationLogger(const ConfigurationChecksums &checksums)
+        : skipDuplicates(checksums.enabled), skipDuplicatesEarly(checksums.early) {
+    }
+
+    /** @brief Was a configuration with the same tokens checked already? */
+    virtual bool tokensChecked(const Hash128::Digest &checksum) = 0;
+
+    /**
+     * @brief Called once simplifyTokens1() succeeded
+     * @return true if a configuration with the same simplified tokens was checked already
+     */
+    virtual bool simplifiedTokensChecked(const Hash128::Digest &checksum) = 0;
+
+    /** @brief The checking failed with an InternalError, which is reported next */
+    virtual void internalError(const std::string &filename, const std::string &cfg) = 0;
+
+    virtual void addFileInfo(Check::FileInfo *fileInfo) = 0;
+
+    virtual TimerResults &timerResults() = 0;
+
+    /** @brief The results depend on the time or the memory the checking took, don't cache them */
+    virtual void notCacheable() {
+    }
+
+    const bool skipDuplicates;
+    const bool skipDuplicatesEarly;
+};
+
+/** @brief Passes everything on to the ZKCheck right away */
+class ZKCheck::SerialConfigurationLogger : public ConfigurationLogger {
+public:
+    SerialConfigurationLogger(ZKCheck &zkcheck, ConfigurationChecksums &checksums, const Hash128::Digest &codeChecksum, bool &internalErrorFound)
+        : ConfigurationLogger(checksums), _zkcheck(zkcheck), _checksums(checksums), _codeChecksum(codeChecksum), _tokenChecksum(0, 0), _internalErrorFound(internalErrorFound) {
+    }
+
+    virtual void reportOut(const std::string &outmsg) {
+        _zkcheck.reportOut(outmsg);
+    }
+
+    virtual void reportErr(const ErrorLogger::ErrorMessage &msg) {
+        _zkcheck.reportErr(msg);
+    }
+
+    virtual void reportInfo(const ErrorLogger::ErrorMessage &msg) {
+        _zkcheck.reportInfo(msg);
+    }
+
+    virtual void reportProgress(const std::string &filename, const char stage[], const std::size_t value) {
+        _zkcheck.reportProgress(filename, stage, value);
+    }
+
+    virtual bool tokensChecked(const Hash128::Digest &checksum) {
+        _tokenChecksum = checksum;
+        return _checksums.tokensChecked(checksum);
+    }
+
+    virtual bool simplifiedTokensChecked(const Hash128::Digest &checksum) {
+        _zkcheck._cacheEntry.checksum = checksum;
+        return _checksums.simplifiedTokensChecked(_codeChecksum, _tokenChecksum, checksum);
+    }
+
+    virtual void internalError(const std::string &filename, const std::string &cfg) {
+        _zkcheck.configurationFailed(filename, cfg);
+        _internalErrorFound = true;
+    }
+
+    virtual void addFileInfo(Check::FileInfo *fileInfo) {
+        _zkcheck.fileInfo.push_back(fileInfo);
+    }
+
+    virtual TimerResults &timerResults() {
+        return _zkcheck._timerResults;
+    }
+
+    virtual void notCacheable() {
+        _zkcheck._cacheKey.clear();
+    }
+
+private:
+    ZKCheck &_zkcheck;
+    ConfigurationChecksums &_checksums;
+    const Hash128::Digest _codeChecksum;
+    Hash128::Digest _tokenChecksum;
+    bool &_internalErrorFound;
+};
+
+namespace {
+    /** @brief State shared by the threads that check the configurations of one file */
+    struct SharedConfigurationState {
+        explicit SharedConfigurationState(ErrorLogger &errorLogger) : errorLogger(errorLogger) {
+        }
+
+        /** receives the progress reports */
+        ErrorLogger &errorLogger;
+
+        /**
+         * Checksum of the code of the configurations that got through
+         * simplifyTokens1(), with the lowest index of such a configuration.
+         * A later configuration with the same code is skipped anyway.
+         */
+        std::map<Hash128::Digest, std::size_t> simplifiedCode;
+
+        /** guards the members above */
+        std::mutex sync;
+    };
+
+    /**
+     * @brief Records what checking one configuration on a worker thread
+     * reports. The records are passed on in the order of the
+     * configurations once all of them are checked.
+     */
+    class RecordingConfigurationLogger : public ConfigurationLogger {
+    public:
+        enum EventType { OUT, ERR, INFO, CODE, TOKENS, SIMPLIFIED, INTERNAL_ERROR };
+
+        struct Event {
+            explicit Event(EventType t) : type(t), checksum(0, 0) {
+            }
+
+            EventType type;
+
+            /** message of OUT, file name of INTERNAL_ERROR */
+            std::string text;
+
+            /** message of ERR and INFO */
+            ErrorLogger::ErrorMessage msg;
+
+            /** checksum of CODE, TOKENS and SIMPLIFIED */
+            Hash128::Digest checksum;
+        };
+
+        RecordingConfigurationLogger(const ConfigurationChecksums &checksums, SharedConfigurationState &shared, std::size_t index, const std::string &cfg)
+            : ConfigurationLogger(checksums), cfg(cfg), _shared(shared), _index(index), _codeChecksum(0, 0) {
+        }
+
+        ~RecordingConfigurationLogger() {
+            while (!fileInfo.empty()) {
+                delete fileInfo.back();
+                fileInfo.pop_back();
+            }
+        }
+
+        virtual void reportOut(const std::string &outmsg) {
+            events.push_back(Event(OUT));
+            events.back().text = outmsg;
+        }
+
+        virtual void reportErr(const ErrorLogger::ErrorMessage &msg) {
+            events.push_back(Event(ERR));
+            events.back().msg = msg;
+        }
+
+        virtual void reportInfo(const ErrorLogger::ErrorMessage &msg) {
+            events.push_back(Event(INFO));
+            events.back().msg = msg;
+        }
+
+        virtual void reportProgress(const std::string &filename, const char stage[], const std::size_t value) {
+            std::lock_guard<std::mutex> lock(_shared.sync);
+            _shared.errorLogger.reportProgress(filename, stage, value);
+        }
+
+        /**
+         * @brief Record the checksum of the code given by getcode()
+         * @return true if a configuration before this one with the same code
+         * got through simplifyTokens1(), this one is skipped then
+         */
+        bool codeChecksum(const Hash128::Digest &checksum) {
+            _codeChecksum = checksum;
+            record(CODE, checksum);
+            if (!skipDuplicatesEarly)
+                return false;
+            std::lock_guard<std::mutex> lock(_shared.sync);
+            const std::map<Hash128::Digest, std::size_t>::const_iterator it = _shared.simplifiedCode.find(checksum);
+            return it != _shared.simplifiedCode.end() && it->second < _index;
+        }
+
+        virtual bool tokensChecked(const Hash128::Digest &checksum) {
+            record(TOKENS, checksum);
+            return false;
+        }
+
+        virtual bool simplifiedTokensChecked(const Hash128::Digest &checksum) {
+            record(SIMPLIFIED, checksum);
+            if (skipDuplicatesEarly) {
+                std::lock_guard<std::mutex> lock(_shared.sync);
+                const std::pair<std::map<Hash128::Digest, std::size_t>::iterator, bool> it = _shared.simplifiedCode.insert(std::make_pair(_codeChecksum, _index));
+                it.first->second = std::min(it.first->second, _index);
+            }
+            return false;
+        }
+
+        virtual void internalError(const std::string &filename, const std::string & /*cfg*/) {
+            events.push_back(Event(INTERNAL_ERROR));
+            events.back().text = filename;
+        }
+
+        virtual void addFileInfo(Check::FileInfo *info) {
+            fileInfo.push_back(info);
+        }
+
+        virtual TimerResults &timerResults() {
+            return _timerResults;
+        }
+
+        /** configuration, including the user defines */
+        const std::string cfg;
+
+        std::vector<Event> events;
+        std::list<Check::FileInfo*> fileInfo;
+
+    private:
+        void record(EventType type, const Hash128::Digest &checksum) {
+            events.push_back(Event(type));
+            events.back().checksum = checksum;
+        }
+
+        SharedConfigurationState &_shared;
+        const std::size_t _index;
+        Hash128::Digest _codeChecksum;
+        TimerResults _timerResults;
+    };
+}
+
 ZKCheck::ZKCheck(ErrorLogger &errorLogger, bool useGlobalSuppressions)
-    : _errorLogger(errorLogger), exitcode(0), _useGlobalSuppressions(useGlobalSuppressions), tooManyConfigs(false), _simplify(true)
+    : _errorLogger(errorLogger), exitcode(0), _useGlobalSuppressions(useGlobalSuppressions), tooManyConfigs(false), _simplify(true), _duplicatesDropped(0)
 {
 }
 
@@ -39,7 +335,6 @@ ZKCheck::~ZKCheck()
         delete fileInfo.back();
         fileInfo.pop_back();
     }
-    //S_timerResults.ShowResults(_settings.showtime);
 }
 
 const char * ZKCheck::version()
@@ -54,19 +349,19 @@ const char * ZKCheck::extraVersion()
 
 unsigned int ZKCheck::check(const std::string &path)
 {
-    std::ifstream fin(path.c_str());
-    return processFile(path, fin);
+    const MappedFile file(path);
+    return processFile(path, file.data(), file.size());
 }
 
 unsigned int ZKCheck::check(const std::string &path, const std::string &content)
 {
-    std::istringstream iss(content);
-    return processFile(path, iss);
+    return processFile(path, content.data(), content.size());
 }
 
-unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fileStream)
+unsigned int ZKCheck::processFile(const std::string& filename, const char *fileData, std::size_t fileSize)
 {
     exitcode = 0;
+    _fileStart = Budget::Clock::now();
 
     // only show debug warnings for accepted C/C++ source files
     if (!Path::acceptFile(filename))
@@ -88,9 +383,10 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
         std::string filedata;
 
         {
-            //Timer t("Preprocessor::preprocess", _settings.showtime, &S_timerResults);
-            preprocessor.preprocess(fileStream, filedata, configurations, filename, _settings.includePaths);
+            Timer t("Preprocessor::preprocess", _settings.showtime, &_timerResults);
+            preprocessor.preprocess(fileData, fileSize, filedata, configurations, filename, _settings.includePaths);
         }
+        _missingIncludes.merge(preprocessor.missingIncludes());
 
         if (_settings.checkConfiguration) {
             return 0;
@@ -111,7 +407,7 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
                         Tokenizer tokenizer3(&_settings, this);
                         std::istringstream istr3(code);
                         tokenizer3.list.createTokens(istr3, tokenizer2.list.file(tok));
-                        executeRules("define", tokenizer3);
+                        executeRules("define", tokenizer3, *this);
                     }
                 }
                 break;
@@ -142,9 +438,45 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
             }
         }
 
-        std::set<unsigned long long> checksums;
+        // The result cache can't reproduce dump files and debug output
+        const bool useCache = !_settings.cacheDir.empty() &&
+                              !_settings.dump &&
+                              !_settings.debug &&
+                              !_settings.debugnormal &&
+                              !_settings.preprocessOnly;
+        const ResultCache resultCache(useCache ? _settings.cacheDir : std::string());
+
+        ConfigurationChecksums checksums(_settings.force || _settings.maxConfigs > 1, !_settings.dump);
+
+        // Check the configurations with several threads. Dump files and
+        // debug output are written while checking, so they need the serial
+        // loop, and so does the result cache.
+        if (_settings.configJobs > 1 && configurations.size() > 1 &&
+            !useCache && !_settings.dump && !_settings.debug && !_settings.debugnormal && !_settings.preprocessOnly) {
+            std::vector<std::string> cfgs(configurations.begin(), configurations.end());
+            if (!_settings.force && cfgs.size() > _settings.maxConfigs)
+                cfgs.resize(_settings.maxConfigs);
+            checkConfigurations(preprocessor, filename, filedata, cfgs, checksums, internalErrorFound);
+            configurations.clear();
+        }
+
+        const auto configuration = [this](const std::string &c) -> std::string {
+            if (_settings.userDefines.empty())
+                return c;
+            return c.empty() ? _settings.userDefines : (_settings.userDefines + ";" + c);
+        };
+
+        // The code of the configurations is fetched in batches, with one
+        // walk over the directives for each batch. Dump files need the
+        // directives of each configuration.
+        std::vector<Preprocessor::ConfigurationCode> batch;
+        std::size_t batchPos = 0;
+
         unsigned int checkCount = 0;
         for (std::list<std::string>::const_iterator it = configurations.begin(); it != configurations.end(); ++it) {
+            // the previous configuration is completely checked
+            storeCacheEntry(resultCache);
+
             // bail out if terminated
             if (_settings.terminated())
                 break;
@@ -163,15 +495,26 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
                 _errorLogger.reportOut("Checking " + fixedpath + ": " + cfg + "...");
             }
 
-            if (!_settings.userDefines.empty()) {
-                if (!cfg.empty())
-                    cfg = ";" + cfg;
-                cfg = _settings.userDefines + cfg;
-            }
+            cfg = configuration(cfg);
 
-            //Timer t("Preprocessor::getcode", _settings.showtime, &S_timerResults);
-            std::string codeWithoutCfg = preprocessor.getcode(filedata, cfg, filename);
-            //t.Stop();
+            Timer t("Preprocessor::getcode", _settings.showtime, &_timerResults);
+            std::string codeWithoutCfg;
+            if (_settings.dump) {
+                codeWithoutCfg = preprocessor.getcode(filedata, cfg, filename);
+            } else {
+                if (batchPos == batch.size()) {
+                    std::vector<std::string> cfgs;
+                    for (std::list<std::string>::const_iterator it2 = it; it2 != configurations.end() && cfgs.size() < 64U; ++it2) {
+                        if (!_settings.force && checkCount + cfgs.size() > _settings.maxConfigs)
+                            break;
+                        cfgs.push_back(configuration(*it2));
+                    }
+                    batch = preprocessor.getcodes(filedata, cfgs, filename);
+                    batchPos = 0;
+                }
+                codeWithoutCfg = preprocessor.getcode(batch[batchPos++], cfg, filename);
+            }
+            t.Stop();
 
             codeWithoutCfg += _settings.append();
 
@@ -191,111 +534,36 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
                 continue;
             }
 
-            Tokenizer _tokenizer(&_settings, this);
-            /*if (_settings.showtime != SHOWTIME_NONE)
-                _tokenizer.setTimerResults(&S_timerResults);*/
-
-            try {
-                // Create tokens, skip rest of iteration if failed
-                std::istringstream istr(codeWithoutCfg);
-                //Timer timer("Tokenizer::createTokens", _settings.showtime, &S_timerResults);
-                bool result = _tokenizer.createTokens(istr, filename.c_str());
-                //timer.Stop();
-                if (!result)
-                    continue;
-
-                // skip rest of iteration if just checking configuration
-                if (_settings.checkConfiguration)
-                    continue;
-
-                // Check raw tokens
-                checkRawTokens(_tokenizer);
+            const Hash128::Digest codeChecksum = checksums.codeChecksum(codeWithoutCfg);
+            if (checksums.codeChecked(codeChecksum))
+                continue;
 
-                // Simplify tokens into normal form, skip rest of iteration if failed
-                //Timer timer2("Tokenizer::simplifyTokens1", _settings.showtime, &S_timerResults);
-                result = _tokenizer.simplifyTokens1(cfg);
-                //timer2.Stop();
-                if (!result)
+            if (useCache) {
+                const std::string key = ResultCache::key(_settings, _simplify, filename, cfg, codeWithoutCfg);
+                ResultCache::Entry entry;
+                if (resultCache.load(key, entry)) {
+                    for (std::list<std::pair<ErrorLogger::ErrorMessage, bool> >::const_iterator msg = entry.messages.begin(); msg != entry.messages.end(); ++msg) {
+                        if (msg->second)
+                            reportInfo(msg->first);
+                        else
+                            reportErr(msg->first);
+                    }
+                    if (entry.internalError)
+                        internalErrorFound = true;
+                    if (entry.checksum != Hash128::Digest(0, 0))
+                        checksums.cached(codeChecksum, entry.checksum);
                     continue;
-
-                // dump xml if --dump
-                if (_settings.dump && fdump.is_open()) {
-                    fdump << "<dump cfg=\"" << cfg << "\">" << std::endl;
-                    preprocessor.dump(fdump);
-                    _tokenizer.dump(fdump);
-                    fdump << "</dump>" << std::endl;
-                }
-
-                // Skip if we already met the same simplified token list
-                if (_settings.force || _settings.maxConfigs > 1) {
-                    const unsigned long long checksum = _tokenizer.list.calculateChecksum();
-                    if (checksums.find(checksum) != checksums.end())
-                        continue;
-                    checksums.insert(checksum);
-                }
-
-                // Check normal tokens
-                checkNormalTokens(_tokenizer);
-
-                // simplify more if required, skip rest of iteration if failed
-                if (_simplify) {
-                    // if further simplification fails then skip rest of iteration
-                    //Timer timer3("Tokenizer::simplifyTokenList2", _settings.showtime, &S_timerResults);
-                    result = _tokenizer.simplifyTokenList2();
-                    //timer3.Stop();
-                    if (!result)
-                        continue;
-
-					// write dump file xml prolog
-					std::ofstream fdump2;
-					if (_settings.dump) {
-						const std::string dumpfile(filename + "2.dump");
-						fdump2.open(dumpfile.c_str());
-						if (fdump2.is_open()) {
-							fdump2 << "<?xml version=\"1.0\"?>" << std::endl;
-							fdump2 << "<dumps>" << std::endl;
-						}
-					}
-
-					// dump xml if --dump
-					if (_settings.dump && fdump.is_open()) {
-						fdump2 << "<dump cfg=\"" << cfg << "\">" << std::endl;
-						preprocessor.dump(fdump2);
-						_tokenizer.dump(fdump2);
-						fdump2 << "</dump>" << std::endl;
-					}
-
-                    // Check simplified tokens
-                    checkSimplifiedTokens(_tokenizer);
-                }
-
-            } catch (const InternalError &e) {
-                if (_settings.isEnabled("information") && (_settings.debug || _settings.verbose))
-                    purgedConfigurationMessage(filename, cfg);
-                internalErrorFound=true;
-                std::list<ErrorLogger::ErrorMessage::FileLocation> locationList;
-                ErrorLogger::ErrorMessage::FileLocation loc;
-                if (e.token) {
-                    loc.line = e.token->linenr();
-                    const std::string fixedpath = Path::toNativeSeparators(_tokenizer.list.file(e.token));
-                    loc.setfile(fixedpath);
-                } else {
-                    ErrorLogger::ErrorMessage::FileLocation loc2;
-                    loc2.setfile(Path::toNativeSeparators(filename.c_str()));
-                    locationList.push_back(loc2);
-                    loc.setfile(_tokenizer.list.getSourceFilePath());
                 }
-                locationList.push_back(loc);
-                const ErrorLogger::ErrorMessage errmsg(locationList,
-                                                       Severity::error,
-                                                       e.errorMessage,
-                                                       e.id,
-                                                       false);
-
-                reportErr(errmsg);
+                _cacheKey = key;
+                _cacheEntry = ResultCache::Entry();
             }
+
+            SerialConfigurationLogger logger(*this, checksums, codeChecksum, internalErrorFound);
+            checkConfiguration(preprocessor, filename, codeWithoutCfg, cfg, logger, fdump);
         }
 
+        storeCacheEntry(resultCache);
+
         // dumped all configs, close root </dumps> element now
         if (_settings.dump && fdump.is_open())
             fdump << "</dumps>" << std::endl;
@@ -307,6 +575,9 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
         exitcode=1; // e.g. reflect a syntax error
     }
 
+    // Results of an aborted configuration are incomplete
+    _cacheKey.clear();
+
     // In jointSuppressionReport mode, unmatched suppressions are
     // collected after all files are processed
     if (!_settings.jointSuppressionReport && (_settings.isEnabled("information") || _settings.checkConfiguration)) {
@@ -320,6 +591,274 @@ unsigned int ZKCheck::processFile(const std::string& filename, std::istream& fil
     return exitcode;
 }
 
+void ZKCheck::checkConfiguration(Preprocessor &preprocessor, const std::string &filename, const std::string &code, const std::string &cfg, ConfigurationLogger &logger, std::ofstream &fdump)
+{
+    Tokenizer _tokenizer(&_settings, &logger);
+    if (_settings.showtime != SHOWTIME_NONE)
+        _tokenizer.setTimerResults(&logger.timerResults());
+    Budget budget(_settings.budget, _fileStart);
+    if (_settings.budget.any())
+        _tokenizer.list.setBudget(&budget);
+
+    try {
+        // Create tokens, skip the rest of the configuration if failed
+        Timer timer("Tokenizer::createTokens", _settings.showtime, &logger.timerResults());
+        bool result = _tokenizer.createTokens(code, filename.c_str());
+        timer.Stop();
+        if (!result)
+            return;
+        if (_tokenizer.list.budget())
+            budget.check(_tokenizer.list.front());
+
+        // skip the rest if just checking configuration
+        if (_settings.checkConfiguration)
+            return;
+
+        // Skip if we already met the same token list
+        if (logger.skipDuplicatesEarly && logger.tokensChecked(_tokenizer.list.calculateChecksum(true)))
+            return;
+
+        // Check raw tokens
+        checkRawTokens(_tokenizer, logger);
+
+        // Simplify tokens into normal form, skip the rest of the configuration if failed
+        Timer timer2("Tokenizer::simplifyTokens1", _settings.showtime, &logger.timerResults());
+        result = _tokenizer.simplifyTokens1(cfg);
+        timer2.Stop();
+        if (!result)
+            return;
+
+        // dump xml if --dump
+        if (_settings.dump && fdump.is_open()) {
+            fdump << "<dump cfg=\"" << cfg << "\">" << std::endl;
+            preprocessor.dump(fdump);
+            _tokenizer.dump(fdump);
+            fdump << "</dump>" << std::endl;
+        }
+
+        // Skip if we already met the same simplified token list
+        if (logger.skipDuplicates && logger.simplifiedTokensChecked(_tokenizer.list.calculateChecksum()))
+            return;
+
+        // Check normal tokens
+        checkNormalTokens(_tokenizer, logger);
+
+        // the simplified code is not checked when the budget is exceeded
+        const bool withinBudget = !_tokenizer.list.budget() || !budget.check(_tokenizer.list.front());
+        if (_simplify && !withinBudget)
+            budget.degrade("simplifyTokenList2 skipped");
+
+        // simplify more if required, skip the rest of the configuration if failed
+        if (_simplify && withinBudget) {
+            // if further simplification fails then skip the rest of the configuration
+            Timer timer3("Tokenizer::simplifyTokenList2", _settings.showtime, &logger.timerResults());
+            result = _tokenizer.simplifyTokenList2();
+            timer3.Stop();
+            if (!result)
+                return;
+
+			// write dump file xml prolog
+			std::ofstream fdump2;
+			if (_settings.dump) {
+				const std::string dumpfile(filename + "2.dump");
+				fdump2.open(dumpfile.c_str());
+				if (fdump2.is_open()) {
+					fdump2 << "<?xml version=\"1.0\"?>" << std::endl;
+					fdump2 << "<dumps>" << std::endl;
+				}
+			}
+
+			// dump xml if --dump
+			if (_settings.dump && fdump.is_open()) {
+				fdump2 << "<dump cfg=\"" << cfg << "\">" << std::endl;
+				preprocessor.dump(fdump2);
+				_tokenizer.dump(fdump2);
+				fdump2 << "</dump>" << std::endl;
+			}
+
+            // Check simplified tokens
+            checkSimplifiedTokens(_tokenizer, logger);
+        }
+
+    } catch (const InternalError &e) {
+        logger.internalError(filename, cfg);
+        std::list<ErrorLogger::ErrorMessage::FileLocation> locationList;
+        ErrorLogger::ErrorMessage::FileLocation loc;
+        if (e.token) {
+            loc.line = e.token->linenr();
+            const std::string fixedpath = Path::toNativeSeparators(_tokenizer.list.file(e.token));
+            loc.setfile(fixedpath);
+        } else {
+            ErrorLogger::ErrorMessage::FileLocation loc2;
+            loc2.setfile(Path::toNativeSeparators(filename.c_str()));
+            locationList.push_back(loc2);
+            loc.setfile(_tokenizer.list.getSourceFilePath());
+        }
+        locationList.push_back(loc);
+        const ErrorLogger::ErrorMessage errmsg(locationList,
+                                               Severity::error,
+                                               e.errorMessage,
+                                               e.id,
+                                               false);
+
+        logger.reportErr(errmsg);
+    }
+
+    if (!budget.degradedStages().empty()) {
+        budgetExceededMessage(logger, filename, cfg, budget);
+        if (budget.exceeded(Budget::TIME) || budget.exceeded(Budget::MEMORY))
+            logger.notCacheable();
+    }
+}
+
+void ZKCheck::checkConfigurations(const Preprocessor &preprocessor, const std::string &filename, const std::string &filedata, const std::vector<std::string> &configurations, ConfigurationChecksums &checksums, bool &internalErrorFound)
+{
+    SharedConfigurationState shared(_errorLogger);
+    std::deque<RecordingConfigurationLogger> loggers;
+    for (std::size_t i = 0; i < configurations.size(); ++i) {
+        std::string c = configurations[i];
+        if (!_settings.userDefines.empty()) {
+            if (!c.empty())
+                c = ";" + c;
+            c = _settings.userDefines + c;
+        }
+        loggers.emplace_back(checksums, shared, i, c);
+    }
+
+    // Each thread takes the next configuration that nobody checks yet
+    std::atomic<std::size_t> next(0);
+    std::ofstream nodump;
+    const std::function<void()> worker = [&]() {
+        for (std::size_t i = next++; i < loggers.size() && !_settings.terminated(); i = next++) {
+            RecordingConfigurationLogger &logger = loggers[i];
+            Preprocessor configPreprocessor(preprocessor, &logger);
+
+            Timer t("Preprocessor::getcode", _settings.showtime, &logger.timerResults());
+            std::string code = configPreprocessor.getcode(filedata, logger.cfg, filename);
+            t.Stop();
+
+            code += _settings.append();
+
+            if (logger.codeChecksum(checksums.codeChecksum(code)))
+                continue;
+
+            checkConfiguration(configPreprocessor, filename, code, logger.cfg, logger, nodump);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < std::min<std::size_t>(_settings.configJobs, loggers.size()); ++i)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (std::size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    // Pass on what was reported in the order of the configurations, and
+    // skip the duplicates, exactly like the configurations were checked
+    // one after another
+    for (std::size_t i = 0; i < loggers.size(); ++i) {
+        if (_settings.terminated())
+            break;
+
+        RecordingConfigurationLogger &logger = loggers[i];
+        _timerResults.merge(logger.timerResults());
+
+        if (_settings.quiet == false && i > 0) {
+            std::string fixedpath = Path::simplifyPath(filename);
+            fixedpath = Path::toNativeSeparators(fixedpath);
+            _errorLogger.reportOut("Checking " + fixedpath + ": " + configurations[i] + "...");
+        }
+
+        Hash128::Digest codeChecksum(0, 0);
+        Hash128::Digest tokenChecksum(0, 0);
+        bool skipped = false;
+        for (std::vector<RecordingConfigurationLogger::Event>::const_iterator event = logger.events.begin(); event != logger.events.end() && !skipped; ++event) {
+            switch (event->type) {
+            case RecordingConfigurationLogger::OUT:
+                reportOut(event->text);
+                break;
+            case RecordingConfigurationLogger::ERR:
+                reportErr(event->msg);
+                break;
+            case RecordingConfigurationLogger::INFO:
+                reportInfo(event->msg);
+                break;
+            case RecordingConfigurationLogger::CODE:
+                codeChecksum = event->checksum;
+                skipped = checksums.codeChecked(codeChecksum);
+                break;
+            case RecordingConfigurationLogger::TOKENS:
+                tokenChecksum = event->checksum;
+                skipped = checksums.tokensChecked(tokenChecksum);
+                break;
+            case RecordingConfigurationLogger::SIMPLIFIED:
+                skipped = checksums.simplifiedTokensChecked(codeChecksum, tokenChecksum, event->checksum);
+                break;
+            case RecordingConfigurationLogger::INTERNAL_ERROR:
+                configurationFailed(event->text, logger.cfg);
+                internalErrorFound = true;
+                break;
+            }
+        }
+        if (!skipped)
+            fileInfo.splice(fileInfo.end(), logger.fileInfo);
+    }
+}
+
+void ZKCheck::configurationFailed(const std::string &filename, const std::string &cfg)
+{
+    if (_settings.isEnabled("information") && (_settings.debug || _settings.verbose))
+        purgedConfigurationMessage(filename, cfg);
+    _cacheEntry.internalError = true;
+}
+
+void ZKCheck::budgetExceededMessage(ErrorLogger &logger, const std::string &file, const std::string &cfg, const Budget &budget) const
+{
+    if (!_settings.isEnabled("information"))
+        return;
+
+    std::ostringstream msg;
+    msg << "The checking of the configuration '" << cfg << "' is incomplete since it exceeded its budget (";
+    const char *sep = "";
+    for (int r = 0; r < Budget::RESOURCES; ++r) {
+        const Budget::Resource resource = static_cast<Budget::Resource>(r);
+        if (budget.exceeded(resource)) {
+            msg << sep << "--budget-" << Budget::name(resource) << '=' << _settings.budget.limit(resource);
+            sep = " ";
+        }
+    }
+    msg << "): ";
+    sep = "";
+    for (std::vector<std::string>::const_iterator it = budget.degradedStages().begin(); it != budget.degradedStages().end(); ++it) {
+        msg << sep << *it;
+        sep = ", ";
+    }
+    msg << '.';
+
+    std::list<ErrorLogger::ErrorMessage::FileLocation> loclist;
+    ErrorLogger::ErrorMessage::FileLocation location;
+    location.setfile(Path::toNativeSeparators(file));
+    loclist.push_back(location);
+
+    const ErrorLogger::ErrorMessage errmsg(loclist,
+                                           Severity::information,
+                                           msg.str(),
+                                           "budgetExceeded",
+                                           false);
+
+    logger.reportErr(errmsg);
+}
+
+void ZKCheck::storeCacheEntry(const ResultCache &cache)
+{
+    if (_cacheKey.empty())
+        return;
+    if (!_settings.terminated())
+        cache.store(_cacheKey, _cacheEntry);
+    _cacheKey.clear();
+    _cacheEntry = ResultCache::Entry();
+}
+
 void ZKCheck::internalError(const std::string &filename, const std::string &msg)
 {
     const std::string fixedpath = Path::toNativeSeparators(filename);
@@ -344,85 +883,99 @@ void ZKCheck::internalError(const std::string &filename, const std::string &msg)
     }
 }
 
+/** @brief The checks stop when the time is up, remember that for the budget message */
+static void checksSkipped(const Tokenizer &tokenizer)
+{
+    if (tokenizer.list.budget())
+        tokenizer.list.budget()->degrade("remaining checks skipped");
+}
+
 //---------------------------------------------------------------------------
 // CppCheck - A function that checks a raw token list
 //---------------------------------------------------------------------------
-void ZKCheck::checkRawTokens(const Tokenizer &tokenizer)
+void ZKCheck::checkRawTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger)
 {
 	// call all "runChecks" in all registered Check classes
 	for (std::list<Check*>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it) {
 		if (_settings.terminated())
 			return;
 
-		if (tokenizer.isMaxTime())
+		if (tokenizer.isMaxTime()) {
+			checksSkipped(tokenizer);
 			return;
+		}
 
-		//Timer timerRunChecks((*it)->name() + "::runChecks", _settings.showtime, &S_timerResults);
-		(*it)->runRawChecks(&tokenizer, &_settings, this);
+		Timer timerRunChecks((*it)->name() + "::runRawChecks", _settings.showtime, &logger.timerResults());
+		(*it)->runRawChecks(&tokenizer, &_settings, &logger);
 	}
 
 
     // Execute rules for "raw" code
-    executeRules("raw", tokenizer);
+    executeRules("raw", tokenizer, logger);
 }
 
 //---------------------------------------------------------------------------
 // CppCheck - A function that checks a normal token list
 //---------------------------------------------------------------------------
 
-void ZKCheck::checkNormalTokens(const Tokenizer &tokenizer)
+void ZKCheck::checkNormalTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger)
 {
     // call all "runChecks" in all registered Check classes
     for (std::list<Check *>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it) {
         if (_settings.terminated())
             return;
 
-        if (tokenizer.isMaxTime())
+        if (tokenizer.isMaxTime()) {
+            checksSkipped(tokenizer);
             return;
+        }
 
-        //Timer timerRunChecks((*it)->name() + "::runChecks", _settings.showtime, &S_timerResults);
-        (*it)->runChecks(&tokenizer, &_settings, this);
+        Timer timerRunChecks((*it)->name() + "::runChecks", _settings.showtime, &logger.timerResults());
+        (*it)->runChecks(&tokenizer, &_settings, &logger);
     }
 
     // Analyse the tokens..
     for (std::list<Check *>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it) {
         Check::FileInfo *fi = (*it)->getFileInfo(&tokenizer, &_settings);
         if (fi != nullptr)
-            fileInfo.push_back(fi);
+            logger.addFileInfo(fi);
     }
 
-    executeRules("normal", tokenizer);
+    executeRules("normal", tokenizer, logger);
 }
 
 //---------------------------------------------------------------------------
 // CppCheck - A function that checks a simplified token list
 //---------------------------------------------------------------------------
 
-void ZKCheck::checkSimplifiedTokens(const Tokenizer &tokenizer)
+void ZKCheck::checkSimplifiedTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger)
 {
     // call all "runSimplifiedChecks" in all registered Check classes
     for (std::list<Check *>::const_iterator it = Check::instances().begin(); it != Check::instances().end(); ++it) {
         if (_settings.terminated())
             return;
 
-        if (tokenizer.isMaxTime())
+        if (tokenizer.isMaxTime()) {
+            checksSkipped(tokenizer);
             return;
+        }
 
-        //Timer timerSimpleChecks((*it)->name() + "::runSimplifiedChecks", _settings.showtime, &S_timerResults);
+        Timer timerSimpleChecks((*it)->name() + "::runSimplifiedChecks", _settings.showtime, &logger.timerResults());
 		/*if ((*it)->name() == "FuncParaVoid")
 			continue;*/
-        (*it)->runSimplifiedChecks(&tokenizer, &_settings, this);
-        //timerSimpleChecks.Stop();
+        (*it)->runSimplifiedChecks(&tokenizer, &_settings, &logger);
+        timerSimpleChecks.Stop();
     }
 
     if (!_settings.terminated())
-        executeRules("simple", tokenizer);
+        executeRules("simple", tokenizer, logger);
 }
 
-void ZKCheck::executeRules(const std::string &tokenlist, const Tokenizer &tokenizer)
+void ZKCheck::executeRules(const std::string &tokenlist, const Tokenizer &tokenizer, ErrorLogger &errorLogger)
 {
     (void)tokenlist;
     (void)tokenizer;
+    (void)errorLogger;
 
 #ifdef HAVE_RULES
     // Are there rules to execute?
@@ -436,55 +989,54 @@ void ZKCheck::executeRules(const std::string &tokenlist, const Tokenizer &tokeni
     if (isrule == false)
         return;
 
-    // Write all tokens in a string that can be parsed by pcre
-    std::ostringstream ostr;
-    for (const Token *tok = tokenizer.tokens(); tok; tok = tok->next())
-        ostr << " " << tok->str();
-    const std::string str(ostr.str());
+    // Write all tokens in a string that can be parsed by pcre. The offset
+    // after each token is saved so matches can be mapped back to tokens.
+    std::string str;
+    std::vector<const Token *> tokens;
+    std::vector<std::size_t> tokenEnds;
+    for (const Token *tok = tokenizer.tokens(); tok; tok = tok->next()) {
+        str += ' ';
+        str += tok->str();
+        tokens.push_back(tok);
+        tokenEnds.push_back(str.size());
+    }
 
-    for (std::list<Settings::Rule>::const_iterator it = _settings.rules.begin(); it != _settings.rules.end(); ++it) {
-        const Settings::Rule &rule = *it;
+    for (std::list<Settings::Rule>::iterator it = _settings.rules.begin(); it != _settings.rules.end(); ++it) {
+        Settings::Rule &rule = *it;
         if (rule.pattern.empty() || rule.id.empty() || rule.severity == Severity::none || rule.tokenlist != tokenlist)
             continue;
 
-        const char *error = nullptr;
-        int erroffset = 0;
-        pcre *re = pcre_compile(rule.pattern.c_str(),0,&error,&erroffset,nullptr);
-        if (!re) {
-            if (error) {
-                ErrorLogger::ErrorMessage errmsg(std::list<ErrorLogger::ErrorMessage::FileLocation>(),
-                                                 Severity::error,
-                                                 error,
-                                                 "pcre_compile",
-                                                 false);
-
-                reportErr(errmsg);
-            }
+        // Normally done already when the settings were loaded
+        rule.compile();
+
+        const std::string error = rule.compileError();
+        if (!error.empty()) {
+            ErrorLogger::ErrorMessage errmsg(std::list<ErrorLogger::ErrorMessage::FileLocation>(),
+                                             Severity::error,
+                                             error,
+                                             "pcre_compile",
+                                             false);
+
+            errorLogger.reportErr(errmsg);
             continue;
         }
 
-        int pos = 0;
-        int ovector[30]= {0};
-        while (pos < (int)str.size() && 0 <= pcre_exec(re, nullptr, str.c_str(), (int)str.size(), pos, 0, ovector, 30)) {
-            const unsigned int pos1 = (unsigned int)ovector[0];
-            const unsigned int pos2 = (unsigned int)ovector[1];
-
-            // jump to the end of the match for the next pcre_exec
-            pos = (int)pos2;
+        std::size_t pos = 0;
+        std::size_t pos1 = 0, pos2 = 0;
+        while (rule.match(str, pos, pos1, pos2)) {
+            // jump to the end of the match for the next search, don't get stuck on empty matches
+            pos = (pos2 > pos) ? pos2 : pos + 1U;
 
             // determine location..
             ErrorLogger::ErrorMessage::FileLocation loc;
             loc.setfile(tokenizer.list.getSourceFilePath());
             loc.line = 0;
 
-            std::size_t len = 0;
-            for (const Token *tok = tokenizer.tokens(); tok; tok = tok->next()) {
-                len = len + 1U + tok->str().size();
-                if (len > pos1) {
-                    loc.setfile(tokenizer.list.getFiles().at(tok->fileIndex()));
-                    loc.line = tok->linenr();
-                    break;
-                }
+            const std::vector<std::size_t>::const_iterator end = std::upper_bound(tokenEnds.begin(), tokenEnds.end(), pos1);
+            if (end != tokenEnds.end()) {
+                const Token *tok = tokens[end - tokenEnds.begin()];
+                loc.setfile(tokenizer.list.getFiles().at(tok->fileIndex()));
+                loc.line = tok->linenr();
             }
 
             const std::list<ErrorLogger::ErrorMessage::FileLocation> callStack(1, loc);
@@ -498,10 +1050,8 @@ void ZKCheck::executeRules(const std::string &tokenlist, const Tokenizer &tokeni
             const ErrorLogger::ErrorMessage errmsg(callStack, rule.severity, summary, rule.id, false);
 
             // Report error
-            reportErr(errmsg);
+            errorLogger.reportErr(errmsg);
         }
-
-        pcre_free(re);
     }
 #endif
 }
@@ -577,18 +1127,40 @@ void ZKCheck::purgedConfigurationMessage(const std::string &file, const std::str
 
 //---------------------------------------------------------------------------
 
+ZKCheck::ErrorKey ZKCheck::errorKey(const ErrorLogger::ErrorMessage &msg, bool verbose)
+{
+    // Everything ErrorMessage::toString() shows
+    Hash128 hash;
+    const unsigned long long callStackSize = msg._callStack.size();
+    hash.update(reinterpret_cast<const char *>(&callStackSize), sizeof(callStackSize));
+    for (std::list<ErrorLogger::ErrorMessage::FileLocation>::const_iterator loc = msg._callStack.begin(); loc != msg._callStack.end(); ++loc) {
+        hash.field(loc->getfile(false));
+        hash.update(reinterpret_cast<const char *>(&loc->line), sizeof(loc->line));
+    }
+    const char flags[2] = { static_cast<char>(msg._severity), msg._inconclusive ? '1' : '0' };
+    hash.update(flags, sizeof(flags));
+    hash.field(verbose ? msg.verboseMessage() : msg.shortMessage());
+    return hash.digest();
+}
+
 void ZKCheck::reportErr(const ErrorLogger::ErrorMessage &msg)
 {
     if (!_settings.library.reportErrors(msg.file0))
         return;
 
-    const std::string errmsg = msg.toString(_settings.verbose);
-    if (errmsg.empty())
+    if (!_cacheKey.empty())
+        _cacheEntry.messages.push_back(std::make_pair(msg, false));
+
+    const std::string &text = _settings.verbose ? msg.verboseMessage() : msg.shortMessage();
+    if (text.empty() && msg._callStack.empty() && msg._severity == Severity::none)
         return;
 
     // Alert only about unique errors
-    if (std::find(_errorList.begin(), _errorList.end(), errmsg) != _errorList.end())
+    const ErrorKey key = errorKey(msg, _settings.verbose);
+    if (_errorList.find(key) != _errorList.end()) {
+        ++_duplicatesDropped;
         return;
+    }
 
     std::string file;
     unsigned int line(0);
@@ -608,7 +1180,7 @@ void ZKCheck::reportErr(const ErrorLogger::ErrorMessage &msg)
     if (!_settings.nofail.isSuppressed(msg._id, file, line))
         exitcode = 1;
 
-    _errorList.push_back(errmsg);
+    _errorList.insert(key);
 
     _errorLogger.reportErr(msg);
 }
@@ -625,6 +1197,9 @@ void ZKCheck::reportProgress(const std::string &filename, const char stage[], co
 
 void ZKCheck::reportInfo(const ErrorLogger::ErrorMessage &msg)
 {
+    if (!_cacheKey.empty())
+        _cacheEntry.messages.push_back(std::make_pair(msg, true));
+
     // Suppressing info message?
     std::string file;
     unsigned int line(0);
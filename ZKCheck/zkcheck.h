@@ -6,11 +6,19 @@
 #include "settings.h"
 #include "errorlogger.h"
 #include "check.h"
+#include "preprocessor.h"
+#include "resultcache.h"
+#include "timer.h"
 
 #include <string>
 #include <list>
 #include <istream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+class ConfigurationChecksums;
+class ConfigurationLogger;
 class Tokenizer;
 
 #ifndef zkcheckH
@@ -109,7 +117,23 @@ public:
      * and if it's possible at all */
     bool unusedFunctionCheckIsEnabled() const;
 
+    /** @brief Number of duplicate messages that were not reported, for all checked files */
+    std::size_t duplicatesDropped() const {
+        return _duplicatesDropped;
+    }
+
+    /** @brief Times measured for --showtime=summary|top5, for all checked files */
+    TimerResults &timerResults() {
+        return _timerResults;
+    }
+
+    /** @brief Include files that were not found, in all checked files */
+    const MissingIncludes &missingIncludes() const {
+        return _missingIncludes;
+    }
+
 private:
+    class SerialConfigurationLogger;
 
     /** @brief There has been an internal error => Report information message */
     void internalError(const std::string &filename, const std::string &msg);
@@ -117,35 +141,73 @@ private:
     /**
      * @brief Process one file.
      * @param filename file name
-     * @param fileStream stream the file content can be read from
+     * @param fileData file content
+     * @param fileSize size of the file content
      * @return amount of errors found
      */
-    unsigned int processFile(const std::string& filename, std::istream& fileStream);
+    unsigned int processFile(const std::string& filename, const char *fileData, std::size_t fileSize);
+
+    /**
+     * @brief Tokenize, simplify and check the code of one configuration.
+     * @param preprocessor preprocessor that gave the code
+     * @param filename file name
+     * @param code code of the configuration, from Preprocessor::getcode()
+     * @param cfg the configuration
+     * @param logger receives the messages, and decides if the
+     * configuration is a duplicate
+     * @param fdump dump file, written if --dump is given
+     */
+    void checkConfiguration(Preprocessor &preprocessor, const std::string &filename, const std::string &code, const std::string &cfg, ConfigurationLogger &logger, std::ofstream &fdump);
+
+    /**
+     * @brief Check the configurations of one file with --config-jobs
+     * threads. The messages are passed on once all configurations are
+     * checked, in the same order as if they were checked one after
+     * another.
+     */
+    void checkConfigurations(const Preprocessor &preprocessor, const std::string &filename, const std::string &filedata, const std::vector<std::string> &configurations, ConfigurationChecksums &checksums, bool &internalErrorFound);
+
+    /** @brief Checking a configuration failed with an InternalError */
+    void configurationFailed(const std::string &filename, const std::string &cfg);
+
+    /** @brief Report the stages that were degraded since the budget was exceeded */
+    void budgetExceededMessage(ErrorLogger &logger, const std::string &file, const std::string &cfg, const Budget &budget) const;
 
     /**
      * @brief Check raw tokens
      * @param tokenizer
+     * @param logger
      */
-    void checkRawTokens(const Tokenizer &tokenizer);
+    void checkRawTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger);
 
     /**
      * @brief Check normal tokens
      * @param tokenizer
+     * @param logger
      */
-    void checkNormalTokens(const Tokenizer &tokenizer);
+    void checkNormalTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger);
 
     /**
      * @brief Check simplified tokens
      * @param tokenizer
+     * @param logger
      */
-    void checkSimplifiedTokens(const Tokenizer &tokenizer);
+    void checkSimplifiedTokens(const Tokenizer &tokenizer, ConfigurationLogger &logger);
 
     /**
      * @brief Execute rules, if any
      * @param tokenlist token list to use (normal / simple)
      * @param tokenizer tokenizer
+     * @param errorLogger receives the matches
+     */
+    void executeRules(const std::string &tokenlist, const Tokenizer &tokenizer, ErrorLogger &errorLogger);
+
+    /**
+     * @brief Write the messages recorded for the current configuration
+     * to the result cache and stop recording.
+     * @param cache result cache
      */
-    void executeRules(const std::string &tokenlist, const Tokenizer &tokenizer);
+    void storeCacheEntry(const ResultCache &cache);
 
     /**
      * @brief Errors and warnings are directed here.
@@ -163,7 +225,19 @@ private:
      */
     virtual void reportOut(const std::string &outmsg);
 
-    std::list<std::string> _errorList;
+    /** @brief 128-bit hash of what ErrorMessage::toString() would show */
+    typedef std::pair<unsigned long long, unsigned long long> ErrorKey;
+
+    struct ErrorKeyHash {
+        std::size_t operator()(const ErrorKey &key) const {
+            return static_cast<std::size_t>(key.first);
+        }
+    };
+
+    static ErrorKey errorKey(const ErrorLogger::ErrorMessage &msg, bool verbose);
+
+    /** @brief Messages already reported for the current file */
+    std::unordered_set<ErrorKey, ErrorKeyHash> _errorList;
     Settings _settings;
 
     void reportProgress(const std::string &filename, const char stage[], const std::size_t value);
@@ -188,6 +262,24 @@ private:
     /** Simplify code? true by default */
     bool _simplify;
 
+    /** @brief Result cache key of the configuration being checked, empty if its messages are not recorded */
+    std::string _cacheKey;
+
+    /** @brief Messages recorded for _cacheKey */
+    ResultCache::Entry _cacheEntry;
+
+    /** @brief Number of messages dropped by reportErr() because they were already reported */
+    std::size_t _duplicatesDropped;
+
+    /** @brief When the checking of the current file started, for the time budget */
+    Budget::Clock::time_point _fileStart;
+
+    /** @brief Times measured for --showtime */
+    TimerResults _timerResults;
+
+    /** @brief Include files that were not found */
+    MissingIncludes _missingIncludes;
+
     /** File info used for whole program analysis */
     std::list<Check::FileInfo*> fileInfo;
 };
@@ -126,9 +126,6 @@ bool ZKCheckExecutor::parseFromArgs(ZKCheck *cppcheck, int argc, const char* con
 
 int ZKCheckExecutor::check(int argc, const char* const argv[])
 {
-    Preprocessor::missingIncludeFlag = false;
-    Preprocessor::missingSystemIncludeFlag = false;
-
     ZKCheck zkCheck(*this, true);
 
     const Settings& settings = zkCheck.settings();
@@ -742,6 +739,9 @@ int ZKCheckExecutor::check_internal(ZKCheck& zkcheck, int /*argc*/, const char*
     }
 
     unsigned int returnValue = 0;
+    std::size_t duplicatesDropped = 0;
+    TimerResults timerResults;
+    MissingIncludes missingIncludes;
     if (settings.jobs == 1) {
         // Single process
         settings.jointSuppressionReport = true;
@@ -776,12 +776,18 @@ int ZKCheckExecutor::check_internal(ZKCheck& zkcheck, int /*argc*/, const char*
             }
         }
         zkcheck.analyseWholeProgram();
+        duplicatesDropped = zkcheck.duplicatesDropped();
+        timerResults.merge(zkcheck.timerResults());
+        missingIncludes = zkcheck.missingIncludes();
     } else if (!ThreadExecutor::isEnabled()) {
         std::cout << "No thread support yet implemented for this platform." << std::endl;
     } else {
         // Multiple processes
         ThreadExecutor executor(_files, settings, *this);
         returnValue = executor.check();
+        duplicatesDropped = executor.duplicatesDropped();
+        timerResults.merge(executor.timerResults());
+        missingIncludes = executor.missingIncludes();
     }
 
     if (settings.isEnabled("information") || settings.checkConfiguration) {
@@ -799,7 +805,7 @@ int ZKCheckExecutor::check_internal(ZKCheck& zkcheck, int /*argc*/, const char*
     if (!settings.checkConfiguration) {
         zkcheck.tooManyConfigsError("",0U);
 
-        if (settings.isEnabled("missingInclude") && (Preprocessor::missingIncludeFlag || Preprocessor::missingSystemIncludeFlag)) {
+        if (settings.isEnabled("missingInclude") && missingIncludes.any()) {
             const std::list<ErrorLogger::ErrorMessage::FileLocation> callStack;
             ErrorLogger::ErrorMessage msg(callStack,
                                           Severity::information,
@@ -809,7 +815,7 @@ int ZKCheckExecutor::check_internal(ZKCheck& zkcheck, int /*argc*/, const char*
                                           "files are found. Please check your project's include directories and add all of them "
                                           "as include directories for Cppcheck. To see what files Cppcheck cannot find use "
                                           "--check-config.",
-                                          Preprocessor::missingIncludeFlag ? "missingInclude" : "missingIncludeSystem",
+                                          missingIncludes.user ? "missingInclude" : "missingIncludeSystem",
                                           false);
             reportInfo(msg);
         }
@@ -819,6 +825,15 @@ int ZKCheckExecutor::check_internal(ZKCheck& zkcheck, int /*argc*/, const char*
         reportErr(ErrorLogger::ErrorMessage::getXMLFooter(settings.xml_version));
     }
 
+    if (settings.stats) {
+        std::ostringstream stats;
+        stats << "Statistics:\n"
+              << "  Duplicate messages dropped: " << duplicatesDropped;
+        reportOut(stats.str());
+    }
+
+    timerResults.ShowResults(settings.showtime, std::cout);
+
     _settings = 0;
     if (returnValue)
         return settings.exitCode;